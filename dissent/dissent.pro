@@ -18,6 +18,9 @@ DEFINES += FAST_NEFF_SHUFFLE
 # UNCOMMENT THE FOLLOWING TO ENABLE BLOG DROP BLAME FOR CSBULK
 # DEFINES += CS_BLOG_DROP
 
+# UNCOMMENT THE FOLLOWING TO GENERATE CSBULK PADS WITH X9.17 RATHER THAN AES-CTR
+# DEFINES += CSBR_X917_PADS
+
 QMAKE_CXXFLAGS += -Werror -std=c++11
 QMAKE_CFLAGS += -Werror
 
@@ -27,6 +30,9 @@ QMAKE_CFLAGS += -Werror
 DEFINES += CRYPTOPP
 LIBS += -lcryptopp
 
+# zlib, also used by Qt, for dictionary compression of frames
+LIBS += -lz
+
 # QHttpServer
 INCLUDEPATH += ext/qhttpserver/src
 HEADERS += ext/qhttpserver/src/qhttpconnection.h \
@@ -59,7 +65,9 @@ INCLUDEPATH += src
 
 HEADERS += src/Dissent.hpp \
            src/Anonymity/BaseDCNetRound.hpp \
+           src/Anonymity/BatchVerifier.hpp \
            src/Anonymity/CSDCNetRound.hpp \
+           src/Anonymity/HeresyRound.hpp \
            src/Anonymity/Log.hpp \
            src/Anonymity/NeffKeyShuffleRound.hpp \
            src/Anonymity/NeffShuffleRound.hpp \
@@ -86,6 +94,10 @@ HEADERS += src/Dissent.hpp \
            src/Crypto/AsymmetricKey.hpp \
            src/Crypto/DsaPrivateKey.hpp \
            src/Crypto/DsaPublicKey.hpp \
+           src/Crypto/EcdsaPrivateKey.hpp \
+           src/Crypto/EcdsaPublicKey.hpp \
+           src/Crypto/FixedBase.hpp \
+           src/Crypto/MultiExponentiation.hpp \
            src/Crypto/NeffShuffle.hpp \
            src/Crypto/RsaPrivateKey.hpp \
            src/Crypto/RsaPublicKey.hpp \
@@ -155,6 +167,7 @@ HEADERS += src/Dissent.hpp \
            src/Session/ClientRegister.hpp \
            src/Session/ClientSession.hpp \
            src/Session/ClientStates.hpp \
+           src/Session/EphemeralKeyPool.hpp \
            src/Session/SerializeList.hpp \
            src/Session/ServerAgree.hpp \
            src/Session/ServerEnlist.hpp \
@@ -181,9 +194,12 @@ HEADERS += src/Dissent.hpp \
            src/Transports/EdgeFactory.hpp \
            src/Transports/EdgeListener.hpp \
            src/Transports/EdgeListenerFactory.hpp \
+           src/Transports/FrameParser.hpp \
+           src/Transports/IoThreads.hpp \
            src/Transports/TcpAddress.hpp \
            src/Transports/TcpEdge.hpp \
            src/Transports/TcpEdgeListener.hpp \
+           src/Transports/TcpEdgeSocket.hpp \
            src/Utils/Logging.hpp \
            src/Utils/Random.hpp \
            src/Utils/QRunTimeError.hpp \
@@ -199,6 +215,7 @@ HEADERS += src/Dissent.hpp \
            src/Utils/Triggerable.hpp \
            src/Utils/Triple.hpp \
            src/Utils/Utils.hpp \
+           src/Utils/Xor.hpp \
            src/Web/EchoService.hpp \
            src/Web/GetDirectoryService.hpp \
            src/Web/GetFileService.hpp \
@@ -210,7 +227,9 @@ HEADERS += src/Dissent.hpp \
            src/Web/WebService.hpp 
 
 SOURCES += src/Anonymity/BaseDCNetRound.cpp \
+           src/Anonymity/BatchVerifier.cpp \
            src/Anonymity/CSDCNetRound.cpp \
+           src/Anonymity/HeresyRound.cpp \
            src/Anonymity/Log.cpp \
            src/Anonymity/NullRound.cpp \
            src/Anonymity/NeffShuffleRound.cpp \
@@ -230,6 +249,7 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Crypto/AsymmetricKey.cpp \
            src/Crypto/DsaPrivateKey.cpp \
            src/Crypto/DsaPublicKey.cpp \
+           src/Crypto/FixedBase.cpp \
            src/Crypto/NeffShuffle.cpp \
            src/Crypto/DiffieHellman.cpp \
            src/Crypto/KeyShare.cpp \
@@ -264,6 +284,7 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Messaging/RpcHandler.cpp \
            src/Messaging/SignalSink.cpp \
            src/Session/ClientSession.cpp \
+           src/Session/EphemeralKeyPool.cpp \
            src/Session/ServerSession.cpp \
            src/Session/Session.cpp \
            src/Session/SessionSharedState.cpp \
@@ -276,9 +297,12 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Transports/EdgeFactory.cpp \
            src/Transports/EdgeListener.cpp \
            src/Transports/EdgeListenerFactory.cpp \
+           src/Transports/FrameParser.cpp \
+           src/Transports/IoThreads.cpp \
            src/Transports/TcpAddress.cpp \
            src/Transports/TcpEdge.cpp \
            src/Transports/TcpEdgeListener.cpp \
+           src/Transports/TcpEdgeSocket.cpp \
            src/Utils/Logging.cpp \
            src/Utils/Random.cpp \
            src/Utils/Sleeper.cpp \
@@ -287,6 +311,7 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Utils/Timer.cpp \
            src/Utils/TimerEvent.cpp \
            src/Utils/Utils.cpp \
+           src/Utils/Xor.cpp \
            src/Web/GetDirectoryService.cpp \
            src/Web/GetFileService.cpp \
            src/Web/GetMessagesService.cpp \
@@ -296,6 +321,7 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Web/WebService.cpp
 
 HEADERS += src/Crypto/CryptoPP/DsaPublicKeyImpl.hpp \
+           src/Crypto/CryptoPP/EcdsaPublicKeyImpl.hpp \
            src/Crypto/CryptoPP/Helper.hpp \
            src/Crypto/CryptoPP/RsaPublicKeyImpl.hpp \
 
@@ -303,7 +329,20 @@ SOURCES += src/Crypto/CryptoPP/CryptoRandomImpl.cpp \
            src/Crypto/CryptoPP/DiffieHellmanImpl.cpp \
            src/Crypto/CryptoPP/DsaPrivateKeyImpl.cpp \
            src/Crypto/CryptoPP/DsaPublicKeyImpl.cpp \
+           src/Crypto/CryptoPP/EcdsaPrivateKeyImpl.cpp \
+           src/Crypto/CryptoPP/EcdsaPublicKeyImpl.cpp \
            src/Crypto/CryptoPP/HashImpl.cpp \
            src/Crypto/CryptoPP/IntegerImpl.cpp \
            src/Crypto/CryptoPP/RsaPrivateKeyImpl.cpp \
            src/Crypto/CryptoPP/RsaPublicKeyImpl.cpp
+
+# Native epoll transport
+linux {
+HEADERS += src/Transports/EpollAddress.hpp \
+           src/Transports/EpollEdge.hpp \
+           src/Transports/EpollEdgeListener.hpp
+
+SOURCES += src/Transports/EpollAddress.cpp \
+           src/Transports/EpollEdge.cpp \
+           src/Transports/EpollEdgeListener.cpp
+}
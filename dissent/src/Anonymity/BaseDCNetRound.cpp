@@ -3,6 +3,7 @@
 #include "Messaging/Request.hpp"
 #include "Utils/Timer.hpp"
 #include "Utils/TimerCallback.hpp"
+#include "Utils/Xor.hpp"
 
 #include "BaseDCNetRound.hpp"
 
@@ -42,13 +43,7 @@ namespace Anonymity {
   void BaseDCNetRound::Xor(QByteArray &dst, const QByteArray &t1,
       const QByteArray &t2)
   {
-    /// @todo use qint64 or qint32 depending on architecture
-    int count = std::min(dst.size(), t1.size());
-    count = std::min(count, t2.size());
-
-    for(int idx = 0; idx < count; idx++) {
-      dst[idx] = t1[idx] ^ t2[idx];
-    }
+    Utils::Xor(dst, t1, t2);
   }
 }
 }
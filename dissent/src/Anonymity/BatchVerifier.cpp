@@ -0,0 +1,144 @@
+#include <QDebug>
+#include <QHash>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include "Crypto/Serialization.hpp"
+
+#include "BatchVerifier.hpp"
+
+namespace Dissent {
+namespace Anonymity {
+  namespace {
+    /**
+     * Serially verifies a set of entries sharing a key, useful for
+     * QtConcurrent.  The key is the workers' copy, used by one task at a
+     * time.  Entries without a key were verified when queued.
+     */
+    struct VerifyGroup {
+      typedef QList<BatchVerifier::Entry> result_type;
+
+      QList<BatchVerifier::Entry> operator()(
+          const QList<BatchVerifier::Entry> &group) const
+      {
+        QList<BatchVerifier::Entry> results = group;
+        for(int idx = 0; idx < results.count(); idx++) {
+          BatchVerifier::Entry &result = results[idx];
+          if(result.key.isNull()) {
+            continue;
+          }
+          result.valid = BatchVerifier::Verify(result.key, result.data, result.msg);
+        }
+        return results;
+      }
+    };
+  }
+
+  BatchVerifier::BatchVerifier(Handler *handler) :
+    _handler(handler),
+    _in_flight(0)
+  {
+    QObject::connect(&_watcher, SIGNAL(finished()), this, SLOT(BatchFinished()));
+  }
+
+  void BatchVerifier::Queue(const Id &from,
+      const QSharedPointer<Crypto::AsymmetricKey> &key, const QByteArray &data)
+  {
+    Entry entry;
+    entry.from = from;
+    entry.key = GetWorkerKey(key);
+    entry.data = data;
+    entry.valid = false;
+    entry.index = 0;
+    if(entry.key.isNull()) {
+      entry.valid = Verify(key, data, entry.msg);
+    }
+    _pending.append(entry);
+
+    if(_in_flight == 0) {
+      StartBatch();
+    }
+  }
+
+  QSharedPointer<Crypto::AsymmetricKey> BatchVerifier::GetWorkerKey(
+      const QSharedPointer<Crypto::AsymmetricKey> &key)
+  {
+    const Crypto::AsymmetricKey *ptr = key.data();
+    if(!_worker_keys.contains(ptr)) {
+      QByteArray bkey;
+      QDataStream ostream(&bkey, QIODevice::WriteOnly);
+      ostream << key;
+
+      QSharedPointer<Crypto::AsymmetricKey> copy;
+      QDataStream istream(bkey);
+      istream >> copy;
+      if(!copy.isNull() && !copy->IsValid()) {
+        copy.clear();
+      }
+      _worker_keys[ptr] = KeyCopy(key, copy);
+    }
+    return _worker_keys[ptr].second;
+  }
+
+  bool BatchVerifier::Verify(const QSharedPointer<Crypto::AsymmetricKey> &key,
+      const QByteArray &data, QByteArray &msg)
+  {
+    int sig_size = key->GetSignatureLength();
+    if(data.size() < sig_size) {
+      qDebug() << "Received malsigned data block, not enough data blocks." <<
+       "Expected at least:" << sig_size << "got" << data.size();
+      return false;
+    }
+
+    msg = data.left(data.size() - sig_size);
+    QByteArray sig = QByteArray::fromRawData(data.data() + msg.size(), sig_size);
+    return key->Verify(msg, sig);
+  }
+
+  void BatchVerifier::StartBatch()
+  {
+    QList<QList<Entry> > groups;
+    QHash<const Crypto::AsymmetricKey *, int> group_by_key;
+
+    for(int idx = 0; idx < _pending.count(); idx++) {
+      Entry entry = _pending[idx];
+      entry.index = idx;
+
+      const Crypto::AsymmetricKey *key = entry.key.data();
+      int group = group_by_key.value(key, -1);
+      if(group == -1) {
+        group = groups.count();
+        group_by_key[key] = group;
+        groups.append(QList<Entry>());
+      }
+      groups[group].append(entry);
+    }
+
+    _in_flight = _pending.count();
+    _pending.clear();
+    _watcher.setFuture(QtConcurrent::mapped(groups, VerifyGroup()));
+  }
+
+  void BatchVerifier::BatchFinished()
+  {
+    const QList<QList<Entry> > groups = _watcher.future().results();
+    QVector<const Entry *> results(_in_flight);
+    for(int group = 0; group < groups.count(); group++) {
+      const QList<Entry> &entries = groups.at(group);
+      for(int idx = 0; idx < entries.count(); idx++) {
+        results[entries.at(idx).index] = &entries.at(idx);
+      }
+    }
+    _in_flight = 0;
+
+    // The handler may queue more messages, those wait for the next batch
+    foreach(const Entry *entry, results) {
+      _handler->HandleVerified(entry->from, entry->data, entry->msg, entry->valid);
+    }
+
+    if(_in_flight == 0 && !_pending.isEmpty()) {
+      StartBatch();
+    }
+  }
+}
+}
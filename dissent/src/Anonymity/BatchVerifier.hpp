@@ -0,0 +1,131 @@
+#ifndef DISSENT_ANONYMITY_BATCH_VERIFIER_H_GUARD
+#define DISSENT_ANONYMITY_BATCH_VERIFIER_H_GUARD
+
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QSharedPointer>
+
+#include "Connections/Id.hpp"
+#include "Crypto/AsymmetricKey.hpp"
+
+namespace Dissent {
+namespace Anonymity {
+  /**
+   * Verifies the signatures of incoming round messages on the global thread
+   * pool.  Messages that arrive while a batch is being verified are collected
+   * into the next batch, so that under load each batch is verified in
+   * parallel while the event loop continues to receive messages.  Keys are
+   * not thread-safe, so the workers use their own copy of each key, built
+   * from its serialized form, and messages signed by the same key are
+   * verified serially within a single task.  Results are delivered to the
+   * Handler, on the event loop, in arrival order.
+   */
+  class BatchVerifier : public QObject {
+    Q_OBJECT
+
+    public:
+      typedef Connections::Id Id;
+
+      /**
+       * Consumer of verified messages
+       */
+      class Handler {
+        public:
+          virtual ~Handler() {}
+
+          /**
+           * Called for each queued message once its signature has been
+           * checked
+           * @param from the signing peer's id
+           * @param data the data + signature blocks
+           * @param msg the data block
+           * @param valid true if the signature is valid
+           */
+          virtual void HandleVerified(const Id &from, const QByteArray &data,
+              const QByteArray &msg, bool valid) = 0;
+      };
+
+      /**
+       * Constructor
+       * @param handler where to deliver verified messages
+       */
+      explicit BatchVerifier(Handler *handler);
+
+      /**
+       * Destructor, an outstanding batch completes but is not delivered
+       */
+      virtual ~BatchVerifier() {}
+
+      /**
+       * Queues a message for verification
+       * @param from the signing peer's id
+       * @param key the signing peer's key
+       * @param data the data + signature blocks
+       */
+      void Queue(const Id &from, const QSharedPointer<Crypto::AsymmetricKey> &key,
+          const QByteArray &data);
+
+      /**
+       * Returns the number of messages awaiting delivery
+       */
+      int Pending() const { return _pending.count() + _in_flight; }
+
+      /**
+       * Verifies that the provided data has a signature block and is properly
+       * signed by key, returning the data block via msg
+       * @param key the signing peer's key
+       * @param data the data + signature blocks
+       * @param msg the data block
+       */
+      static bool Verify(const QSharedPointer<Crypto::AsymmetricKey> &key,
+          const QByteArray &data, QByteArray &msg);
+
+      /**
+       * A message and the outcome of its verification
+       */
+      struct Entry {
+        Id from;
+        QSharedPointer<Crypto::AsymmetricKey> key;
+        QByteArray data;
+        QByteArray msg;
+        bool valid;
+        /// position within its batch
+        int index;
+      };
+
+    private slots:
+      void BatchFinished();
+
+    private:
+      void StartBatch();
+
+      /**
+       * Returns the workers' copy of a key, making it on first use, or a
+       * null pointer if the key cannot be copied
+       * @param key the caller's key
+       */
+      QSharedPointer<Crypto::AsymmetricKey> GetWorkerKey(
+          const QSharedPointer<Crypto::AsymmetricKey> &key);
+
+      typedef QPair<QSharedPointer<Crypto::AsymmetricKey>,
+              QSharedPointer<Crypto::AsymmetricKey> > KeyCopy;
+
+      /**
+       * The caller's key, held so its address is not reused, and the
+       * workers' copy of it
+       */
+      QHash<const Crypto::AsymmetricKey *, KeyCopy> _worker_keys;
+
+      Handler *_handler;
+      QList<Entry> _pending;
+      int _in_flight;
+      QFutureWatcher<QList<Entry> > _watcher;
+  };
+}
+}
+
+#endif
@@ -6,6 +6,11 @@
  * Consider how to have server exchange ciphertext bits ... already know both colluding parties one needs to submit the shared secret
  */
 
+#include <string.h>
+
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
 #include "Crypto/DsaPrivateKey.hpp"
 #include "Crypto/DsaPublicKey.hpp"
 #include "Crypto/Hash.hpp"
@@ -17,6 +22,7 @@
 #include "Utils/Timer.hpp"
 #include "Utils/TimerCallback.hpp"
 #include "Utils/Utils.hpp"
+#include "Utils/Xor.hpp"
 
 #include "NeffKeyShuffleRound.hpp"
 #include "NeffShuffleRound.hpp"
@@ -35,17 +41,49 @@ namespace Dissent {
   using Utils::Serialization;
 
 namespace Anonymity {
+  namespace {
+    /**
+     * Xors the pads for a contiguous range of RNGs into a partial
+     * ciphertext, useful for QtConcurrent
+     */
+    struct PadGenerator {
+      PadGenerator(CryptoRandom *rngs, int length) :
+        _rngs(rngs), _length(length)
+      {
+      }
+
+      typedef QByteArray result_type;
+
+      QByteArray operator()(const QPair<int, int> &range) const
+      {
+        QByteArray xor_msg(_length, 0);
+        for(int idx = range.first; idx < range.second; idx++) {
+          _rngs[idx].XorBlock(xor_msg);
+        }
+        return xor_msg;
+      }
+
+      CryptoRandom *_rngs;
+      const int _length;
+    };
+  }
+
+  int CSDCNetRound::PhaseLogRetention = 5;
+
   CSDCNetRound::CSDCNetRound(const Identity::Roster &clients,
       const Identity::Roster &servers,
       const Identity::PrivateIdentity &ident,
       const QByteArray &nonce,
       const QSharedPointer<ClientServer::Overlay> &overlay,
       Messaging::GetDataCallback &get_data,
-      CreateRound create_shuffle) :
+      CreateRound create_shuffle,
+      int fanout) :
     BaseDCNetRound(clients, servers, ident, nonce, overlay, get_data, create_shuffle),
     _state_machine(this),
     _stop_next(false),
-    _get_blame_data(this, &CSDCNetRound::GetBlameData)
+    _get_blame_data(this, &CSDCNetRound::GetBlameData),
+    _fanout(qMax(fanout, 0)),
+    _parent_server(Connections::Id::Zero())
   {
     _state_machine.AddState(OFFLINE);
     _state_machine.AddState(SHUFFLING, -1, 0, &CSDCNetRound::StartShuffle);
@@ -77,6 +115,7 @@ namespace Anonymity {
         WAITING_FOR_BLAME_SHUFFLE);
     _state_machine.SetState(OFFLINE);
 
+    InitServerTree();
     if(IsServer()) {
       InitServer();
     } else {
@@ -126,6 +165,86 @@ namespace Anonymity {
     _state->blame_shuffle->SetSink(&_blame_sink);
   }
 
+  void CSDCNetRound::InitServerTree()
+  {
+    int count = GetServers().Count();
+    int roots = _fanout == 0 ? count : qMin(_fanout, count);
+    for(int idx = 0; idx < roots; idx++) {
+      _root_servers.append(GetServers().GetId(idx));
+    }
+
+    if(!IsServer()) {
+      return;
+    }
+
+    int sidx = GetServers().GetIndex(GetLocalId());
+    int parent = GetParentIndex(sidx);
+    if(parent != -1) {
+      _parent_server = GetServers().GetId(parent);
+    }
+
+    QList<int> subtree = GetSubtreeIndexes(sidx);
+    for(int idx = 1; idx < subtree.count(); idx++) {
+      if(GetParentIndex(subtree[idx]) == sidx) {
+        _child_servers.append(GetServers().GetId(subtree[idx]));
+      }
+    }
+  }
+
+  int CSDCNetRound::GetParentIndex(int sidx) const
+  {
+    if(_fanout == 0 || sidx < _fanout) {
+      return -1;
+    }
+    return (sidx / _fanout) - 1;
+  }
+
+  QList<int> CSDCNetRound::GetSubtreeIndexes(int sidx) const
+  {
+    QList<int> subtree;
+    subtree.append(sidx);
+    if(_fanout == 0) {
+      return subtree;
+    }
+
+    int count = GetServers().Count();
+    for(int idx = 0; idx < subtree.count(); idx++) {
+      int first = (subtree[idx] + 1) * _fanout;
+      for(int child = first; child < qMin(first + _fanout, count); child++) {
+        subtree.append(child);
+      }
+    }
+    return subtree;
+  }
+
+  QList<Connections::Id> CSDCNetRound::GetCiphertextSenders(int sidx) const
+  {
+    QList<Connections::Id> senders;
+    if(GetParentIndex(sidx) == -1) {
+      senders = _root_servers;
+    }
+
+    QList<int> subtree = GetSubtreeIndexes(sidx);
+    for(int idx = 1; idx < subtree.count(); idx++) {
+      if(GetParentIndex(subtree[idx]) == sidx) {
+        senders.append(GetServers().GetId(subtree[idx]));
+      }
+    }
+    return senders;
+  }
+
+  QByteArray CSDCNetRound::GetCiphertextHash(int phase,
+      const QByteArray &ciphertext) const
+  {
+    Hash hashalgo;
+    QByteArray bphase(4, 0);
+    Serialization::WriteInt(phase, bphase, 0);
+    hashalgo.Update(GetNonce());
+    hashalgo.Update(bphase);
+    hashalgo.Update(ciphertext);
+    return hashalgo.ComputeHash();
+  }
+
   void CSDCNetRound::InitServer()
   {
     _server_state = QSharedPointer<ServerState>(new ServerState());
@@ -186,10 +305,55 @@ namespace Anonymity {
 
     _state_machine.AddTransition(PREPARE_FOR_BULK,
         SERVER_WAIT_FOR_CLIENT_CIPHERTEXT);
-    _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
-        SERVER_WAIT_FOR_CLIENT_LISTS);
-    _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_LISTS,
-        SERVER_WAIT_FOR_SERVER_COMMITS);
+
+    if(!HasServerTree()) {
+      _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
+          SERVER_WAIT_FOR_CLIENT_LISTS);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_LISTS,
+          SERVER_WAIT_FOR_SERVER_COMMITS);
+    } else if(_parent_server == Connections::Id::Zero()) {
+      // The root layer runs the exchange on behalf of its subtrees
+      _state_machine.AddState(SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS,
+          SERVER_SUBTREE_CLIENT_LIST, &CSDCNetRound::HandleSubtreeClientList,
+          &CSDCNetRound::CollectSubtreeClientLists);
+      _state_machine.AddState(SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT,
+          SERVER_SUBTREE_CIPHERTEXT, &CSDCNetRound::HandleSubtreeCiphertext,
+          &CSDCNetRound::SubmitOnlineClients);
+
+      _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
+          SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS,
+          SERVER_WAIT_FOR_CLIENT_LISTS);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_LISTS,
+          SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT,
+          SERVER_WAIT_FOR_SERVER_COMMITS);
+    } else {
+      _state_machine.AddState(SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS,
+          SERVER_SUBTREE_CLIENT_LIST, &CSDCNetRound::HandleSubtreeClientList,
+          &CSDCNetRound::CollectSubtreeClientLists);
+      _state_machine.AddState(SERVER_WAIT_FOR_ONLINE_CLIENTS,
+          SERVER_ONLINE_CLIENTS, &CSDCNetRound::HandleOnlineClients,
+          &CSDCNetRound::SubmitSubtreeClientList);
+      _state_machine.AddState(SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT,
+          SERVER_SUBTREE_CIPHERTEXT, &CSDCNetRound::HandleSubtreeCiphertext,
+          &CSDCNetRound::SubmitOnlineClients);
+      _state_machine.AddState(SERVER_WAIT_FOR_SUBTREE_CLEARTEXT,
+          SERVER_CLEARTEXT, &CSDCNetRound::HandleSubtreeCleartext,
+          &CSDCNetRound::SubmitSubtreeCiphertext);
+
+      _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
+          SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS,
+          SERVER_WAIT_FOR_ONLINE_CLIENTS);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_ONLINE_CLIENTS,
+          SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT,
+          SERVER_WAIT_FOR_SUBTREE_CLEARTEXT);
+      _state_machine.AddTransition(SERVER_WAIT_FOR_SUBTREE_CLEARTEXT,
+          SERVER_PUSH_CLEARTEXT);
+    }
+
     _state_machine.AddTransition(SERVER_WAIT_FOR_SERVER_COMMITS,
         SERVER_WAIT_FOR_SERVER_CIPHERTEXT);
     _state_machine.AddTransition(SERVER_WAIT_FOR_SERVER_CIPHERTEXT,
@@ -307,12 +471,13 @@ namespace Anonymity {
   {
     if(_server_state) {
       _server_state->handled_clients.fill(false, GetClients().Count());
-      _server_state->client_ciphertexts.clear();
       _server_state->server_ciphertexts.clear();
+      _server_state->current_phase_log->Retire();
 
       int nphase = _state_machine.GetPhase() + 1;
-      if(nphase >= 5) {
-        Q_ASSERT(_server_state->phase_logs.remove(nphase - 5));
+      int expired = nphase - qMax(PhaseLogRetention, 1);
+      if(expired >= 0) {
+        _server_state->phase_logs.remove(expired);
       }
       _server_state->current_phase_log =
         QSharedPointer<PhaseLog>(
@@ -371,22 +536,9 @@ namespace Anonymity {
           QString::number(_state->msg_length));
     }
 
-    Hash hash;
-    hash.Update(cleartext);
-
-    QByteArray data;
-    QDataStream tstream(&data, QIODevice::WriteOnly);
-    tstream << online;
-    hash.Update(data);
-
-    QByteArray signed_hash = hash.ComputeHash();
-
-    int server_length = GetServers().Count();
-    for(int idx = 0; idx < server_length; idx++) {
-      if(!GetServers().GetKey(idx)->Verify(signed_hash, signatures[idx])) {
-        Stop("Failed to verify signatures");
-        return;
-      }
+    if(!VerifyCleartext(signatures, cleartext, online)) {
+      Stop("Failed to verify signatures");
+      return;
     }
 
     _state->cleartext = cleartext;
@@ -424,20 +576,17 @@ namespace Anonymity {
     }
 
     _server_state->handled_clients[idx] = true;
-    _server_state->client_ciphertexts.append(QPair<int, QByteArray>(idx, payload));
-    _server_state->current_phase_log->messages[idx] = payload;
+    _server_state->current_phase_log->SetClientCiphertext(idx, payload);
+    int submitted = _server_state->current_phase_log->GetSubmittedCount();
 
     qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
       ": received client ciphertext from" << GetClients().GetIndex(from) <<
-      from.ToString() << "Have" << _server_state->client_ciphertexts.count()
+      from.ToString() << "Have" << submitted
       << "expecting" << _server_state->allowed_clients.count();
 
-    if(_server_state->allowed_clients.count() ==
-        _server_state->client_ciphertexts.count())
-    {
+    if(_server_state->allowed_clients.count() == submitted) {
       _state_machine.StateComplete();
-    } else if(_server_state->client_ciphertexts.count() ==
-        _server_state->expected_clients)
+    } else if(submitted == _server_state->expected_clients)
     {
       // Start the flexible deadline
       _server_state->client_ciphertext_period.Stop();
@@ -453,9 +602,31 @@ namespace Anonymity {
     }
   }
 
+  bool CSDCNetRound::VerifyCleartext(const QHash<int, QByteArray> &signatures,
+      const QByteArray &cleartext, const QBitArray &online) const
+  {
+    Hash hash;
+    hash.Update(cleartext);
+
+    QByteArray data;
+    QDataStream tstream(&data, QIODevice::WriteOnly);
+    tstream << online;
+    hash.Update(data);
+
+    QByteArray signed_hash = hash.ComputeHash();
+
+    foreach(const Connections::Id &id, _root_servers) {
+      int idx = GetServers().GetIndex(id);
+      if(!GetServers().GetKey(idx)->Verify(signed_hash, signatures[idx])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   void CSDCNetRound::HandleServerClientList(const Connections::Id &from, QDataStream &stream)
   {
-    if(!GetOverlay()->IsServer(from)) {
+    if(!_root_servers.contains(from)) {
       throw QRunTimeError("Not a server");
     }
 
@@ -483,18 +654,149 @@ namespace Anonymity {
     qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
       ": received client list from" << GetServers().GetIndex(from) <<
       from.ToString() << "Have" << _server_state->handled_servers.count()
-      << "expecting" << GetServers().Count();
+      << "expecting" << _root_servers.count();
+
+    if(_server_state->handled_servers.count() == _root_servers.count()) {
+      _state_machine.StateComplete();
+    }
+  }
+
+  void CSDCNetRound::HandleSubtreeClientList(const Connections::Id &from, QDataStream &stream)
+  {
+    if(!_child_servers.contains(from)) {
+      throw QRunTimeError("Not a child server");
+    }
+
+    Q_ASSERT(_server_state);
 
-    if(_server_state->handled_servers.count() == GetServers().Count()) {
+    if(_server_state->handled_servers.contains(from)) {
+      throw QRunTimeError("Already have client list");
+    }
+
+    QBitArray clients;
+    stream >> clients;
+
+    if(clients.size() != GetClients().Count()) {
+      throw QRunTimeError("Incorrect client list length, got " +
+          QString::number(clients.size()) + " expected " +
+          QString::number(GetClients().Count()));
+    }
+
+    _server_state->handled_clients |= clients;
+    _server_state->handled_servers.insert(from);
+
+    qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
+      ": received subtree client list from" << GetServers().GetIndex(from) <<
+      from.ToString() << "Have" << _server_state->handled_servers.count()
+      << "expecting" << _child_servers.count();
+
+    if(_server_state->handled_servers.count() == _child_servers.count()) {
       _state_machine.StateComplete();
     }
   }
 
+  void CSDCNetRound::HandleOnlineClients(const Connections::Id &from, QDataStream &stream)
+  {
+    if(from != _parent_server) {
+      throw QRunTimeError("Not the parent server");
+    }
+
+    Q_ASSERT(_server_state);
+
+    QBitArray online;
+    stream >> online;
+
+    if(online.size() != GetClients().Count()) {
+      throw QRunTimeError("Incorrect client list length, got " +
+          QString::number(online.size()) + " expected " +
+          QString::number(GetClients().Count()));
+    } else if((online & _server_state->handled_clients) !=
+        _server_state->handled_clients)
+    {
+      throw QRunTimeError("Online clients omit this subtree");
+    }
+
+    _server_state->handled_clients = online;
+    _state_machine.StateComplete();
+  }
+
+  void CSDCNetRound::HandleSubtreeCiphertext(const Connections::Id &from, QDataStream &stream)
+  {
+    if(!_child_servers.contains(from)) {
+      throw QRunTimeError("Not a child server");
+    }
+
+    Q_ASSERT(_server_state);
+
+    if(_server_state->handled_servers.contains(from)) {
+      throw QRunTimeError("Already have ciphertext");
+    }
+
+    QByteArray ciphertext, signature;
+    stream >> ciphertext >> signature;
+
+    if(ciphertext.size() != _server_state->msg_length) {
+      throw QRunTimeError("Incorrect message length, got " +
+          QString::number(ciphertext.size()) + " expected " +
+          QString::number(_server_state->msg_length));
+    }
+
+    QByteArray hash = GetCiphertextHash(_state_machine.GetPhase(), ciphertext);
+    if(!GetServers().GetKey(from)->Verify(hash, signature)) {
+      throw QRunTimeError("Signature doesn't match.");
+    }
+
+    Xor(_server_state->my_ciphertext, _server_state->my_ciphertext, ciphertext);
+    _server_state->handled_servers.insert(from);
+    _server_state->current_phase_log->server_messages[from] = ciphertext;
+    _server_state->current_phase_log->server_signatures[from] = signature;
+
+    qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
+      ": received subtree ciphertext from" << GetServers().GetIndex(from) <<
+      from.ToString() << "Have" << _server_state->handled_servers.count()
+      << "expecting" << _child_servers.count();
+
+    if(_server_state->handled_servers.count() == _child_servers.count()) {
+      _state_machine.StateComplete();
+    }
+  }
+
+  void CSDCNetRound::HandleSubtreeCleartext(const Connections::Id &from, QDataStream &stream)
+  {
+    if(from != _parent_server) {
+      throw QRunTimeError("Not the parent server");
+    }
+
+    Q_ASSERT(_server_state);
+
+    QHash<int, QByteArray> signatures;
+    QByteArray cleartext;
+    QBitArray online;
+    stream >> signatures >> cleartext >> online;
+
+    if(cleartext.size() != _state->msg_length) {
+      throw QRunTimeError("Cleartext size mismatch: " +
+          QString::number(cleartext.size()) + " :: " +
+          QString::number(_state->msg_length));
+    } else if(online != _server_state->handled_clients) {
+      throw QRunTimeError("Online clients mismatch");
+    }
+
+    if(!VerifyCleartext(signatures, cleartext, online)) {
+      Stop("Failed to verify signatures");
+      return;
+    }
+
+    _server_state->signatures = signatures;
+    _state->cleartext = cleartext;
+    _state_machine.StateComplete();
+  }
+
   void CSDCNetRound::HandleServerCommit(const Connections::Id &from, QDataStream &stream)
   {
     if(!IsServer()) {
       throw QRunTimeError("Not a server");
-    } else if(!GetServers().Contains(from)) {
+    } else if(!_root_servers.contains(from)) {
       throw QRunTimeError("Not a server");
     }
 
@@ -513,9 +815,9 @@ namespace Anonymity {
     qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
       ": received commit from" << GetServers().GetIndex(from) <<
       from.ToString() << "Have" << _server_state->handled_servers.count()
-      << "expecting" << GetServers().Count();
+      << "expecting" << _root_servers.count();
 
-    if(_server_state->handled_servers.count() == GetServers().Count()) {
+    if(_server_state->handled_servers.count() == _root_servers.count()) {
       _state_machine.StateComplete();
     }
   }
@@ -524,7 +826,7 @@ namespace Anonymity {
   {
     if(!IsServer()) {
       throw QRunTimeError("Not a server");
-    } else if(!GetServers().Contains(from)) {
+    } else if(!_root_servers.contains(from)) {
       throw QRunTimeError("Not a server");
     }
 
@@ -551,16 +853,30 @@ namespace Anonymity {
       throw QRunTimeError("Does not match commit.");
     }
 
+    // With a server tree, blame republishes this ciphertext to the servers
+    // outside the root layer
+    QByteArray signature;
+    if(HasServerTree()) {
+      stream >> signature;
+      QByteArray hash = GetCiphertextHash(_state_machine.GetPhase(), ciphertext);
+      if(!GetServers().GetKey(from)->Verify(hash, signature)) {
+        throw QRunTimeError("Signature doesn't match.");
+      }
+    }
+
     _server_state->handled_servers.insert(from);
     _server_state->server_ciphertexts[GetServers().GetIndex(from)] = ciphertext;
     _server_state->current_phase_log->server_messages[from] = ciphertext;
+    if(HasServerTree()) {
+      _server_state->current_phase_log->server_signatures[from] = signature;
+    }
 
     qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
       ": received ciphertext from" << GetServers().GetIndex(from) <<
       from.ToString() << "Have" << _server_state->handled_servers.count()
-      << "expecting" << GetServers().Count();
+      << "expecting" << _root_servers.count();
 
-    if(_server_state->handled_servers.count() == GetServers().Count()) {
+    if(_server_state->handled_servers.count() == _root_servers.count()) {
       _state_machine.StateComplete();
     }
   }
@@ -569,7 +885,7 @@ namespace Anonymity {
   {
     if(!IsServer()) {
       throw QRunTimeError("Not a server");
-    } else if(!GetServers().Contains(from)) {
+    } else if(!_root_servers.contains(from)) {
       throw QRunTimeError("Not a server");
     }
 
@@ -594,9 +910,9 @@ namespace Anonymity {
     qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
       ": received validation from" << GetServers().GetIndex(from) <<
       from.ToString() << "Have" << _server_state->handled_servers.count()
-      << "expecting" << GetServers().Count();
+      << "expecting" << _root_servers.count();
 
-    if(_server_state->handled_servers.count() == GetServers().Count()) {
+    if(_server_state->handled_servers.count() == _root_servers.count()) {
       _state_machine.StateComplete();
     }
   }
@@ -618,20 +934,28 @@ namespace Anonymity {
     QPair<QBitArray, QBitArray> blame_bits;
     stream >> blame_bits;
 
-    char expected =
-      _server_state->phase_logs[_server_state->current_blame.third]->
-      GetBitAtIndex(from, _server_state->current_blame.second);
-
-    char actual = 0;
-    for(int idx = 0; idx < blame_bits.first.size(); idx++) {
-      actual ^= blame_bits.first[idx];
-    }
-    for(int idx = 0; idx < blame_bits.second.size(); idx++) {
-      actual ^= blame_bits.second[idx];
-    }
+    // Servers in a tree are checked against the ciphertexts their receivers
+    // republish, once every server has sent its bits
+    const QSharedPointer<PhaseLog> &log =
+      _server_state->phase_logs[_server_state->current_blame.third];
+    if(HasServerTree()) {
+      QHash<Connections::Id, QPair<QByteArray, QByteArray> > published;
+      stream >> published;
+      ReadPublishedCiphertexts(from, published);
+    } else if(log->server_messages.contains(from)) {
+      char expected = log->GetBitAtIndex(from, _server_state->current_blame.second);
+
+      char actual = 0;
+      for(int idx = 0; idx < blame_bits.first.size(); idx++) {
+        actual ^= blame_bits.first[idx];
+      }
+      for(int idx = 0; idx < blame_bits.second.size(); idx++) {
+        actual ^= blame_bits.second[idx];
+      }
 
-    if(actual != expected) {
-      throw QRunTimeError("Blame bits do not match what was sent");
+      if(actual != expected) {
+        throw QRunTimeError("Blame bits do not match what was sent");
+      }
     }
 
     _server_state->blame_bits[from] = blame_bits;
@@ -642,6 +966,16 @@ namespace Anonymity {
       << "expecting" << GetServers().Count();
 
     if(_server_state->blame_bits.count() == GetServers().Count()) {
+      if(HasServerTree()) {
+        Connections::Id bad = FindSubtreeMismatch();
+        if(bad != Connections::Id::Zero()) {
+          qDebug() << "Blame bits do not match the ciphertext sent by" <<
+            GetServers().GetIndex(bad) << bad;
+          _server_state->bad_dude = bad;
+          _state_machine.SetState(SERVER_EXCHANGE_VERDICT_SIGNATURE);
+          return;
+        }
+      }
       _state_machine.StateComplete();
     }
   }
@@ -682,10 +1016,9 @@ namespace Anonymity {
         int accuse_idx = _server_state->current_blame.second;
         int byte_idx = accuse_idx / 8;
         int bit_idx = accuse_idx % 8;
-        QByteArray tmp(byte_idx + 1, 0);
-        CryptoRandom(seed).GenerateBlock(tmp);
+        char pad_byte = GetPadByte(seed, byte_idx);
 
-        if(((tmp[byte_idx] & bit_masks[bit_idx % 8]) != 0) == _server_state->server_bits[rebuttal.first]) {
+        if(((pad_byte & bit_masks[bit_idx % 8]) != 0) == _server_state->server_bits[rebuttal.first]) {
           _server_state->bad_dude = from;
           qDebug() << "Client misbehaves:" << from;
         } else {
@@ -928,13 +1261,16 @@ namespace Anonymity {
       roster = GetServers();
     }
 
+    // Our own entry is left empty, producing an empty seed
+    QVector<QByteArray> remote_pubs;
     foreach(const PublicIdentity &gc, roster) {
-      if(gc.GetId() == GetLocalId()) {
-        _state->base_seeds.append(QByteArray());
-        continue;
-      }
-      QByteArray base_seed =
-        GetPrivateIdentity().GetDhKey().GetSharedSecret(gc.GetDhKey());
+      remote_pubs.append(gc.GetId() == GetLocalId() ?
+          QByteArray() : gc.GetDhKey());
+    }
+
+    QVector<QByteArray> base_seeds =
+      GetPrivateIdentity().GetDhKey().GetSharedSecrets(remote_pubs);
+    foreach(const QByteArray &base_seed, base_seeds) {
       _state->base_seeds.append(base_seed);
     }
   }
@@ -961,14 +1297,26 @@ namespace Anonymity {
       }
     }
 
-    foreach(const QByteArray &base_seed, seeds) {
+    if(IsServer()) {
+      _server_state->current_phase_log->pad_length = _state->msg_length;
+    }
+
+    for(int idx = 0; idx < seeds.size(); idx++) {
+      const QByteArray &base_seed = seeds[idx];
       if(base_seed.isEmpty()) {
         continue;
       }
       hashalgo.Update(base_seed);
       hashalgo.Update(phase);
       hashalgo.Update(GetNonce());
-      _state->anonymous_rngs.append(CryptoRandom(hashalgo.ComputeHash()));
+      QByteArray seed = hashalgo.ComputeHash();
+      _state->anonymous_rngs.append(CryptoRandom(seed, PAD_GENERATOR));
+
+      // Servers only keep the seed, blame regenerates the pad if needed
+      if(IsServer()) {
+        int gidx = _server_state->rng_to_gidx[idx];
+        _server_state->current_phase_log->my_sub_seeds[gidx] = seed;
+      }
     }
   }
 
@@ -987,16 +1335,13 @@ namespace Anonymity {
   QByteArray CSDCNetRound::GenerateCiphertext()
   {
     QByteArray xor_msg(_state->msg_length, 0);
-    QByteArray tmsg(_state->msg_length, 0);
-    
-    int idx = 0;
-    for(int jdx = 0; jdx < _state->anonymous_rngs.size(); jdx++) {
-      _state->anonymous_rngs[jdx].GenerateBlock(tmsg);
-      if(IsServer()) {
-        int gidx = _server_state->rng_to_gidx[idx++];
-        _server_state->current_phase_log->my_sub_ciphertexts[gidx] = tmsg;
+
+    if(IsServer() && Utils::MultiThreading) {
+      GenerateServerPads(xor_msg);
+    } else {
+      for(int idx = 0; idx < _state->anonymous_rngs.size(); idx++) {
+        _state->anonymous_rngs[idx].XorBlock(xor_msg);
       }
-      Xor(xor_msg, xor_msg, tmsg);
     }
 
     if(_state->slot_open) {
@@ -1037,6 +1382,34 @@ namespace Anonymity {
     return xor_msg;
   }
 
+  void CSDCNetRound::GenerateServerPads(QByteArray &xor_msg)
+  {
+    int count = _state->anonymous_rngs.size();
+    if(count == 0) {
+      return;
+    }
+
+    int workers = qBound(1, QThreadPool::globalInstance()->maxThreadCount(), count);
+    int per_worker = count / workers;
+    int remainder = count % workers;
+
+    QList<QPair<int, int> > ranges;
+    int start = 0;
+    for(int widx = 0; widx < workers; widx++) {
+      int end = start + per_worker + (widx < remainder ? 1 : 0);
+      ranges.append(QPair<int, int>(start, end));
+      start = end;
+    }
+
+    // Detach here, so that the workers do not race on the copy-on-write
+    CryptoRandom *rngs = _state->anonymous_rngs.data();
+    QFuture<QByteArray> result = QtConcurrent::mapped(ranges,
+        PadGenerator(rngs, _state->msg_length));
+    result.waitForFinished();
+
+    Utils::XorMany(xor_msg, result.results());
+  }
+
   bool CSDCNetRound::CheckData()
   {
     if(!_state->next_msg.isEmpty()) {
@@ -1112,6 +1485,10 @@ namespace Anonymity {
     }
 #endif
 
+    // Only the clients connected to this server submit here
+    _server_state->current_phase_log->Reserve(
+        _server_state->allowed_clients.count(), _server_state->msg_length);
+
     if(_server_state->allowed_clients.count() == 0) {
       _state_machine.StateComplete();
       return;
@@ -1144,10 +1521,27 @@ namespace Anonymity {
     stream << SERVER_CLIENT_LIST << GetNonce() <<
       _state_machine.GetPhase() << _server_state->handled_clients;
 
-    VerifiableBroadcastToServers(payload);
+    VerifiableSend(_root_servers, payload);
   }
 
-  void CSDCNetRound::SubmitCommit()
+  void CSDCNetRound::CollectSubtreeClientLists()
+  {
+    if(_child_servers.isEmpty()) {
+      _state_machine.StateComplete();
+    }
+  }
+
+  void CSDCNetRound::SubmitSubtreeClientList()
+  {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << SERVER_SUBTREE_CLIENT_LIST << GetNonce() <<
+      _state_machine.GetPhase() << _server_state->handled_clients;
+
+    VerifiableSend(_parent_server, payload);
+  }
+
+  void CSDCNetRound::SubmitOnlineClients()
   {
     SetupRngs();
 
@@ -1156,27 +1550,65 @@ namespace Anonymity {
 
     GenerateServerCiphertext();
 
+    if(_child_servers.isEmpty()) {
+      _state_machine.StateComplete();
+      return;
+    }
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << SERVER_ONLINE_CLIENTS << GetNonce() <<
+      _state_machine.GetPhase() << _server_state->handled_clients;
+
+    VerifiableSend(_child_servers, payload);
+  }
+
+  void CSDCNetRound::SubmitSubtreeCiphertext()
+  {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << SERVER_SUBTREE_CIPHERTEXT << GetNonce() <<
+      _state_machine.GetPhase() << _server_state->my_ciphertext <<
+      GetKey()->Sign(GetCiphertextHash(_state_machine.GetPhase(),
+            _server_state->my_ciphertext));
+
+    VerifiableSend(_parent_server, payload);
+  }
+
+  void CSDCNetRound::SubmitCommit()
+  {
+    if(HasServerTree()) {
+      // Already holds the xor of the subtree's ciphertexts
+      _server_state->my_commit = Hash().ComputeHash(_server_state->my_ciphertext);
+    } else {
+      SetupRngs();
+
+      qDebug() << ToString() << "generating ciphertext for" <<
+        _state->anonymous_rngs.count() << "out of" << GetClients().Count();
+
+      GenerateServerCiphertext();
+    }
+
     QByteArray payload;
     QDataStream stream(&payload, QIODevice::WriteOnly);
     stream << SERVER_COMMIT << GetNonce() <<
       _state_machine.GetPhase() << _server_state->my_commit;
 
-    VerifiableBroadcastToServers(payload);
+    VerifiableSend(_root_servers, payload);
   }
 
   void CSDCNetRound::GenerateServerCiphertext()
   {
     QByteArray ciphertext = GenerateCiphertext();
-    for(int lidx = 0; lidx < _server_state->client_ciphertexts.size(); lidx++) {
-      const QPair<int, QByteArray> &entry = _server_state->client_ciphertexts[lidx];
-      int idx = entry.first;
-      const QByteArray &text = entry.second;
-
+    const QSharedPointer<PhaseLog> &log = _server_state->current_phase_log;
+    QList<QByteArray> texts;
+    foreach(int idx, log->GetSubmittedClients()) {
       if(!_server_state->handled_clients.at(idx)) {
         continue;
       }
-      Xor(ciphertext, ciphertext, text);
+      texts.append(log->GetClientCiphertext(idx));
     }
+    Utils::XorMany(ciphertext, texts);
 
     QBitArray open(GetClients().Count(), false);
     for(int idx = 0; idx < _state->next_messages.size(); idx++) {
@@ -1193,17 +1625,18 @@ namespace Anonymity {
     QDataStream stream(&payload, QIODevice::WriteOnly);
     stream << SERVER_CIPHERTEXT << GetNonce() <<
       _state_machine.GetPhase() << _server_state->my_ciphertext;
+    if(HasServerTree()) {
+      stream << GetKey()->Sign(GetCiphertextHash(_state_machine.GetPhase(),
+            _server_state->my_ciphertext));
+    }
 
-    VerifiableBroadcastToServers(payload);
+    VerifiableSend(_root_servers, payload);
   }
 
   void CSDCNetRound::SubmitValidation()
   {
     QByteArray cleartext(_state->msg_length, 0);
-
-    foreach(const QByteArray &ciphertext, _server_state->server_ciphertexts) {
-      Xor(cleartext, cleartext, ciphertext);
-    }
+    Utils::XorMany(cleartext, _server_state->server_ciphertexts.values());
 
     _state->cleartext = cleartext;
     Hash hash;
@@ -1225,7 +1658,7 @@ namespace Anonymity {
     stream << SERVER_VALIDATION << GetNonce() <<
       _state_machine.GetPhase() << signature;
 
-    VerifiableBroadcastToServers(payload);
+    VerifiableSend(_root_servers, payload);
   }
 
   void CSDCNetRound::PushCleartext()
@@ -1236,6 +1669,9 @@ namespace Anonymity {
       << _server_state->signatures << _server_state->cleartext <<
       _server_state->handled_clients;
 
+    if(!_child_servers.isEmpty()) {
+      VerifiableSend(_child_servers, payload);
+    }
     VerifiableBroadcastToClients(payload);
     ProcessCleartext();
     if(_state->start_accuse) {
@@ -1317,14 +1753,26 @@ namespace Anonymity {
 
   void CSDCNetRound::TransmitBlameBits()
   {
+    const QSharedPointer<PhaseLog> &log =
+      _server_state->phase_logs[_server_state->current_blame.third];
     QPair<QBitArray, QBitArray> bits =
-      _server_state->phase_logs[_server_state->current_blame.third]->
-      GetBitsAtIndex(_server_state->current_blame.second);
+      log->GetBitsAtIndex(_server_state->current_blame.second);
 
     QByteArray payload;
     QDataStream stream(&payload, QIODevice::WriteOnly);
     stream << SERVER_BLAME_BITS << GetNonce() <<
       _state_machine.GetPhase() << bits;
+
+    // Only the receivers of a ciphertext in the tree hold it, so they
+    // republish it with its sender's signature
+    if(HasServerTree()) {
+      QHash<Connections::Id, QPair<QByteArray, QByteArray> > published;
+      foreach(const Connections::Id &id, log->server_messages.keys()) {
+        published[id] = QPair<QByteArray, QByteArray>(
+            log->server_messages[id], log->server_signatures[id]);
+      }
+      stream << published;
+    }
     VerifiableBroadcastToServers(payload);
     _state_machine.StateComplete();
   }
@@ -1609,6 +2057,271 @@ namespace Anonymity {
     return random_text;
   }
 
+  char CSDCNetRound::GetPadByte(const QByteArray &seed, int offset)
+  {
+    CryptoRandom rng(seed, PAD_GENERATOR);
+    if(rng.Seek(offset)) {
+      QByteArray tmp(1, 0);
+      rng.GenerateBlock(tmp);
+      return tmp[0];
+    }
+
+    QByteArray tmp(offset + 1, 0);
+    rng.GenerateBlock(tmp);
+    return tmp[offset];
+  }
+
+  CSDCNetRound::PhaseLog::PhaseLog(int phase, int max) :
+    pad_length(0),
+    phase(phase),
+    _max(max),
+    _expected(0),
+    _ciphertext_length(-1),
+    _slots_per_chunk(1),
+    _spill_map(0)
+  {
+  }
+
+  CSDCNetRound::PhaseLog::~PhaseLog()
+  {
+    if(_spill_map) {
+      _spill->unmap(_spill_map);
+    }
+  }
+
+  void CSDCNetRound::PhaseLog::SetCiphertextLength(int length)
+  {
+    _ciphertext_length = length;
+    _slots_per_chunk = qMax(1, CHUNK_SIZE / qMax(length, 1));
+  }
+
+  void CSDCNetRound::PhaseLog::Reserve(int count, int length)
+  {
+    if(!_slots.isEmpty()) {
+      return;
+    }
+
+    SetCiphertextLength(length);
+    _expected = count;
+  }
+
+  char *CSDCNetRound::PhaseLog::GetSlotData(int slot)
+  {
+    if(_spill_map) {
+      return reinterpret_cast<char *>(_spill_map) +
+        qint64(slot) * _ciphertext_length;
+    }
+    return _chunks[slot / _slots_per_chunk].data() +
+      (slot % _slots_per_chunk) * _ciphertext_length;
+  }
+
+  const char *CSDCNetRound::PhaseLog::GetSlotData(int slot) const
+  {
+    if(_spill_map) {
+      return reinterpret_cast<const char *>(_spill_map) +
+        qint64(slot) * _ciphertext_length;
+    }
+    return _chunks[slot / _slots_per_chunk].constData() +
+      (slot % _slots_per_chunk) * _ciphertext_length;
+  }
+
+  void CSDCNetRound::PhaseLog::SetClientCiphertext(int idx,
+      const QByteArray &ciphertext)
+  {
+    if(_slots.isEmpty() && ciphertext.size() != _ciphertext_length) {
+      SetCiphertextLength(ciphertext.size());
+    } else if(ciphertext.size() != _ciphertext_length) {
+      throw QRunTimeError("Ciphertext length differs from the rest of the phase");
+    }
+
+    if(_slots.contains(idx)) {
+      memcpy(GetSlotData(_slots[idx]), ciphertext.constData(),
+          _ciphertext_length);
+      return;
+    }
+
+    if(_spill_map) {
+      // A late addition to a retired phase
+      Unspill();
+    }
+
+    int slot = _slots.count();
+    if(slot % _slots_per_chunk == 0) {
+      // Bounded by CHUNK_SIZE, or a single ciphertext, so this cannot overflow
+      int wanted = qBound(1, _expected - slot, _slots_per_chunk);
+      _chunks.append(QByteArray());
+      _chunks.last().reserve(wanted * _ciphertext_length);
+    }
+
+    _chunks.last().append(ciphertext);
+    _slots[idx] = slot;
+  }
+
+  QByteArray CSDCNetRound::PhaseLog::GetClientCiphertext(int idx) const
+  {
+    if(!_slots.contains(idx)) {
+      return QByteArray();
+    }
+    return QByteArray::fromRawData(GetSlotData(_slots[idx]),
+        _ciphertext_length);
+  }
+
+  void CSDCNetRound::PhaseLog::Retire()
+  {
+    qint64 total = qint64(_slots.count()) * _ciphertext_length;
+    if(_spill_map || total < SPILL_SIZE) {
+      return;
+    }
+
+    QScopedPointer<QTemporaryFile> spill(new QTemporaryFile());
+    if(!spill->open()) {
+      qWarning() << "Unable to spill phase log" << phase << "to disk";
+      return;
+    }
+
+    foreach(const QByteArray &chunk, _chunks) {
+      if(spill->write(chunk) != chunk.size()) {
+        qWarning() << "Unable to spill phase log" << phase << "to disk";
+        return;
+      }
+    }
+
+    if(!spill->flush()) {
+      qWarning() << "Unable to spill phase log" << phase << "to disk";
+      return;
+    }
+
+    uchar *map = spill->map(0, total);
+    if(!map) {
+      qWarning() << "Unable to map phase log" << phase;
+      return;
+    }
+
+    _spill.swap(spill);
+    _spill_map = map;
+    _chunks.clear();
+  }
+
+  void CSDCNetRound::PhaseLog::Unspill()
+  {
+    int count = _slots.count();
+    for(int slot = 0; slot < count; slot += _slots_per_chunk) {
+      int slots = qMin(_slots_per_chunk, count - slot);
+      _chunks.append(QByteArray(GetSlotData(slot), slots * _ciphertext_length));
+    }
+
+    _spill->unmap(_spill_map);
+    _spill_map = 0;
+    _spill.reset();
+  }
+
+  QPair<QBitArray, QBitArray> CSDCNetRound::PhaseLog::GetBitsAtIndex(int msg_idx)
+  {
+    int byte_idx = msg_idx / 8;
+    int bit_idx = msg_idx % 8;
+
+    QBitArray clients(_max, false);
+    foreach(int idx, _slots.keys()) {
+      const char *ciphertext = GetSlotData(_slots[idx]);
+      clients[idx] = (ciphertext[byte_idx] & bit_masks[bit_idx]) > 0;
+    }
+
+    QBitArray mine(_max, false);
+    foreach(int idx, my_sub_seeds.keys()) {
+      char pad_byte = my_sub_ciphertexts.contains(idx) ?
+        my_sub_ciphertexts[idx][byte_idx] :
+        GetPadByte(my_sub_seeds[idx], byte_idx);
+      mine[idx] = (pad_byte & bit_masks[bit_idx]) > 0;
+    }
+
+    return QPair<QBitArray, QBitArray>(clients, mine);
+  }
+
+  QByteArray &CSDCNetRound::PhaseLog::GetSubCiphertext(int gidx)
+  {
+    if(!my_sub_ciphertexts.contains(gidx)) {
+      QByteArray pad(pad_length, 0);
+      CryptoRandom(my_sub_seeds[gidx], PAD_GENERATOR).GenerateBlock(pad);
+      my_sub_ciphertexts[gidx] = pad;
+    }
+    return my_sub_ciphertexts[gidx];
+  }
+
+  void CSDCNetRound::ReadPublishedCiphertexts(const Connections::Id &from,
+      const QHash<Connections::Id, QPair<QByteArray, QByteArray> > &published)
+  {
+    int phase = _server_state->current_blame.third;
+    int accuse_idx = _server_state->current_blame.second;
+    int byte_idx = accuse_idx / 8;
+    int bit_idx = accuse_idx % 8;
+
+    QList<Connections::Id> senders =
+      GetCiphertextSenders(GetServers().GetIndex(from));
+    if(published.count() != senders.count()) {
+      throw QRunTimeError("Incorrect number of published ciphertexts");
+    }
+
+    foreach(const Connections::Id &id, senders) {
+      if(!published.contains(id)) {
+        throw QRunTimeError("Missing published ciphertext");
+      }
+
+      const QPair<QByteArray, QByteArray> &pair = published[id];
+      if(pair.first.size() <= byte_idx) {
+        throw QRunTimeError("Published ciphertext too short");
+      }
+
+      QByteArray hash = GetCiphertextHash(phase, pair.first);
+      if(!GetServers().GetKey(id)->Verify(hash, pair.second)) {
+        throw QRunTimeError("Published ciphertext not signed by its sender");
+      }
+    }
+
+    // Root servers are republished by every root server, a sender signing
+    // two ciphertexts that differ in the accused bit has lied to one of them
+    foreach(const Connections::Id &id, senders) {
+      char bit = (published[id].first[byte_idx] & bit_masks[bit_idx]) >> bit_idx;
+      if(_server_state->sent_bits.contains(id) &&
+          _server_state->sent_bits[id] != bit)
+      {
+        _server_state->equivocators.insert(id);
+      }
+      _server_state->sent_bits[id] = bit;
+    }
+  }
+
+  Connections::Id CSDCNetRound::FindSubtreeMismatch() const
+  {
+    // Group indexes grow with depth, so this walks the tree level by level
+    for(int sidx = 0; sidx < GetServers().Count(); sidx++) {
+      Connections::Id id = GetServers().GetId(sidx);
+      if(_server_state->equivocators.contains(id)) {
+        return id;
+      }
+
+      const QPair<QBitArray, QBitArray> &pair = _server_state->blame_bits[id];
+      char actual = 0;
+      for(int idx = 0; idx < pair.first.size(); idx++) {
+        actual ^= pair.first[idx];
+      }
+      for(int idx = 0; idx < pair.second.size(); idx++) {
+        actual ^= pair.second[idx];
+      }
+
+      QList<int> subtree = GetSubtreeIndexes(sidx);
+      for(int idx = 1; idx < subtree.count(); idx++) {
+        if(GetParentIndex(subtree[idx]) == sidx) {
+          actual ^= _server_state->sent_bits[GetServers().GetId(subtree[idx])];
+        }
+      }
+
+      if(actual != _server_state->sent_bits[id]) {
+        return id;
+      }
+    }
+    return Connections::Id::Zero();
+  }
+
   QPair<int, QBitArray> CSDCNetRound::FindMismatch()
   {
     QBitArray actual(GetServers().Count(), false);
@@ -1659,18 +2372,16 @@ namespace Anonymity {
 
     int byte_idx = accuse_idx / 8;
     int bit_idx = accuse_idx % 8;
-    int msg_size = byte_idx + 1;
 
     int bidx = -1;
-    QByteArray tmp(msg_size, 0);
 
     for(int idx = 0; idx < _state->base_seeds.size(); idx++) {
       const QByteArray &base_seed = _state->base_seeds[idx];
       hashalgo.Update(base_seed);
       hashalgo.Update(bphase);
       hashalgo.Update(GetNonce());
-      CryptoRandom(hashalgo.ComputeHash()).GenerateBlock(tmp);
-      if(((tmp[byte_idx] & bit_masks[bit_idx]) != 0) != server_bits[idx]) {
+      char pad_byte = GetPadByte(hashalgo.ComputeHash(), byte_idx);
+      if(((pad_byte & bit_masks[bit_idx]) != 0) != server_bits[idx]) {
         bidx = idx;
         break;
       }
@@ -2,6 +2,8 @@
 #define DISSENT_ANONYMITY_CS_BULK_ROUND_H_GUARD
 
 #include <QMetaEnum>
+#include <QScopedPointer>
+#include <QTemporaryFile>
 
 #include "Crypto/CryptoRandom.hpp"
 #include "Crypto/Hash.hpp"
@@ -35,6 +37,15 @@ namespace Anonymity {
    * and then distribute the final cleartext to all clients. RNGs are reset
    * each round to map to the shared secret between the client and server,
    * the RoundID (or nonce), and then the current phase.
+   *
+   * Servers may instead be arranged in a tree with a given fanout: the first
+   * fanout servers form the root layer and every other server is the child
+   * of a server one layer up.  Servers pass the union of their subtree's
+   * client lists up the tree and the online clients back down, then xor
+   * their children's ciphertexts into their own and forward the result to
+   * their parent.  Only the root layer exchanges commits, ciphertexts, and
+   * validation, its signed cleartext then flows back down the tree.  A
+   * fanout of 0 places every server in the root layer.
    */
   class CSDCNetRound : public BaseDCNetRound
   {
@@ -56,6 +67,9 @@ namespace Anonymity {
         SERVER_REBUTTAL_OR_VERDICT,
         CLIENT_REBUTTAL,
         SERVER_VERDICT_SIGNATURE,
+        SERVER_SUBTREE_CLIENT_LIST,
+        SERVER_ONLINE_CLIENTS,
+        SERVER_SUBTREE_CIPHERTEXT,
       };
 
       enum States {
@@ -65,10 +79,14 @@ namespace Anonymity {
         PREPARE_FOR_BULK,
         CLIENT_WAIT_FOR_CLEARTEXT,
         SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
+        SERVER_WAIT_FOR_SUBTREE_CLIENT_LISTS,
         SERVER_WAIT_FOR_CLIENT_LISTS,
+        SERVER_WAIT_FOR_ONLINE_CLIENTS,
+        SERVER_WAIT_FOR_SUBTREE_CIPHERTEXT,
         SERVER_WAIT_FOR_SERVER_COMMITS,
         SERVER_WAIT_FOR_SERVER_CIPHERTEXT,
         SERVER_WAIT_FOR_SERVER_VALIDATION,
+        SERVER_WAIT_FOR_SUBTREE_CLEARTEXT,
         SERVER_PUSH_CLEARTEXT,
         STARTING_BLAME_SHUFFLE,
         WAITING_FOR_BLAME_SHUFFLE,
@@ -95,6 +113,8 @@ namespace Anonymity {
        * @param get_data requests data to share during this session
        * @param create_shuffle optional parameter specifying a shuffle round
        * to create, currently used for testing
+       * @param fanout size of the root layer and children per server of the
+       * server tree, 0 for all servers to exchange ciphertexts directly
        */
       explicit CSDCNetRound(const Identity::Roster &clients,
           const Identity::Roster &servers,
@@ -102,7 +122,8 @@ namespace Anonymity {
           const QByteArray &nonce,
           const QSharedPointer<ClientServer::Overlay> &overlay,
           Messaging::GetDataCallback &get_data,
-          CreateRound create_shuffle = &TCreateRound<ShuffleRound>);
+          CreateRound create_shuffle = &TCreateRound<ShuffleRound>,
+          int fanout = 0);
 
       /**
        * Destructor
@@ -117,6 +138,21 @@ namespace Anonymity {
         return GetOverlay()->AmServer();
       }
 
+      /**
+       * Returns the fanout of the server tree, 0 if servers are not arranged
+       * in a tree
+       */
+      inline int GetFanout() const { return _fanout; }
+
+      /**
+       * Returns the servers that exchange ciphertexts to produce the
+       * cleartext, all servers unless arranged in a tree
+       */
+      inline const QList<Connections::Id> &GetRootServers() const
+      {
+        return _root_servers;
+      }
+
       /**
        * Converts a MessageType into a QString
        * @param mt value to convert
@@ -186,12 +222,29 @@ namespace Anonymity {
 
       static constexpr float CLIENT_WINDOW_MULTIPLIER = 2.0;
 
+      /**
+       * Number of phases, including the current, whose logs servers retain
+       * for blame.  Accusations for older phases are ignored.
+       */
+      static int PhaseLogRetention;
+
 #ifdef DEMO_SESSION
       static constexpr int MAX_GET = 1048576;
 #else
       static constexpr int MAX_GET = 4096;
 #endif
 
+      /**
+       * The generator used to expand the pairwise shared secrets into pads
+       */
+#ifdef CSBR_X917_PADS
+      static const Crypto::CryptoRandom::GeneratorType PAD_GENERATOR =
+        Crypto::CryptoRandom::X917;
+#else
+      static const Crypto::CryptoRandom::GeneratorType PAD_GENERATOR =
+        Crypto::CryptoRandom::CTR_AES;
+#endif
+
     protected:
       typedef Utils::Random Random;
 
@@ -254,29 +307,70 @@ namespace Anonymity {
       };
 
       /**
-       * Holds the internal state for phases for the purpose of accusation
+       * Holds the internal state for phases for the purpose of accusation.
+       * Client ciphertexts are packed back to back into fixed-size chunks,
+       * which are moved into a memory-mapped temporary file when a large
+       * phase is retired.  Pads are not stored, only the seeds needed to
+       * regenerate them.
        */
       class PhaseLog {
         public:
-          PhaseLog(int phase, int max) : phase(phase), _max(max) { }
-
-          QPair<QBitArray, QBitArray> GetBitsAtIndex(int msg_idx)
-          {
-            int byte_idx = msg_idx / 8;
-            int bit_idx = msg_idx % 8;
-
-            QBitArray clients(_max, false);
-            foreach(int idx, messages.keys()) {
-              clients[idx] = (messages[idx][byte_idx] & bit_masks[bit_idx]) > 0;
-            }
-
-            QBitArray mine(_max, false);
-            foreach(int idx, my_sub_ciphertexts.keys()) {
-              mine[idx] = (my_sub_ciphertexts[idx][byte_idx] & bit_masks[bit_idx]) > 0;
-            }
-
-            return QPair<QBitArray, QBitArray>(clients, mine);
-          }
+          /**
+           * Constructor
+           * @param phase the phase logged
+           * @param max the number of clients in the roster
+           */
+          PhaseLog(int phase, int max);
+          ~PhaseLog();
+
+          /**
+           * Reserves room for the ciphertexts of the clients expected to
+           * submit to this server, has no effect once a ciphertext is stored
+           * @param count the number of clients expected
+           * @param length the length of each ciphertext
+           */
+          void Reserve(int count, int length);
+
+          /**
+           * Stores (or replaces) a client's ciphertext for this phase, all
+           * ciphertexts in a phase must be of the same length
+           * @param idx the client's group index
+           * @param ciphertext the client's ciphertext
+           */
+          void SetClientCiphertext(int idx, const QByteArray &ciphertext);
+
+          /**
+           * Returns a view of a client's ciphertext in the arena, which is
+           * only valid until the next insertion into this log
+           * @param idx the client's group index
+           */
+          QByteArray GetClientCiphertext(int idx) const;
+
+          /**
+           * Returns the group indexes of the clients that submitted a
+           * ciphertext to this server
+           */
+          QList<int> GetSubmittedClients() const { return _slots.keys(); }
+
+          /**
+           * Returns the number of client ciphertexts stored in this log
+           */
+          int GetSubmittedCount() const { return _slots.count(); }
+
+          /**
+           * Called when the phase ends, the ciphertexts are spilled to disk
+           * when they total at least SPILL_SIZE bytes
+           */
+          void Retire();
+
+          QPair<QBitArray, QBitArray> GetBitsAtIndex(int msg_idx);
+
+          /**
+           * Returns the pad this server shared with a client during this
+           * phase, regenerating it from its seed the first time it is needed
+           * @param gidx the client's group index
+           */
+          QByteArray &GetSubCiphertext(int gidx);
 
           char GetBitAtIndex(const Connections::Id &id, int msg_idx)
           {
@@ -285,18 +379,58 @@ namespace Anonymity {
             return (server_messages[id][byte_idx] & bit_masks[bit_idx]) >> bit_idx;
           }
 
+          /**
+           * Retired logs with this many bytes of ciphertext or more are
+           * spilled to disk
+           */
+          static const int SPILL_SIZE = 16 * 1024 * 1024;
+
+          /**
+           * Bytes of ciphertext packed into each chunk, so that no single
+           * allocation approaches the QByteArray size limit
+           */
+          static const int CHUNK_SIZE = 64 * 1024 * 1024;
+
           QBitArray clients;
           QVector<int> message_offsets;
           int message_length;
           QHash<int, int> client_to_server;
-          QHash<int, QByteArray> messages;
+          /// The seed of the pad shared with each client in this phase
+          QHash<int, QByteArray> my_sub_seeds;
+          /// Pads regenerated from my_sub_seeds, only as blame needs them
           QHash<int, QByteArray> my_sub_ciphertexts;
+          int pad_length;
           QHash<Connections::Id, QByteArray> server_messages;
+          /// Each sender's signature over its entry in server_messages,
+          /// only kept with a server tree, where blame republishes them
+          QHash<Connections::Id, QByteArray> server_signatures;
           int phase;
 
         private:
-          int _max;
+          /**
+           * Fixes the ciphertext length for the phase
+           */
+          void SetCiphertextLength(int length);
+
+          /**
+           * Returns the storage for the ciphertext in a slot
+           */
+          char *GetSlotData(int slot);
+          const char *GetSlotData(int slot) const;
+
+          /**
+           * Moves a spilled log back into memory
+           */
+          void Unspill();
 
+          int _max;
+          int _expected;
+          int _ciphertext_length;
+          int _slots_per_chunk;
+          QList<QByteArray> _chunks;
+          QHash<int, int> _slots;
+          QScopedPointer<QTemporaryFile> _spill;
+          uchar *_spill_map;
       };
 
       /**
@@ -320,7 +454,6 @@ namespace Anonymity {
           QBitArray handled_clients;
           QByteArray signed_hash;
           QBitArray handled_servers_bits;
-          QList<QPair<int, QByteArray> > client_ciphertexts;
 
           QSet<Connections::Id> handled_servers;
           QHash<int, int> rng_to_gidx;
@@ -332,6 +465,11 @@ namespace Anonymity {
           // owner, accuse, phase
           Utils::Triple<int, int, int> current_blame;
           QHash<Connections::Id, QPair<QBitArray, QBitArray> > blame_bits;
+          /// With a server tree, the accused bit of the ciphertext each
+          /// server sent up the tree, as republished by its receivers
+          QHash<Connections::Id, char> sent_bits;
+          /// Servers that signed ciphertexts differing in the accused bit
+          QSet<Connections::Id> equivocators;
           QBitArray server_bits;
           Connections::Id expected_rebuttal;
           Connections::Id bad_dude;
@@ -342,6 +480,11 @@ namespace Anonymity {
       QSharedPointer<State> GetState() { return _state; }
 
     private:
+      /**
+       * Called by the constructor to place the servers into the tree
+       */
+      void InitServerTree();
+
       /**
        * Called by the constructor to initialize the server state machine
        */
@@ -405,6 +548,34 @@ namespace Anonymity {
        */
       void HandleServerClientList(const Connections::Id &from, QDataStream &stream);
 
+      /**
+       * Server handles the union of client lists from a child's subtree
+       * @param from sender of the message
+       * @param stream message
+       */
+      void HandleSubtreeClientList(const Connections::Id &from, QDataStream &stream);
+
+      /**
+       * Server handles the online clients sent down by its parent
+       * @param from sender of the message
+       * @param stream message
+       */
+      void HandleOnlineClients(const Connections::Id &from, QDataStream &stream);
+
+      /**
+       * Server handles the xor of the ciphertexts in a child's subtree
+       * @param from sender of the message
+       * @param stream message
+       */
+      void HandleSubtreeCiphertext(const Connections::Id &from, QDataStream &stream);
+
+      /**
+       * Server handles the cleartext sent down by its parent
+       * @param from sender of the message
+       * @param stream message
+       */
+      void HandleSubtreeCleartext(const Connections::Id &from, QDataStream &stream);
+
       /**
        * Server handles other server commit messages
        * @param from sender of the message
@@ -463,6 +634,10 @@ namespace Anonymity {
       void SubmitClientCiphertext();
       void SetOnlineClients();
       void SubmitClientList();
+      void CollectSubtreeClientLists();
+      void SubmitSubtreeClientList();
+      void SubmitOnlineClients();
+      void SubmitSubtreeCiphertext();
       void SubmitCommit();
       void SubmitServerCiphertext();
       void SubmitValidation();
@@ -477,6 +652,13 @@ namespace Anonymity {
 
       /* Below are the ciphertext generation helpers */
       QByteArray GenerateSlotMessage();
+
+      /**
+       * Splits the client RNGs across the thread pool, each worker xors its
+       * pads into a partial ciphertext, which are then combined into xor_msg.
+       * @param xor_msg the output of combining all the pads
+       */
+      void GenerateServerPads(QByteArray &xor_msg);
       bool CheckData();
 
       void ProcessCleartext();
@@ -496,6 +678,76 @@ namespace Anonymity {
         return 9 + Crypto::CryptoRandom::OptimalSeedSize() + sig_length;
       }
 
+      /**
+       * Returns a single byte from the pad generated by a seed, seeking
+       * directly to it when the pad generator allows
+       * @param seed the seed for this phase's pad
+       * @param offset the byte offset into the pad
+       */
+      static char GetPadByte(const QByteArray &seed, int offset);
+
+      /**
+       * Returns true if the root layer signed the cleartext and online
+       * clients
+       */
+      bool VerifyCleartext(const QHash<int, QByteArray> &signatures,
+          const QByteArray &cleartext, const QBitArray &online) const;
+
+      /**
+       * Returns true if some servers are outside of the root layer
+       */
+      inline bool HasServerTree() const
+      {
+        return _root_servers.count() < GetServers().Count();
+      }
+
+      /**
+       * Returns the group index of a server's parent in the tree, -1 for
+       * servers in the root layer
+       * @param sidx the server's group index
+       */
+      int GetParentIndex(int sidx) const;
+
+      /**
+       * Returns the group indexes of a server and all its descendants
+       * @param sidx the server's group index
+       */
+      QList<int> GetSubtreeIndexes(int sidx) const;
+
+      /**
+       * Returns the servers whose ciphertexts a server receives: its
+       * children and, in the root layer, every root server
+       * @param sidx the server's group index
+       */
+      QList<Connections::Id> GetCiphertextSenders(int sidx) const;
+
+      /**
+       * Returns the hash a server signs over the ciphertext it sends up the
+       * tree, so its receivers can later prove what it sent
+       * @param phase the phase of the ciphertext
+       * @param ciphertext the ciphertext
+       */
+      QByteArray GetCiphertextHash(int phase, const QByteArray &ciphertext) const;
+
+      /**
+       * Checks the signed ciphertexts a server republished with its blame
+       * bits, throwing if any is missing or not signed by its sender, and
+       * records their accused bits
+       * @param from the republishing server
+       * @param published the ciphertexts and signatures, named by sender
+       */
+      void ReadPublishedCiphertexts(const Connections::Id &from,
+          const QHash<Connections::Id, QPair<QByteArray, QByteArray> > &published);
+
+      /**
+       * Walks the server tree from the root layer down, returning the first
+       * server whose blame bits xored with the bits its children sent do
+       * not give the bit it sent itself, or Id::Zero if every server is
+       * consistent.  Each server's bits and ciphertext carry its own
+       * signature, so the server returned provably lied.
+       */
+      Connections::Id FindSubtreeMismatch() const;
+
       QPair<int, QBitArray> FindMismatch();
       QPair<int, QByteArray> GetRebuttal(int phase, int accuse_idx,
           const QBitArray &server_bits);
@@ -506,6 +758,10 @@ namespace Anonymity {
       bool _stop_next;
       Messaging::GetDataMethod<CSDCNetRound> _get_blame_data;
       BufferSink _blame_sink;
+      int _fanout;
+      QList<Connections::Id> _root_servers;
+      Connections::Id _parent_server;
+      QList<Connections::Id> _child_servers;
 
     private slots:
       void OperationFinished() { _state_machine.StateComplete(); }
@@ -0,0 +1,20 @@
+
+#include "HeresyRound.hpp"
+
+namespace Dissent {
+namespace Anonymity {
+  int HeresyRound::Fanout = 4;
+
+  HeresyRound::HeresyRound(const Identity::Roster &clients,
+      const Identity::Roster &servers,
+      const Identity::PrivateIdentity &ident,
+      const QByteArray &nonce,
+      const QSharedPointer<ClientServer::Overlay> &overlay,
+      Messaging::GetDataCallback &get_data,
+      CreateRound create_shuffle) :
+    CSDCNetRound(clients, servers, ident, nonce, overlay, get_data,
+        create_shuffle, qMax(Fanout, 1))
+  {
+  }
+}
+}
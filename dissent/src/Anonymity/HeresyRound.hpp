@@ -0,0 +1,58 @@
+#ifndef DISSENT_ANONYMITY_HERESY_ROUND_H_GUARD
+#define DISSENT_ANONYMITY_HERESY_ROUND_H_GUARD
+
+#include "CSDCNetRound.hpp"
+
+namespace Dissent {
+namespace Anonymity {
+
+  /**
+   * A CSDCNetRound whose servers are arranged in a tree, as in Heresy.
+   * Servers below the root layer xor their subtree's ciphertexts and
+   * forward a single ciphertext to their parent, so only the root layer
+   * runs the all-to-all commit, ciphertext, and validation exchange.
+   */
+  class HeresyRound : public CSDCNetRound {
+    public:
+      /**
+       * Constructor
+       * @param clients the list of clients in the round
+       * @param servers the list of servers in the round
+       * @param ident this participants private information
+       * @param nonce Unique round id (nonce)
+       * @param overlay handles message sending
+       * @param get_data requests data to share during this session
+       * @param create_shuffle optional parameter specifying a shuffle round
+       * to create, currently used for testing
+       */
+      explicit HeresyRound(const Identity::Roster &clients,
+          const Identity::Roster &servers,
+          const Identity::PrivateIdentity &ident,
+          const QByteArray &nonce,
+          const QSharedPointer<ClientServer::Overlay> &overlay,
+          Messaging::GetDataCallback &get_data,
+          CreateRound create_shuffle = &TCreateRound<ShuffleRound>);
+
+      /**
+       * Destructor
+       */
+      virtual ~HeresyRound() {}
+
+      /**
+       * Returns the string representation of the round
+       */
+      inline virtual QString ToString() const
+      {
+        return "HeresyRound: " + GetNonce().toBase64() +
+          " Fanout: " + QString::number(GetFanout());
+      }
+
+      /**
+       * Size of the root layer and children per server of the server tree
+       */
+      static int Fanout;
+  };
+}
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include "Crypto/CryptoRandom.hpp"
 #include "Messaging/Request.hpp"
 
+#include "BatchVerifier.hpp"
 #include "Round.hpp"
 
 namespace Dissent {
@@ -42,6 +43,13 @@ namespace Anonymity {
     GetOverlay()->SendNotification(to, "SessionData", msg);
   }
 
+  void Round::VerifiableSend(const QList<Connections::Id> &to,
+      const QByteArray &data)
+  {
+    QByteArray msg = m_header + data + GetKey()->Sign(data);
+    GetOverlay()->SendNotification(to, "SessionData", msg);
+  }
+
   void Round::VerifiableBroadcast(const QByteArray &data)
   {
     QByteArray msg = m_header + data + GetKey()->Sign(data);
@@ -53,9 +61,8 @@ namespace Anonymity {
     Q_ASSERT(GetOverlay()->AmServer());
 
     QByteArray msg = m_header + data + GetKey()->Sign(data);
-    foreach(const Connections::Id &id, GetOverlay()->GetServerIds()) {
-      GetOverlay()->SendNotification(id, "SessionData", msg);
-    }
+    GetOverlay()->SendNotification(GetOverlay()->GetServerIds(),
+        "SessionData", msg);
   }
 
   void Round::VerifiableBroadcastToClients(const QByteArray &data)
@@ -63,37 +70,29 @@ namespace Anonymity {
     Q_ASSERT(GetOverlay()->AmServer());
 
     QByteArray msg = m_header + data + GetKey()->Sign(data);
-    foreach(const QSharedPointer<Connections::Connection> &con,
-        GetOverlay()->GetConnectionTable().GetConnections())
-    {
-      if(!GetOverlay()->IsServer(con->GetRemoteId())) {
-        GetOverlay()->SendNotification(con->GetRemoteId(), "SessionData", msg);
-      }
-    }
+    GetOverlay()->BroadcastToClients("SessionData", msg);
   }
 
-  bool Round::Verify(const Connections::Id &from,
-      const QByteArray &data, QByteArray &msg)
+  QSharedPointer<Crypto::AsymmetricKey> Round::GetVerificationKey(
+      const Connections::Id &from) const
   {
     QSharedPointer<Crypto::AsymmetricKey> key = GetServers().GetKey(from);
     if(key.isNull()) {
       key = GetClients().GetKey(from);
-      if(key.isNull()) {
-        qDebug() << "Received malsigned data block, no such peer";
-        return false;
-      }
     }
+    return key;
+  }
 
-    int sig_size = key->GetSignatureLength();
-    if(data.size() < sig_size) {
-      qDebug() << "Received malsigned data block, not enough data blocks." <<
-       "Expected at least:" << sig_size << "got" << data.size();
+  bool Round::Verify(const Connections::Id &from,
+      const QByteArray &data, QByteArray &msg)
+  {
+    QSharedPointer<Crypto::AsymmetricKey> key = GetVerificationKey(from);
+    if(key.isNull()) {
+      qDebug() << "Received malsigned data block, no such peer";
       return false;
     }
 
-    msg = data.left(data.size() - sig_size);
-    QByteArray sig = QByteArray::fromRawData(data.data() + msg.size(), sig_size);
-    return key->Verify(msg, sig);
+    return BatchVerifier::Verify(key, data, msg);
   }
 
   void Round::HandleDisconnect(const Connections::Id &id)
@@ -186,6 +186,14 @@ namespace Anonymity {
        */
       bool Verify(const Connections::Id &from, const QByteArray &data, QByteArray &msg);
 
+      /**
+       * Returns the key used to verify messages from the specified peer, or
+       * a null pointer if the peer is not a member of this round
+       * @param from the signing peers id
+       */
+      QSharedPointer<Crypto::AsymmetricKey> GetVerificationKey(
+          const Connections::Id &from) const;
+
       /**
        * Signs and encrypts a message before sending it to all participants
        * @param data the message to send
@@ -193,7 +201,8 @@ namespace Anonymity {
       void VerifiableBroadcast(const QByteArray &data);
 
       /**
-       * Signs and encrypts a message before sending it to all downstream clients
+       * Signs and encrypts a message before sending it to all downstream
+       * clients, see Overlay::BroadcastToClients
        * @param data the message to send
        */
       void VerifiableBroadcastToClients(const QByteArray &data);
@@ -212,6 +221,14 @@ namespace Anonymity {
       void VerifiableSend(const Connections::Id &to,
           const QByteArray &data);
 
+      /**
+       * Signs and encrypts a message once before sending it to a set of peers
+       * @param to the peers to send it to
+       * @param data the message to send
+       */
+      void VerifiableSend(const QList<Connections::Id> &to,
+          const QByteArray &data);
+
       /**
        * Returns the data to be sent during this round
        */
@@ -1,5 +1,6 @@
 #include "Anonymity/BaseDCNetRound.hpp"
 #include "Anonymity/CSDCNetRound.hpp"
+#include "Anonymity/HeresyRound.hpp"
 #include "Anonymity/NeffShuffleRound.hpp"
 #include "Anonymity/NullRound.hpp"
 
@@ -20,6 +21,9 @@ namespace Anonymity {
       case NULL_CSDCNET:
         cr = &TCreateDCNetRound<CSDCNetRound, NullRound>;
         break;
+      case NULL_HERESY:
+        cr = &TCreateDCNetRound<HeresyRound, NullRound>;
+        break;
       case NEFF_CSDCNET:
       case VERDICT_CSDCNET:
       default:
@@ -20,7 +20,8 @@ namespace Anonymity {
           "neffshuffle",
           "neff/csdcnet",
           "null/csdcnet",
-          "verdict/csdcnet"
+          "verdict/csdcnet",
+          "null/heresy"
         };
         return rounds[id];
       }
@@ -32,6 +33,7 @@ namespace Anonymity {
         NEFF_CSDCNET,
         NULL_CSDCNET,
         VERDICT_CSDCNET,
+        NULL_HERESY,
         NOT_A_ROUND
       };
 
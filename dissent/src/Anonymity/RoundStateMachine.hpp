@@ -3,7 +3,9 @@
 
 #include "Connections/Id.hpp"
 #include "Utils/QRunTimeError.hpp"
+#include "Utils/Utils.hpp"
 
+#include "BatchVerifier.hpp"
 #include "Round.hpp"
 #include "Log.hpp"
 
@@ -20,7 +22,8 @@ namespace Anonymity {
    * @TODO Make a RoundStateMachineImpl for inheritance purposes, so classes
    * can properly implement the necessary behaviors for RoundStateMachine.
    */
-  template <typename T> class RoundStateMachine {
+  template <typename T> class RoundStateMachine :
+      public BatchVerifier::Handler {
     public:
       typedef Connections::Id Id;
 
@@ -34,6 +37,7 @@ namespace Anonymity {
        * @param round the round to control
        */
       RoundStateMachine(T *round) :
+        _verifier(this),
         _round(round),
         _phase(0),
         _cycle_state(-1)
@@ -43,7 +47,7 @@ namespace Anonymity {
       /**
        * Destructor, I don't think that this class should be extended
        */
-      ~RoundStateMachine() {}
+      virtual ~RoundStateMachine() {}
 
       /**
        * Returns the State to a string
@@ -136,31 +140,79 @@ namespace Anonymity {
 
         (_round->*GetCurrentState()->GetTransitionCallback())();
 
+        // These precede anything still being verified, so handle them now.
+        // Their signatures were checked on arrival.
         for(int idx = 0; idx < tmp.Count(); idx++) {
           QPair<QByteArray, Id> entry = tmp.At(idx);
-          ProcessData(entry.second, entry.first);
+          ProcessVerifiedNow(entry.second, entry.first);
         }
       }
 
       /**
        * Does the real work for processing data, the round should funnel its
-       * ProcessData to here.
+       * ProcessData to here.  When multithreading, signatures are verified
+       * in batches on the thread pool prior to processing.
        * @param from the sending member
        * @param data the data sent
        */
       void ProcessData(const Id &from, const QByteArray &data)
       {
-        _log.Append(data, from);
-        try {
-          ProcessDataBase(from, data);
-        } catch (QRunTimeError &err) {
-          qWarning() << _round->GetLocalId() << "received a message from" <<
-            from << "in" << _round->GetNonce().toBase64() << "in state" <<
-            StateToString(GetCurrentState()->GetState()) <<
-            "causing the following exception:" << err.What();
-          _log.Pop();
+        if(Utils::MultiThreading) {
+          QSharedPointer<Crypto::AsymmetricKey> key =
+            _round->GetVerificationKey(from);
+          if(!key.isNull()) {
+            _verifier.Queue(from, key, data);
+            return;
+          }
+        }
+
+        ProcessDataNow(from, data);
+      }
+
+      /**
+       * Processes a message whose signature has been checked by the
+       * BatchVerifier
+       */
+      virtual void HandleVerified(const Id &from, const QByteArray &data,
+          const QByteArray &msg, bool valid)
+      {
+        if(_round->Stopped()) {
           return;
         }
+
+        if(!valid) {
+          ReportError(from, "Invalid signature or data");
+          return;
+        }
+        ProcessLogged(from, data, &msg);
+      }
+
+      /**
+       * Verifies and processes data immediately
+       * @param from the sending member
+       * @param data the data sent
+       */
+      void ProcessDataNow(const Id &from, const QByteArray &data)
+      {
+        ProcessLogged(from, data, 0);
+      }
+
+      /**
+       * Processes data whose signature has already been verified
+       * @param from the sending member
+       * @param data the data sent
+       */
+      void ProcessVerifiedNow(const Id &from, const QByteArray &data)
+      {
+        QSharedPointer<Crypto::AsymmetricKey> key =
+          _round->GetVerificationKey(from);
+        if(key.isNull()) {
+          ReportError(from, "No such peer");
+          return;
+        }
+
+        QByteArray msg = data.left(data.size() - key->GetSignatureLength());
+        ProcessLogged(from, data, &msg);
       }
 
       /**
@@ -253,6 +305,43 @@ namespace Anonymity {
         return state;
       }
 
+      /**
+       * Logs and processes data, reporting and dropping from the log any
+       * data that causes an exception
+       * @param from the sending member
+       * @param data the data sent
+       * @param msg the data without its signature if the signature has been
+       * verified, otherwise null to verify it here
+       */
+      void ProcessLogged(const Id &from, const QByteArray &data,
+          const QByteArray *msg)
+      {
+        _log.Append(data, from);
+        try {
+          if(msg) {
+            ProcessPayload(from, data, *msg);
+          } else {
+            ProcessDataBase(from, data);
+          }
+        } catch (QRunTimeError &err) {
+          ReportError(from, err.What());
+          _log.Pop();
+        }
+      }
+
+      /**
+       * Warns about a message that could not be processed
+       * @param from the sending member
+       * @param error the reason
+       */
+      void ReportError(const Id &from, const QString &error)
+      {
+        qWarning() << _round->GetLocalId() << "received a message from" <<
+          from << "in" << _round->GetNonce().toBase64() << "in state" <<
+          StateToString(GetCurrentState()->GetState()) <<
+          "causing the following exception:" << error;
+      }
+
       /**
        * Does the actual hard work for processing data, this is split since the
        * ProcessData is more used to catch exceptions and handle logging.
@@ -265,7 +354,19 @@ namespace Anonymity {
         if(!_round->Verify(from, data, payload)) {
           throw QRunTimeError("Invalid signature or data");
         }
-        
+
+        ProcessPayload(from, data, payload);
+      }
+
+      /**
+       * Parses and dispatches a message whose signature has been verified
+       * @param from the sending member
+       * @param data the data sent
+       * @param payload the data without its signature
+       */
+      void ProcessPayload(const Id &from, const QByteArray &data,
+          const QByteArray &payload)
+      {
         QDataStream stream(payload);
 
         int mtype;
@@ -307,6 +408,7 @@ namespace Anonymity {
         (_round->*GetCurrentState()->GetMessageHandler())(from, stream);
       }
 
+      BatchVerifier _verifier;
       QHash<int, bool> _valid_message_types;
       QHash<int, int> _state_transitions;
       QHash<int, QSharedPointer<State> > _states;
@@ -20,6 +20,21 @@ int main(int argc, char **argv)
     return -1;
   }
 
+  CSDCNetRound::PhaseLogRetention = settings.PhaseLogRetention;
+  NeffShuffle::Workers = settings.NeffShuffleWorkers;
+  SessionSharedState::EllipticCurveKeys = settings.EllipticCurveKeys;
+  EphemeralKeyPool::Size = settings.EphemeralKeyPool;
+  EphemeralKeyPool::LocalNodes = settings.LocalNodeCount;
+  ServerSession::RegistrationTimeout = settings.RegistrationTimeout;
+  ServerSession::CloseRegistrationEarly = settings.CloseRegistrationEarly;
+  ServerSession::PipelineRounds = settings.PipelineRounds;
+  IoThreads::Count = settings.IoThreads;
+  Edge::CompressionLevel = settings.Compression;
+  Overlay::RelayFanout = settings.RelayFanout;
+  HeresyRound::Fanout = settings.HeresyFanout;
+  EphemeralKeyPool::Fill(settings.EllipticCurveKeys ?
+      DiffieHellman::ELLIPTIC_CURVE : DiffieHellman::MODULAR);
+
   QList<QSharedPointer<Node> > nodes;
 
   QSharedPointer<ISink> default_sink(new DummySink());
@@ -46,6 +61,9 @@ int main(int argc, char **argv)
     QFile key_file(key_path);
     if(key_file.exists()) {
       key = QSharedPointer<AsymmetricKey>(new DsaPrivateKey(key_path));
+      if(!key->IsValid()) {
+        key = QSharedPointer<AsymmetricKey>(new EcdsaPrivateKey(key_path));
+      }
     } else {
       QByteArray id = local_id.GetByteArray();
       key = QSharedPointer<AsymmetricKey>(new DsaPrivateKey(id, true));
@@ -137,5 +155,7 @@ int main(int argc, char **argv)
         node.data()->GetOverlay().data(), SLOT(CallStop()));
   }
 
-  return QCoreApplication::exec();
+  int result = QCoreApplication::exec();
+  IoThreads::Stop();
+  return result;
 }
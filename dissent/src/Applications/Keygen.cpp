@@ -71,7 +71,7 @@ int main(int argc, char **argv)
       QxtCommandOptions::ValueRequired);
   options.add(CL_PRIVDIR, "directory in which to put private keys (default=./keys/priv)",
       QxtCommandOptions::ValueRequired);
-  options.add(CL_KEYTYPE, "specify the key type (default=dsa, options=dsa|rsa)",
+  options.add(CL_KEYTYPE, "specify the key type (default=dsa, options=dsa|rsa|ecdsa)",
       QxtCommandOptions::ValueRequired);
   options.add(CL_LIB, "specify the library (default=cryptopp, options=cryptopp)",
       QxtCommandOptions::ValueRequired);
@@ -132,6 +132,8 @@ int main(int argc, char **argv)
       }
     } else if (key == "rsa") {
       ck = QSharedPointer<ICreateKey>(new CreateKey<RsaPrivateKey>());
+    } else if (key == "ecdsa") {
+      ck = QSharedPointer<ICreateKey>(new CreateKey<EcdsaPrivateKey>());
     } else {
       ExitWithWarning(options, "Invalid key type");
     }
@@ -91,6 +91,24 @@ namespace Applications {
 
     PublicKeys = _settings->value(Param<Params::PublicKeys>()).toString();
     PrivateKeys = _settings->value(Param<Params::PrivateKeys>()).toString();
+    PhaseLogRetention = _settings->value(Param<Params::PhaseLogRetention>(),
+        5).toInt();
+    NeffShuffleWorkers = _settings->value(Param<Params::NeffShuffleWorkers>(),
+        0).toInt();
+    EllipticCurveKeys = _settings->value(Param<Params::EllipticCurveKeys>(),
+        false).toBool();
+    EphemeralKeyPool = _settings->value(Param<Params::EphemeralKeyPool>(),
+        2).toInt();
+    RegistrationTimeout = _settings->value(Param<Params::RegistrationTimeout>(),
+        30 * 1000).toInt();
+    CloseRegistrationEarly = _settings->value(
+        Param<Params::CloseRegistrationEarly>(), false).toBool();
+    PipelineRounds = _settings->value(Param<Params::PipelineRounds>(),
+        false).toBool();
+    IoThreads = _settings->value(Param<Params::IoThreads>(), 0).toInt();
+    Compression = _settings->value(Param<Params::Compression>(), 0).toInt();
+    RelayFanout = _settings->value(Param<Params::RelayFanout>(), 0).toInt();
+    HeresyFanout = _settings->value(Param<Params::HeresyFanout>(), 4).toInt();
   }
 
   bool Settings::IsValid()
@@ -126,6 +144,50 @@ namespace Applications {
       return false;
     }
 
+    if(PhaseLogRetention < 1) {
+      _reason = "Invalid phase log retention: " +
+        QString::number(PhaseLogRetention);
+      return false;
+    }
+
+    if(NeffShuffleWorkers < 0) {
+      _reason = "Invalid Neff shuffle workers: " +
+        QString::number(NeffShuffleWorkers);
+      return false;
+    }
+
+    if(EphemeralKeyPool < 0) {
+      _reason = "Invalid ephemeral key pool size: " +
+        QString::number(EphemeralKeyPool);
+      return false;
+    }
+
+    if(RegistrationTimeout < 1) {
+      _reason = "Invalid registration timeout: " +
+        QString::number(RegistrationTimeout);
+      return false;
+    }
+
+    if(IoThreads < 0) {
+      _reason = "Invalid I/O threads: " + QString::number(IoThreads);
+      return false;
+    }
+
+    if(Compression < 0 || Compression > 9) {
+      _reason = "Invalid compression level: " + QString::number(Compression);
+      return false;
+    }
+
+    if(RelayFanout < 0) {
+      _reason = "Invalid relay fanout: " + QString::number(RelayFanout);
+      return false;
+    }
+
+    if(HeresyFanout < 1) {
+      _reason = "Invalid heresy fanout: " + QString::number(HeresyFanout);
+      return false;
+    }
+
     if(RoundType == Anonymity::RoundFactory::INVALID) {
       _reason = "Invalid round type: " +
         _settings->value(Param<Params::RoundType>()).toString();
@@ -232,6 +294,18 @@ namespace Applications {
     _settings->setValue(Param<Params::Auth>(), Auth);
     _settings->setValue(Param<Params::Log>(), Log);
     _settings->setValue(Param<Params::Multithreading>(), Multithreading);
+    _settings->setValue(Param<Params::PhaseLogRetention>(), PhaseLogRetention);
+    _settings->setValue(Param<Params::NeffShuffleWorkers>(), NeffShuffleWorkers);
+    _settings->setValue(Param<Params::EllipticCurveKeys>(), EllipticCurveKeys);
+    _settings->setValue(Param<Params::EphemeralKeyPool>(), EphemeralKeyPool);
+    _settings->setValue(Param<Params::RegistrationTimeout>(), RegistrationTimeout);
+    _settings->setValue(Param<Params::CloseRegistrationEarly>(),
+        CloseRegistrationEarly);
+    _settings->setValue(Param<Params::PipelineRounds>(), PipelineRounds);
+    _settings->setValue(Param<Params::IoThreads>(), IoThreads);
+    _settings->setValue(Param<Params::Compression>(), Compression);
+    _settings->setValue(Param<Params::RelayFanout>(), RelayFanout);
+    _settings->setValue(Param<Params::HeresyFanout>(), HeresyFanout);
 
     QVariantList local_ids;
     foreach(const Connections::Id &id, LocalId) {
@@ -357,6 +431,50 @@ namespace Applications {
         "a path to a directory containing public keys (public keys end in \".pub\"",
         QxtCommandOptions::ValueRequired);
 
+    options->add(Param<Params::PhaseLogRetention>(),
+        "number of phases CSDCNet servers retain for blame",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::NeffShuffleWorkers>(),
+        "number of workers for Neff shuffle proofs, 0 for all cores",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::EllipticCurveKeys>(),
+        "use elliptic curve round keys (ECDSA and ECDH over P-256)",
+        QxtCommandOptions::NoValue);
+
+    options->add(Param<Params::EphemeralKeyPool>(),
+        "number of round key sets to pregenerate per local node, 0 to disable",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::RegistrationTimeout>(),
+        "longest time in ms servers wait for client registrations",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::CloseRegistrationEarly>(),
+        "servers start the round once all their connected clients registered",
+        QxtCommandOptions::NoValue);
+
+    options->add(Param<Params::PipelineRounds>(),
+        "servers negotiate the next round while the current one runs",
+        QxtCommandOptions::NoValue);
+
+    options->add(Param<Params::IoThreads>(),
+        "number of threads handling Tcp socket I/O, 0 for the main thread",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::Compression>(),
+        "zlib level (1-9) for compressing traffic to peers, 0 to disable",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::RelayFanout>(),
+        "clients each relay server broadcasts to, 0 for direct delivery",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::HeresyFanout>(),
+        "root servers and children per server in heresy rounds",
+        QxtCommandOptions::ValueRequired);
+
     return options;
   }
 }
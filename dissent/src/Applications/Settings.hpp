@@ -148,6 +148,69 @@ namespace Applications {
        */
       QString PublicKeys;
 
+      /**
+       * Number of phases of client ciphertexts CSDCNet servers retain for
+       * blame
+       */
+      int PhaseLogRetention;
+
+      /**
+       * Number of workers used by Neff shuffle proofs, 0 for the size of the
+       * thread pool
+       */
+      int NeffShuffleWorkers;
+
+      /**
+       * Use ECDSA round signing keys and elliptic curve Diffie-Hellman keys
+       */
+      bool EllipticCurveKeys;
+
+      /**
+       * Number of ephemeral round key sets to keep pregenerated for each
+       * local node, 0 generates them when a round starts
+       */
+      int EphemeralKeyPool;
+
+      /**
+       * Longest time in ms servers accept client registrations for a round
+       */
+      int RegistrationTimeout;
+
+      /**
+       * Servers close registration once all their connected clients have
+       * registered
+       */
+      bool CloseRegistrationEarly;
+
+      /**
+       * Servers negotiate the next round while the current one runs
+       */
+      bool PipelineRounds;
+
+      /**
+       * Number of threads performing Tcp socket I/O, 0 to use the main thread
+       */
+      int IoThreads;
+
+      /**
+       * zlib level for compressing frames to peers that accept it, 0
+       * disables compression
+       */
+      int Compression;
+
+      /**
+       * Children per node of the tree relaying server broadcasts to
+       * clients, 0 for servers to send to each client directly.  Clients
+       * refuse to relay for trees wider than their own setting.
+       */
+      int RelayFanout;
+
+      /**
+       * Size of the root layer and children per server of the server tree
+       * in Heresy rounds
+       */
+      int HeresyFanout;
+
       bool Help;
 
       static const char* CParam(int id)
@@ -169,7 +232,18 @@ namespace Applications {
           "local_id",
           "server_ids",
           "path_to_private_keys",
-          "path_to_public_keys"
+          "path_to_public_keys",
+          "phase_log_retention",
+          "neff_shuffle_workers",
+          "elliptic_curve_keys",
+          "ephemeral_key_pool",
+          "registration_timeout",
+          "close_registration_early",
+          "pipeline_rounds",
+          "io_threads",
+          "compression",
+          "relay_fanout",
+          "heresy_fanout"
         };
         return params[id];
       }
@@ -193,7 +267,18 @@ namespace Applications {
             LocalId,
             ServerIds,
             PrivateKeys,
-            PublicKeys
+            PublicKeys,
+            PhaseLogRetention,
+            NeffShuffleWorkers,
+            EllipticCurveKeys,
+            EphemeralKeyPool,
+            RegistrationTimeout,
+            CloseRegistrationEarly,
+            PipelineRounds,
+            IoThreads,
+            Compression,
+            RelayFanout,
+            HeresyFanout
           };
       };
 
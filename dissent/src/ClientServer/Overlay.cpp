@@ -2,6 +2,7 @@
 
 #include "Connections/Connection.hpp"
 #include "Connections/ForwardingSender.hpp"
+#include "Crypto/Hash.hpp"
 #include "Transports/AddressFactory.hpp"
 #include "Transports/EdgeListenerFactory.hpp"
 
@@ -16,6 +17,72 @@ using Transports::AddressFactory;
 using Transports::EdgeListenerFactory;
 
 namespace ClientServer {
+  namespace {
+    /**
+     * Returns the bounds of the contiguous, evenly sized subtrees of at most
+     * fanout children splitting count targets, subtree idx spans
+     * [bounds[idx], bounds[idx + 1])
+     */
+    QList<int> SplitTargets(int count, int fanout)
+    {
+      QList<int> bounds;
+      bounds.append(0);
+      int branches = qMin(fanout, count);
+      for(int idx = 1; idx <= branches; idx++) {
+        bounds.append(idx * count / branches);
+      }
+      return bounds;
+    }
+
+    /**
+     * Digest of a node of the relay tree: its target, empty for the server,
+     * and the digests of its children's subtrees
+     */
+    QByteArray LevelDigest(const QVariant &head, const QVariantList &digests)
+    {
+      QVariantList target = head.toList();
+      QByteArray data;
+      QDataStream stream(&data, QIODevice::WriteOnly);
+      stream << target.value(0).toByteArray() << target.value(1).toString() <<
+        digests.count();
+      foreach(const QVariant &digest, digests) {
+        stream << digest.toByteArray();
+      }
+      return Crypto::Hash().ComputeHash(data);
+    }
+
+    /**
+     * Returns the digest of each subtree of targets
+     */
+    QVariantList ChildDigests(const QVariantList &targets, int fanout)
+    {
+      QList<int> bounds = SplitTargets(targets.count(), fanout);
+      QVariantList digests;
+      for(int idx = 0; idx + 1 < bounds.count(); idx++) {
+        QVariantList subtree = targets.mid(bounds[idx], bounds[idx + 1] - bounds[idx]);
+        digests.append(LevelDigest(subtree[0],
+              ChildDigests(subtree.mid(1), fanout)));
+      }
+      return digests;
+    }
+
+    /**
+     * The data a server signs for a relayed broadcast
+     */
+    QByteArray RelaySignedData(const QByteArray &source, const QVariant &data,
+        int fanout, const QByteArray &root)
+    {
+      QByteArray signed_data;
+      QDataStream stream(&signed_data, QIODevice::WriteOnly);
+      stream << source << Overlay::RelayMethod << data.toByteArray() <<
+        fanout << root;
+      return signed_data;
+    }
+  }
+
+  int Overlay::RelayFanout = 0;
+  const QString Overlay::RelayMethod = "SessionData";
+
   Overlay::Overlay(const Connections::Id &local_id,
       const QList<Transports::Address> &local_endpoints,
       const QList<Transports::Address> &remote_endpoints,
@@ -30,12 +97,14 @@ namespace ClientServer {
   {
     GetRpcHandler()->Register("CS::Broadcast", this, "BroadcastHelper");
     GetRpcHandler()->Register("RF::Data", this, "ForwardedData");
+    GetRpcHandler()->Register("CS::Relay", this, "RelayHelper");
   }
 
   Overlay::~Overlay()
   {
     GetRpcHandler()->Unregister("CS::Broadcast");
     GetRpcHandler()->Unregister("RF::Data");
+    GetRpcHandler()->Unregister("CS::Relay");
   }
 
   void Overlay::OnStart()
@@ -93,11 +162,19 @@ namespace ClientServer {
     return sender;
   }
 
-  void Overlay::BroadcastToServers(const QString &method, const QVariant &data)
+  void Overlay::SendNotification(const QList<Connections::Id> &to,
+      const QString &method, const QVariant &data)
   {
-    foreach(const Connections::Id &id, GetServerIds()) {
-      SendNotification(id, method, data);
+    QList<QSharedPointer<Messaging::ISender> > senders;
+    foreach(const Connections::Id &id, to) {
+      senders.append(GetSender(id));
     }
+    GetRpcHandler()->SendNotification(senders, method, data);
+  }
+
+  void Overlay::BroadcastToServers(const QString &method, const QVariant &data)
+  {
+    SendNotification(GetServerIds(), method, data);
   }
 
   void Overlay::Broadcast(const QString &method, const QVariant &data)
@@ -107,11 +184,198 @@ namespace ClientServer {
     msg.append(method);
     msg.append(data);
 
+    QList<QSharedPointer<Messaging::ISender> > senders;
+    foreach(const QSharedPointer<Connections::Connection> &con,
+        GetConnectionTable().GetConnections())
+    {
+      // Clients reach the group through their servers, not their relay peers
+      if(!AmServer() && !IsServer(con->GetRemoteId())) {
+        continue;
+      }
+      senders.append(con);
+    }
+    GetRpcHandler()->SendNotification(senders, "CS::Broadcast", msg);
+  }
+
+  void Overlay::BroadcastToClients(const QString &method, const QVariant &data)
+  {
+    Q_ASSERT(AmServer());
+
+    QList<Connections::Id> clients;
+    QVariantList targets;
     foreach(const QSharedPointer<Connections::Connection> &con,
         GetConnectionTable().GetConnections())
     {
-      GetRpcHandler()->SendNotification(con, "CS::Broadcast", msg);
+      Connections::Id con_id = con->GetRemoteId();
+      if(IsServer(con_id)) {
+        continue;
+      }
+      clients.append(con_id);
+
+      QVariantList target;
+      target.append(con_id.GetByteArray());
+      target.append(con->GetEdge()->GetRemotePersistentAddress().ToString());
+      targets.append(QVariant(target));
+    }
+
+    if(RelayFanout < 1 || method != RelayMethod || !m_relay_key) {
+      SendNotification(clients, method, data);
+      return;
+    }
+
+    // The server heads the tree without a target of its own
+    QVariant head = QVariant(QVariantList());
+    QByteArray source = GetId().GetByteArray();
+    QVariantList digests = ChildDigests(targets, RelayFanout);
+    QByteArray signature = m_relay_key->Sign(RelaySignedData(source, data,
+          RelayFanout, LevelDigest(head, digests)));
+    Relay(source, data, RelayFanout, targets, digests, QVariantList(), head,
+        signature);
+  }
+
+  void Overlay::Relay(const QByteArray &source, const QVariant &data,
+      int fanout, const QVariantList &targets, const QVariantList &digests,
+      const QVariantList &proof, const QVariant &head,
+      const QByteArray &signature)
+  {
+    QSet<Connections::Id> children;
+    QList<int> bounds = SplitTargets(targets.count(), fanout);
+    for(int idx = 0; idx + 1 < bounds.count(); idx++) {
+      int start = bounds[idx];
+      QVariantList subtree = targets.mid(start, bounds[idx + 1] - start);
+      QVariantList child = subtree[0].toList();
+      if(child.size() != 2) {
+        qDebug() << "Received a bad relay target:" << child;
+        continue;
+      }
+
+      QVariantList level;
+      level.append(head);
+      level.append(QVariant(digests));
+      level.append(idx);
+      QVariantList child_proof = proof;
+      child_proof.append(QVariant(level));
+
+      QVariantList msg;
+      msg.append(source);
+      msg.append(RelayMethod);
+      msg.append(data);
+      msg.append(fanout);
+      msg.append(QVariant(subtree));
+      msg.append(QVariant(child_proof));
+      msg.append(signature);
+
+      Connections::Id to(child[0].toByteArray());
+      children.insert(to);
+      GetRpcHandler()->SendNotification(GetRelaySender(to, child[1].toString()),
+          "CS::Relay", msg);
     }
+
+    m_relay_attempts.intersect(children);
+  }
+
+  QSharedPointer<Messaging::ISender> Overlay::GetRelaySender(
+      const Connections::Id &to, const QString &address)
+  {
+    QSharedPointer<Messaging::ISender> sender = GetConnectionTable().GetConnection(to);
+    if(sender) {
+      return sender;
+    }
+
+    // Relay through the servers this time, and only try connecting once
+    if(!m_relay_attempts.contains(to)) {
+      m_relay_attempts.insert(to);
+      Transports::Address addr = AddressFactory::GetInstance().CreateAddress(address);
+      if(addr.Valid()) {
+        m_cm->ConnectTo(addr);
+      }
+    }
+    return GetSender(to);
+  }
+
+  void Overlay::RelayHelper(const Messaging::Request &notification)
+  {
+    QVariantList msg = notification.GetData().toList();
+    if(msg.size() != 7) {
+      qDebug() << "Received a bad CS::Relay message:" << msg;
+      return;
+    }
+
+    QByteArray bsource = msg[0].toByteArray();
+    Connections::Id source(bsource);
+    if(!IsServer(source) || AmServer()) {
+      qDebug() << "Received a CS::Relay message not from a server to a client";
+      return;
+    }
+
+    QString method = msg[1].toString();
+    if(method != RelayMethod) {
+      qDebug() << "Received a relay message for another method:" << method;
+      return;
+    }
+
+    // The fanout sets how many children this node sends to
+    int fanout = msg[3].toInt();
+    if(fanout < 1 || fanout > RelayFanout) {
+      qDebug() << "Received a relay message with an invalid fanout:" << fanout;
+      return;
+    }
+
+    QVariantList targets = msg[4].toList();
+    QVariantList proof = msg[5].toList();
+    if(targets.isEmpty() || proof.isEmpty() ||
+        targets[0].toList().value(0).toByteArray() != GetId().GetByteArray())
+    {
+      qDebug() << "Received a relay message for another node";
+      return;
+    }
+
+    // Only the parent in the tree may relay to this node
+    QByteArray parent = proof.count() == 1 ? bsource :
+      proof.last().toList().value(0).toList().value(0).toByteArray();
+    QSharedPointer<Connections::IOverlaySender> from =
+      notification.GetFrom().dynamicCast<Connections::IOverlaySender>();
+    if(!from || from->GetRemoteId().GetByteArray() != parent) {
+      qDebug() << "Received a relay message from a node other than its parent";
+      return;
+    }
+
+    // Rebuild the root of the tree from this subtree and the levels above
+    QVariantList digests = ChildDigests(targets.mid(1), fanout);
+    QByteArray digest = LevelDigest(targets[0], digests);
+    for(int idx = proof.count() - 1; idx >= 0; idx--) {
+      QVariantList level = proof[idx].toList();
+      QVariantList siblings = level.value(1).toList();
+      int index = level.value(2).toInt();
+      if(level.size() != 3 || index < 0 || index >= siblings.count()) {
+        qDebug() << "Received a relay message with a bad proof";
+        return;
+      }
+      siblings[index] = digest;
+      digest = LevelDigest(level[0], siblings);
+    }
+
+    QSharedPointer<Crypto::AsymmetricKey> key;
+    if(m_relay_keys) {
+      key = m_relay_keys->GetKey(source.ToString());
+    }
+
+    QByteArray signature = msg[6].toByteArray();
+    if(!key || !key->Verify(RelaySignedData(bsource, msg[2], fanout, digest),
+          signature))
+    {
+      qDebug() << "Received a relay message with an invalid signature";
+      return;
+    }
+
+    // Pass it on before processing it locally, so the tree's depth adds as
+    // little delay as possible
+    Relay(bsource, msg[2], fanout, targets.mid(1), digests, proof,
+        targets[0], signature);
+
+    QVariantList fwded_msg = Messaging::Request::BuildNotification(
+        notification.GetId(), method, msg[2]);
+    GetRpcHandler()->HandleData(GetSender(source), fwded_msg);
   }
 
   void Overlay::BroadcastHelper(const Messaging::Request &notification)
@@ -163,6 +427,7 @@ namespace ClientServer {
     }
 
     Connections::Id forwarder = from->GetRemoteId();
+    QList<QSharedPointer<Messaging::ISender> > senders;
     if(IsServer(forwarder)) {
       // Was forwarded by a server ... forward only to client
       foreach(const QSharedPointer<Connections::Connection> &con,
@@ -172,8 +437,7 @@ namespace ClientServer {
         if(IsServer(con->GetRemoteId()) || (local_id == con_id)) {
           continue;
         }
-
-        GetRpcHandler()->SendNotification(con, "CS::Broadcast", msg);
+        senders.append(con);
       }
     } else {
       // Was forwarded by a client ... forward to all
@@ -187,9 +451,10 @@ namespace ClientServer {
         {
           continue;
         }
-        GetRpcHandler()->SendNotification(con, "CS::Broadcast", msg);
+        senders.append(con);
       }
     }
+    GetRpcHandler()->SendNotification(senders, "CS::Broadcast", msg);
   }
 
   void Overlay::Forward(const Connections::Id &to, const QByteArray &data)
@@ -206,6 +471,8 @@ namespace ClientServer {
         GetConnectionTable().GetConnections()) {
       if(lcon->GetRemoteId() == GetId()) {
         continue;
+      } else if(!AmServer() && !IsServer(lcon->GetRemoteId())) {
+        continue;
       }
       con = lcon;
       ForwardingSend(GetId().ToString(), con, to, data);
@@ -2,6 +2,7 @@
 #define DISSENT_CLIENT_SERVER_OVERLAY_H_GUARD
 
 #include <QObject>
+#include <QSet>
 #include <QSharedPointer>
 
 #include "Connections/ConnectionAcquirer.hpp"
@@ -9,6 +10,8 @@
 #include "Connections/ConnectionTable.hpp"
 #include "Connections/Id.hpp"
 #include "Connections/IForwarder.hpp"
+#include "Crypto/AsymmetricKey.hpp"
+#include "Crypto/KeyShare.hpp"
 #include "Messaging/RpcHandler.hpp"
 #include "Transports/Address.hpp"
 #include "Utils/StartStopSlots.hpp"
@@ -124,6 +127,15 @@ namespace ClientServer {
         GetRpcHandler()->SendNotification(GetSender(to), method, data);
       }
 
+      /**
+       * Send the same notification to many destinations, serializing it once
+       * @param to the destinations for the notification
+       * @param method the remote method
+       * @param data the input data for that method
+       */
+      virtual void SendNotification(const QList<Connections::Id> &to,
+          const QString &method, const QVariant &data);
+
       /**
        * Send a request
        * @param id the destination for the request
@@ -158,8 +170,49 @@ namespace ClientServer {
        */
       virtual void BroadcastToServers(const QString &method, const QVariant &data);
 
+      /**
+       * Send a notification from a server to all of its clients.  When
+       * RelayFanout is set, the method is RelayMethod, and relay keys are
+       * set, the server sends to at most RelayFanout clients, each of which
+       * relays to at most RelayFanout more, along a tree spanning the
+       * clients.  The server signs the data together with the tree, so a
+       * client only accepts a relay from its parent in that tree and relays
+       * only to its own subtree.  Relays deliver the data as coming from the
+       * server and may drop it, so the data should still carry the server's
+       * signature.
+       * @param method The Rpc to call
+       * @param data Data to be sent to all clients
+       */
+      virtual void BroadcastToClients(const QString &method, const QVariant &data);
+
+      /**
+       * Sets the keys securing BroadcastToClients relays, servers sign each
+       * tree with their key and clients check it with the server's key from
+       * the share.  Until set, servers send to clients directly and clients
+       * drop relayed data.
+       * @param key the local private key
+       * @param keys the public keys, named by id
+       */
+      void SetRelayKeys(const QSharedPointer<Crypto::AsymmetricKey> &key,
+          const QSharedPointer<Crypto::KeyShare> &keys)
+      {
+        m_relay_key = key;
+        m_relay_keys = keys;
+      }
+
       virtual void Forward(const Connections::Id &to, const QByteArray &data);
 
+      /**
+       * Children per node of the tree along which BroadcastToClients
+       * reaches clients, 0 for servers to send to each client directly
+       */
+      static int RelayFanout;
+
+      /**
+       * The only Rpc delivered along the BroadcastToClients tree
+       */
+      static const QString RelayMethod;
+
     signals:
       /**
        * Emitted when disconnected
@@ -177,6 +230,34 @@ namespace ClientServer {
 
     private:
       QSharedPointer<Messaging::ISender> GetSender(const Connections::Id &to);
+
+      /**
+       * Sends data to the head of each of up to fanout subtrees of targets,
+       * the remainder of a subtree goes along to its head to relay further.
+       * Each child also receives the levels of the tree above it, which
+       * prove its subtree is part of the tree the server signed.
+       * @param source the server that broadcast the data
+       * @param data the data
+       * @param fanout children per node of the tree
+       * @param targets an id and persistent address for each client
+       * @param digests the digest of each subtree of targets
+       * @param proof the levels above the local node, empty at the server
+       * @param head the local target, empty at the server
+       * @param signature the server's signature over the data and tree
+       */
+      void Relay(const QByteArray &source, const QVariant &data, int fanout,
+          const QVariantList &targets, const QVariantList &digests,
+          const QVariantList &proof, const QVariant &head,
+          const QByteArray &signature);
+
+      /**
+       * Returns a sender to a relay child, connecting to it directly for
+       * later relays if this is not already possible
+       * @param to the child
+       * @param address the child's persistent address
+       */
+      QSharedPointer<Messaging::ISender> GetRelaySender(
+          const Connections::Id &to, const QString &address);
       void ForwardingSend(const QString &from,
           const QSharedPointer<Connections::Connection> &con,
           const Connections::Id &to,
@@ -195,6 +276,14 @@ namespace ClientServer {
       QList<QSharedPointer<Connections::ConnectionAcquirer> > m_con_acquirers;
       QWeakPointer<Overlay> m_shared;
 
+      /**
+       * Relay children a connection has been attempted to, only the
+       * children of the latest relay are kept
+       */
+      QSet<Connections::Id> m_relay_attempts;
+      QSharedPointer<Crypto::AsymmetricKey> m_relay_key;
+      QSharedPointer<Crypto::KeyShare> m_relay_keys;
+
       typedef Messaging::Request Request;
 
     private slots:
@@ -209,6 +298,13 @@ namespace ClientServer {
       virtual void ForwardedData(const Request &notification);
 
       void BroadcastHelper(const Request &notification);
+
+      /**
+       * Delivers and relays data sent along a BroadcastToClients tree after
+       * checking that it came from the local node's parent in a tree signed
+       * by the server
+       */
+      void RelayHelper(const Request &notification);
   };
 }
 }
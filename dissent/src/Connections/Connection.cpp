@@ -7,12 +7,15 @@ namespace Connections {
       const Id &remote_id) :
     _edge(edge),
     _local_id(local_id),
-    _remote_id(remote_id)
+    _remote_id(remote_id),
+    _held_bytes(0)
   {
     ISink *sink = _edge->SetSink(this);
     SetSink(sink);
     QObject::connect(_edge.data(), SIGNAL(StoppedSignal()),
         this, SLOT(HandleEdgeClose()));
+    QObject::connect(_edge.data(), SIGNAL(WriteQueueDrained()),
+        this, SLOT(HandleWriteQueueDrained()));
   }
 
   QString Connection::ToString() const
@@ -30,7 +33,30 @@ namespace Connections {
 
   void Connection::Send(const QByteArray &data)
   {
-    _edge->Send(data);
+    if(_edge->Stopped() || !Congested()) {
+      _edge->Send(data);
+      return;
+    }
+
+    if(_edge->GetBytesQueued() + _held_bytes + data.size() > MaximumBacklog) {
+      qWarning() << "Send backlog exceeded on:" << ToString();
+      _held.clear();
+      _held_bytes = 0;
+      _edge->Stop("Send backlog exceeded");
+      return;
+    }
+
+    _held.append(data);
+    _held_bytes += data.size();
+  }
+
+  void Connection::HandleWriteQueueDrained()
+  {
+    while(!_held.isEmpty() && !_edge->Congested() && !_edge->Stopped()) {
+      QByteArray data = _held.takeFirst();
+      _held_bytes -= data.size();
+      _edge->Send(data);
+    }
   }
 
   void Connection::HandleEdgeClose()
@@ -2,6 +2,7 @@
 #define DISSENT_CONNECTIONS_CONNECTION_H_GUARD
 
 #include <QDebug>
+#include <QList>
 #include <QObject>
 #include <QSharedPointer>
 
@@ -49,11 +50,35 @@ namespace Connections {
       virtual void Disconnect();
 
       /**
-       * Send data through the connection!
+       * Send data through the connection!  While the edge is congested, data
+       * is held back and passed to the edge once it drains.  If the edge and
+       * held data exceed MaximumBacklog, the remote peer is not keeping up and
+       * the edge is stopped.
        * @param data the data to send
        */
       virtual void Send(const QByteArray &data);
 
+      /**
+       * True if the edge is congested or data is being held back
+       */
+      bool Congested() const { return _edge->Congested() || !_held.isEmpty(); }
+
+      /**
+       * Returns the number of bytes held back while the edge is congested
+       */
+      qint64 GetBytesHeld() const { return _held_bytes; }
+
+      /**
+       * Bytes that may be queued on the edge and held back by the connection
+       * before the edge is stopped
+       */
+      static const qint64 MaximumBacklog = 64 * 1024 * 1024;
+
+      /**
+       * Returns the RPC wire format negotiated on the underlying edge
+       */
+      virtual int GetWireVersion() const { return _edge->GetWireVersion(); }
+
       /**
        * Returns the underlying edge
        */
@@ -120,11 +145,26 @@ namespace Connections {
 
       QWeakPointer<Connection> _shared;
 
+      /**
+       * Data waiting for the edge to drain
+       */
+      QList<QByteArray> _held;
+
+      /**
+       * Total size of _held
+       */
+      qint64 _held_bytes;
+
     private slots:
       /**
        * Called when the _edge is closed
        */
       void HandleEdgeClose();
+
+      /**
+       * Called when the _edge's write queue has drained, sends held data
+       */
+      void HandleWriteQueueDrained();
   };
 }
 }
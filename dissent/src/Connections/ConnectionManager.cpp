@@ -162,6 +162,10 @@ namespace Connections {
     QSharedPointer<EdgeListener> el = _edge_factory.GetEdgeListener(type);
     request["persistent"] = el->GetAddress().ToString();
     request["version"] = VERSION;
+    request["wire_version"] = RpcHandler::WireVersion;
+    if(Edge::CompressionLevel > 0) {
+      request["compression"] = true;
+    }
 
     _rpc->SendRequest(edge, "CM::Inquire", request, _inquired);
   }
@@ -247,7 +251,24 @@ namespace Connections {
 
     Id rem_id(brem_id);
 
-    request.Respond(_local_id.GetByteArray());
+    // Peers that predate wire negotiation expect only our id in response
+    if(data.contains("wire_version")) {
+      int wire_version = qMin(data.value("wire_version").toInt(),
+          int(RpcHandler::WireVersion));
+      QVariantHash response;
+      response["peer_id"] = _local_id.GetByteArray();
+      response["wire_version"] = wire_version;
+      bool compression = data.value("compression").toBool() &&
+        Edge::CompressionLevel > 0;
+      if(compression) {
+        response["compression"] = true;
+      }
+      request.Respond(response);
+      edge->SetWireVersion(wire_version);
+      edge->SetCompression(compression);
+    } else {
+      request.Respond(_local_id.GetByteArray());
+    }
 
     QString saddr = data.value("persistent").toString();
     Address addr = AddressFactory::GetInstance().CreateAddress(saddr);
@@ -273,7 +294,19 @@ namespace Connections {
       return;
     }
 
-    QByteArray brem_id = response.GetData().toByteArray();
+    QByteArray brem_id;
+    QVariant data = response.GetData();
+    if(data.type() == QVariant::Hash) {
+      QVariantHash hash = data.toHash();
+      brem_id = hash.value("peer_id").toByteArray();
+      edge->SetWireVersion(qMin(hash.value("wire_version").toInt(),
+            int(RpcHandler::WireVersion)));
+      edge->SetCompression(hash.value("compression").toBool() &&
+          Edge::CompressionLevel > 0);
+    } else {
+      brem_id = data.toByteArray();
+    }
+
     if(brem_id.isEmpty()) {
       qWarning() << "Invalid ConnectionEstablished, no id";
       return;
@@ -281,7 +314,6 @@ namespace Connections {
 
     Id rem_id(brem_id);
 
-
     if(_local_id < rem_id) {
       BindEdge(edge, rem_id);
     } else if(rem_id == _local_id) {
@@ -1,9 +1,46 @@
 #include "Crypto/Hash.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "AbstractGroup.hpp"
 
 namespace Dissent {
 namespace Crypto {
 namespace AbstractGroup {
+    namespace {
+      /**
+       * Group operations for MultiExponentiation
+       */
+      struct ElementOps {
+        typedef Element Value;
+
+        ElementOps(const AbstractGroup *group) : group(group) {}
+
+        Value Identity() const { return group->GetIdentity(); }
+        Value Multiply(const Value &a, const Value &b) const { return group->Multiply(a, b); }
+        Value Square(const Value &a) const { return group->Multiply(a, a); }
+
+        const AbstractGroup *group;
+      };
+    }
+
+    Element AbstractGroup::MultiExponentiate(const QVector<Element> &bases,
+        const QVector<Integer> &exps) const
+    {
+      Q_ASSERT(bases.size() == exps.size());
+      QVector<Element> nbases;
+      QVector<QByteArray> nexps;
+      for(int idx = 0; idx < bases.size(); idx++) {
+        // a^-e = (a^-1)^e
+        if(exps[idx] < 0) {
+          nbases.append(Inverse(bases[idx]));
+          nexps.append((Integer(0) - exps[idx]).GetByteArray());
+        } else {
+          nbases.append(bases[idx]);
+          nexps.append(exps[idx].GetByteArray());
+        }
+      }
+
+      return MultiExponentiation::Compute(ElementOps(this), nbases, nexps);
+    }
 
     Element AbstractGroup::HashIntoElement(const QByteArray &to_hash) const
     {
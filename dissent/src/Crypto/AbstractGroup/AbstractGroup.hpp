@@ -3,6 +3,7 @@
 
 #include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
 #include "Crypto/Integer.hpp"
 #include "Element.hpp"
@@ -29,6 +30,9 @@ namespace AbstractGroup {
    * for an elliptic curve point P and scalar A, you would
    * use:
    *    Element A = group->Exponentiate(P, k);
+   *
+   * Groups are immutable once constructed and may be shared by several
+   * threads, as may Elements.
    */
   class AbstractGroup {
 
@@ -65,6 +69,18 @@ namespace AbstractGroup {
        */
       virtual Element Exponentiate(const Element &a, const Integer &exp) const = 0;
 
+      /**
+       * Exponentiate a base that is used many times, such as the generator
+       * or a long-lived public key.  Groups may keep precomputed powers of
+       * the base across calls, the default simply calls Exponentiate.
+       * @param a base
+       * @param exp exponent
+       */
+      virtual Element ExponentiateFixedBase(const Element &a, const Integer &exp) const
+      {
+        return Exponentiate(a, exp);
+      }
+
       /**
        * Compute (a1^e1 * a2^e2). Generally this can be done much faster
        * than two exponentiations.
@@ -76,6 +92,16 @@ namespace AbstractGroup {
       virtual Element CascadeExponentiate(const Element &a1, const Integer &e1,
           const Element &a2, const Integer &e2) const = 0;
 
+      /**
+       * Compute the product of bases[i]^exps[i], sharing work across the
+       * bases: Straus' method for few bases, Pippenger's for many.  The
+       * default is built upon Multiply, groups may provide faster versions.
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      virtual Element MultiExponentiate(const QVector<Element> &bases,
+          const QVector<Integer> &exps) const;
+
       /**
        * Compute b such that ab is the group identity
        * @param a element to invert
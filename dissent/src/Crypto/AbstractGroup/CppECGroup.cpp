@@ -1,15 +1,156 @@
 #include <QDataStream>
 #include <QDebug>
+#include <QMutexLocker>
+#include <cryptopp/modarith.h>
 #include <cryptopp/nbtheory.h>
 
 #include "Crypto/CryptoRandom.hpp"
 #include "Crypto/CryptoPP/Helper.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "CppECElementData.hpp"
 #include "CppECGroup.hpp"
 
 namespace Dissent {
 namespace Crypto {
 namespace AbstractGroup {
+  namespace {
+    /**
+     * A point in Jacobian coordinates (X/Z^2, Y/Z^3), Z = 0 is the identity
+     */
+    struct JacobianPoint {
+      CryptoPP::Integer x, y, z;
+    };
+
+    /**
+     * Point addition and doubling in Jacobian coordinates, avoiding the
+     * field inversion affine addition needs.  Coordinates are held in
+     * Montgomery form.  Formulas are add-1998-cmo-2 and dbl-1998-cmo-2.
+     */
+    class JacobianOps {
+      public:
+        typedef JacobianPoint Value;
+
+        JacobianOps(const CryptoPP::ECP &curve) :
+          _p(curve.FieldSize()),
+          _field(_p),
+          _a(_field.ConvertIn(curve.GetA()))
+        {
+        }
+
+        Value Identity() const { return Value(); }
+
+        Value ConvertIn(const CryptoPP::ECPPoint &point) const
+        {
+          Value out;
+          if(!point.identity) {
+            out.x = _field.ConvertIn(point.x);
+            out.y = _field.ConvertIn(point.y);
+            out.z = _field.MultiplicativeIdentity();
+          }
+          return out;
+        }
+
+        CryptoPP::ECPPoint ConvertOut(const Value &point) const
+        {
+          if(point.z.IsZero()) {
+            return CryptoPP::ECPPoint();
+          }
+
+          CryptoPP::Integer x = _field.ConvertOut(point.x);
+          CryptoPP::Integer y = _field.ConvertOut(point.y);
+          CryptoPP::Integer z_inv = _field.ConvertOut(point.z).InverseMod(_p);
+          CryptoPP::Integer z_inv2 = a_times_b_mod_c(z_inv, z_inv, _p);
+          CryptoPP::Integer z_inv3 = a_times_b_mod_c(z_inv2, z_inv, _p);
+          return CryptoPP::ECPPoint(a_times_b_mod_c(x, z_inv2, _p),
+              a_times_b_mod_c(y, z_inv3, _p));
+        }
+
+        Value Square(const Value &point) const
+        {
+          if(point.z.IsZero() || point.y.IsZero()) {
+            return Value();
+          }
+
+          CryptoPP::Integer xx = Sq(point.x);
+          CryptoPP::Integer yy = Sq(point.y);
+          CryptoPP::Integer yyyy = Sq(yy);
+          CryptoPP::Integer zz = Sq(point.z);
+
+          // s = 4xy^2, m = 3x^2 + az^4
+          CryptoPP::Integer s = Dbl(Dbl(Mul(point.x, yy)));
+          CryptoPP::Integer m = Add(Add(Dbl(xx), xx), Mul(_a, Sq(zz)));
+
+          Value out;
+          out.x = Sub(Sq(m), Dbl(s));
+          out.y = Sub(Mul(m, Sub(s, out.x)), Dbl(Dbl(Dbl(yyyy))));
+          out.z = Dbl(Mul(point.y, point.z));
+          return out;
+        }
+
+        Value Multiply(const Value &p1, const Value &p2) const
+        {
+          if(p1.z.IsZero()) {
+            return p2;
+          } else if(p2.z.IsZero()) {
+            return p1;
+          }
+
+          CryptoPP::Integer z1z1 = Sq(p1.z);
+          CryptoPP::Integer z2z2 = Sq(p2.z);
+          CryptoPP::Integer u1 = Mul(p1.x, z2z2);
+          CryptoPP::Integer u2 = Mul(p2.x, z1z1);
+          CryptoPP::Integer s1 = Mul(Mul(p1.y, p2.z), z2z2);
+          CryptoPP::Integer s2 = Mul(Mul(p2.y, p1.z), z1z1);
+          CryptoPP::Integer h = Sub(u2, u1);
+          CryptoPP::Integer r = Sub(s2, s1);
+
+          if(h.IsZero()) {
+            return r.IsZero() ? Square(p1) : Value();
+          }
+
+          CryptoPP::Integer hh = Sq(h);
+          CryptoPP::Integer hhh = Mul(h, hh);
+          CryptoPP::Integer v = Mul(u1, hh);
+
+          Value out;
+          out.x = Sub(Sub(Sq(r), hhh), Dbl(v));
+          out.y = Sub(Mul(r, Sub(v, out.x)), Mul(s1, hhh));
+          out.z = Mul(Mul(p1.z, p2.z), h);
+          return out;
+        }
+
+      private:
+        // The field returns references to its scratch space, copy them out
+        CryptoPP::Integer Add(const CryptoPP::Integer &a, const CryptoPP::Integer &b) const
+        {
+          return _field.Add(a, b);
+        }
+
+        CryptoPP::Integer Sub(const CryptoPP::Integer &a, const CryptoPP::Integer &b) const
+        {
+          return _field.Subtract(a, b);
+        }
+
+        CryptoPP::Integer Dbl(const CryptoPP::Integer &a) const
+        {
+          return _field.Double(a);
+        }
+
+        CryptoPP::Integer Mul(const CryptoPP::Integer &a, const CryptoPP::Integer &b) const
+        {
+          return _field.Multiply(a, b);
+        }
+
+        CryptoPP::Integer Sq(const CryptoPP::Integer &a) const
+        {
+          return _field.Square(a);
+        }
+
+        CryptoPP::Integer _p;
+        CryptoPP::MontgomeryRepresentation _field;
+        CryptoPP::Integer _a;
+    };
+  }
 
   CppECGroup::CppECGroup(const Integer &p, const Integer &q, const Integer &a,
       const Integer &b, const Integer &gx, const Integer &gy) :
@@ -29,6 +170,42 @@ namespace AbstractGroup {
       Q_ASSERT(ToCppInteger(p) == _curve.FieldSize());
     };
 
+  CppECGroup::CppECGroup(const CppECGroup &other) :
+    AbstractGroup(),
+    _curve(other._curve),
+    _q(other._q),
+    _g(other._g),
+    _field_bytes(other._field_bytes)
+  {
+  }
+
+  CppECGroup::~CppECGroup()
+  {
+    qDeleteAll(_curves);
+  }
+
+  CppECGroup::Curve::Curve(const CppECGroup &group) :
+    _group(group),
+    _curve(0)
+  {
+    {
+      QMutexLocker locker(&_group._curves_lock);
+      if(!_group._curves.isEmpty()) {
+        _curve = _group._curves.takeLast();
+      }
+    }
+
+    if(!_curve) {
+      _curve = new CryptoPP::ECP(_group._curve);
+    }
+  }
+
+  CppECGroup::Curve::~Curve()
+  {
+    QMutexLocker locker(&_group._curves_lock);
+    _group._curves.append(_curve);
+  }
+
   QSharedPointer<AbstractGroup> CppECGroup::Copy() const
   {
     return QSharedPointer<CppECGroup>(new CppECGroup(*this));
@@ -50,48 +227,73 @@ namespace AbstractGroup {
 
   Element CppECGroup::Multiply(const Element &a, const Element &b) const
   {
-    return Element(new CppECElementData(_curve.Add(GetPoint(a), GetPoint(b))));
+    return Element(new CppECElementData(Curve(*this)->Add(GetPoint(a), GetPoint(b))));
   }
 
   Element CppECGroup::Exponentiate(const Element &a, const Integer &exp) const
   {
-    return Element(new CppECElementData(_curve.Multiply(ToCppInteger(exp), GetPoint(a))));
+    return Element(new CppECElementData(
+          Curve(*this)->Multiply(ToCppInteger(exp), GetPoint(a))));
   }
   
   Element CppECGroup::CascadeExponentiate(const Element &a1, const Integer &e1,
       const Element &a2, const Integer &e2) const
   {
-    // For some reason, this is 50% faster than Crypto++'s native
-    // CascadeMultiply
-    return Element(new CppECElementData(_curve.Add(
-            _curve.Multiply(ToCppInteger(e1), GetPoint(a1)),
-            _curve.Multiply(ToCppInteger(e2), GetPoint(a2)))));
-   
-    /*
-    return Element(new CppECElementData(_curve.CascadeMultiply(
-          ToCppInteger(e1), GetPoint(a1),
-          ToCppInteger(e2), GetPoint(a2))));
-    */
-    
+    // Crypto++'s CascadeMultiply works in affine coordinates and is slower
+    // than two separate multiplications, Straus in Jacobian coordinates
+    // shares the doublings without paying for an inversion per addition
+    QVector<Element> bases;
+    bases << a1 << a2;
+    QVector<Integer> exps;
+    exps << e1 << e2;
+    return MultiExponentiate(bases, exps);
+  }
+
+  Element CppECGroup::MultiExponentiate(const QVector<Element> &bases,
+      const QVector<Integer> &exps) const
+  {
+    Q_ASSERT(bases.size() == exps.size());
+    JacobianOps ops(_curve);
+
+    QVector<JacobianPoint> points;
+    QVector<QByteArray> scalars;
+    for(int idx = 0; idx < bases.size(); idx++) {
+      CryptoPP::ECPPoint point = GetPoint(bases[idx]);
+      CryptoPP::Integer exp = ToCppInteger(exps[idx]);
+      // -eP = e(-P)
+      if(exp.IsNegative()) {
+        point = Curve(*this)->Inverse(point);
+        exp = -exp;
+      }
+
+      QByteArray encoded(exp.MinEncodedSize(), 0);
+      exp.Encode(reinterpret_cast<byte *>(encoded.data()), encoded.size());
+
+      points.append(ops.ConvertIn(point));
+      scalars.append(encoded);
+    }
+
+    return Element(new CppECElementData(ops.ConvertOut(
+            MultiExponentiation::Compute(ops, points, scalars))));
   }
 
   Element CppECGroup::Inverse(const Element &a) const
   {
-    return Element(new CppECElementData(_curve.Inverse(GetPoint(a))));
+    return Element(new CppECElementData(Curve(*this)->Inverse(GetPoint(a))));
   }
   
   QByteArray CppECGroup::ElementToByteArray(const Element &a) const
   {
     const unsigned int nbytes = _curve.EncodedPointSize(true);
     QByteArray out(nbytes, 0);
-    _curve.EncodePoint((unsigned char*)(out.data()), GetPoint(a), true);
+    Curve(*this)->EncodePoint((unsigned char*)(out.data()), GetPoint(a), true);
     return out;
   }
   
   Element CppECGroup::ElementFromByteArray(const QByteArray &bytes) const 
   { 
     CryptoPP::ECPPoint point;
-    _curve.DecodePoint(point, 
+    Curve(*this)->DecodePoint(point, 
         (const unsigned char*)(bytes.constData()), 
         bytes.count());
     return Element(new CppECElementData(point));
@@ -99,7 +301,7 @@ namespace AbstractGroup {
 
   bool CppECGroup::IsElement(const Element &a) const 
   {
-    return IsIdentity(a) || _curve.VerifyPoint(GetPoint(a));
+    return IsIdentity(a) || Curve(*this)->VerifyPoint(GetPoint(a));
   }
 
   bool CppECGroup::IsIdentity(const Element &a) const 
@@ -1,6 +1,8 @@
 #ifndef DISSENT_CRYPTO_ABSTRACT_GROUP_CPP_EC_GROUP_H_GUARD
 #define DISSENT_CRYPTO_ABSTRACT_GROUP_CPP_EC_GROUP_H_GUARD
 
+#include <QList>
+#include <QMutex>
 #include <QSharedPointer>
 
 #include "AbstractGroup.hpp"
@@ -15,6 +17,9 @@ namespace AbstractGroup {
    * This class represents an elliptic curve modulo
    * a prime. The curves take the form:
    *   y^2 = x^3 + ax + b (mod p)
+   * Crypto++ curves keep scratch space for their arithmetic, so each
+   * operation borrows a private copy of the curve from a pool, allowing the
+   * group to be shared across threads.
    */
   class CppECGroup : public AbstractGroup {
 
@@ -32,6 +37,11 @@ namespace AbstractGroup {
       CppECGroup(const Integer &p, const Integer &q, const Integer &a,
           const Integer &b, const Integer &gx, const Integer &gy);
 
+      /**
+       * Copy constructor, the copy starts with an empty pool of curves
+       */
+      CppECGroup(const CppECGroup &other);
+
       /**
        * Get a fixed group 
        */
@@ -40,7 +50,7 @@ namespace AbstractGroup {
       /**
        * Destructor
        */
-      virtual ~CppECGroup() {}
+      virtual ~CppECGroup();
 
       /**
        * Return a pointer to a copy of this group
@@ -72,6 +82,15 @@ namespace AbstractGroup {
       virtual Element CascadeExponentiate(const Element &a1, const Integer &e1,
           const Element &a2, const Integer &e2) const;
 
+      /**
+       * Compute the sum of exps[i]bases[i], in Jacobian coordinates so that
+       * only the final point needs a field inversion
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      virtual Element MultiExponentiate(const QVector<Element> &bases,
+          const QVector<Integer> &exps) const;
+
       /**
        * Compute b such that a+b = O (identity)
        * @param a element to invert
@@ -205,6 +224,26 @@ namespace AbstractGroup {
 
     private:
 
+      /**
+       * Borrows a curve from the pool for the lifetime of the object
+       */
+      class Curve {
+        public:
+          explicit Curve(const CppECGroup &group);
+          ~Curve();
+
+          const CryptoPP::ECP *operator->() const { return _curve; }
+          const CryptoPP::ECP &operator*() const { return *_curve; }
+
+        private:
+          Q_DISABLE_COPY(Curve)
+
+          const CppECGroup &_group;
+          CryptoPP::ECP *_curve;
+      };
+
+      CppECGroup &operator=(const CppECGroup &);
+
       CryptoPP::ECPPoint GetPoint(const Element &e) const;
 
       /** 
@@ -215,7 +254,14 @@ namespace AbstractGroup {
        */
       bool SolveForY(const CryptoPP::Integer &x, Element &point) const;
 
+      /**
+       * Only used for its parameters, arithmetic goes through Curve
+       */
       CryptoPP::ECP _curve;
+
+      mutable QMutex _curves_lock;
+      mutable QList<CryptoPP::ECP *> _curves;
+
       Integer _q;
       CryptoPP::ECPPoint _g;
 
@@ -1,6 +1,7 @@
 #include <QDataStream>
 #include <QDebug>
 #include "Crypto/CryptoRandom.hpp"
+#include "Crypto/FixedBase.hpp"
 #include "IntegerElementData.hpp"
 #include "IntegerGroup.hpp"
 
@@ -181,6 +182,14 @@ namespace AbstractGroup {
   {
     return Element(new IntegerElementData(GetInteger(a).Pow(exp, _p))); 
   }
+
+  Element IntegerGroup::ExponentiateFixedBase(const Element &a, const Integer &exp) const
+  {
+    const Integer &base = GetInteger(a);
+    FixedBase fixed = (base == _g) ? FixedBase::GetGenerator(_g, _p) :
+      FixedBase::Get(base, _p);
+    return Element(new IntegerElementData(fixed.Pow(exp)));
+  }
   
   Element IntegerGroup::CascadeExponentiate(const Element &a1, const Integer &e1,
       const Element &a2, const Integer &e2) const
@@ -189,6 +198,16 @@ namespace AbstractGroup {
           _p.PowCascade(GetInteger(a1), e1, GetInteger(a2), e2)));
   }
 
+  Element IntegerGroup::MultiExponentiate(const QVector<Element> &bases,
+      const QVector<Integer> &exps) const
+  {
+    QVector<Integer> ibases;
+    foreach(const Element &base, bases) {
+      ibases.append(GetInteger(base));
+    }
+    return Element(new IntegerElementData(Integer::MultiPow(ibases, exps, _p)));
+  }
+
   Element IntegerGroup::Inverse(const Element &a) const
   {
     return Element(new IntegerElementData(GetInteger(a).Inverse(_p)));
@@ -221,7 +240,8 @@ namespace AbstractGroup {
 
   Element IntegerGroup::RandomElement() const
   {
-    return Element(new IntegerElementData(_g.Pow(RandomExponent(), _p)));
+    return Element(new IntegerElementData(
+          FixedBase::GetGenerator(_g, _p).Pow(RandomExponent())));
   }
 
   Integer IntegerGroup::GetInteger(const Element &e) const
@@ -75,6 +75,13 @@ namespace AbstractGroup {
        */
       virtual Element Exponentiate(const Element &a, const Integer &exp) const;
 
+      /**
+       * Exponentiate using a shared table of precomputed powers of a
+       * @param a base
+       * @param exp exponent
+       */
+      virtual Element ExponentiateFixedBase(const Element &a, const Integer &exp) const;
+
       /**
        * Compute (a1^e1 * a2^e2). Generally this can be done much faster
        * than two exponentiations.
@@ -86,6 +93,14 @@ namespace AbstractGroup {
       virtual Element CascadeExponentiate(const Element &a1, const Integer &e1,
           const Element &a2, const Integer &e2) const;
 
+      /**
+       * Compute the product of bases[i]^exps[i] mod p
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      virtual Element MultiExponentiate(const QVector<Element> &bases,
+          const QVector<Integer> &exps) const;
+
       /**
        * Compute b such that ab = 1
        * @param a element to invert
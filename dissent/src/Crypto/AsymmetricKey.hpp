@@ -37,6 +37,7 @@ namespace Crypto {
         RSA = 0,
         DSA,
         LRS,
+        ECDSA,
         OTHER
       };
 
@@ -69,7 +69,7 @@ namespace BlogDrop {
 
       // If some ciphertext is invalid, look for the culprit
       if(!valid) {
-        for(int client_idx=0; client_idx<_client_pubs.count(); client_idx++) {
+        for(int client_idx=0; client_idx<pubs.count(); client_idx++) {
           if(!pubs_out.contains(pubs[client_idx])) bad_clients_out.insert(client_idx);
         }
       }
@@ -140,10 +140,12 @@ namespace BlogDrop {
 
   QSet<int> BlogDropServer::FindBadClients()
   {
-    /// @TODO use threading to speed this up
+    QList<bool> valid = ClientCiphertext::VerifyProofs(_phase,
+        _client_ciphertexts, _client_pubs);
+
     QSet<int> bad;
-    for(int client_idx=0; client_idx<_client_ciphertexts.count(); client_idx++) {
-      if(!_client_ciphertexts[client_idx]->VerifyProof(_phase, _client_pubs[client_idx]))
+    for(int client_idx=0; client_idx<valid.count(); client_idx++) {
+      if(!valid[client_idx])
         bad.insert(client_idx);
     }
 
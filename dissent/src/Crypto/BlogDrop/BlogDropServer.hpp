@@ -109,7 +109,8 @@ namespace BlogDrop {
       }
 
       /**
-       * Look through bin for invalid ciphertexts
+       * Look through bin for invalid ciphertexts, checking each proof on
+       * the thread pool
        */
       QSet<int> FindBadClients();
 
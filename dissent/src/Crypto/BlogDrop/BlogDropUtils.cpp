@@ -111,7 +111,7 @@ namespace BlogDrop {
       QByteArray digest = hashalgo.ComputeHash(params->GetKeyGroup()->ElementToByteArray(shared));
 
       commits.append(QSharedPointer<const PublicKey>(
-            new PublicKey(params, params->GetKeyGroup()->Exponentiate(g, Integer(digest)))));
+            new PublicKey(params, params->GetKeyGroup()->ExponentiateFixedBase(g, Integer(digest)))));
 
       // sum of results (mod q) is the master secret
       out = (out + Integer(digest)) % q;
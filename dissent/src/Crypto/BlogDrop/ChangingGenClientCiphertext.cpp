@@ -94,7 +94,7 @@ namespace BlogDrop {
     QList<Element> ts;
 
     Integer v_auth = _params->GetKeyGroup()->RandomExponent();
-    ts.append(_params->GetKeyGroup()->Exponentiate(gs[0], v_auth));
+    ts.append(_params->GetKeyGroup()->ExponentiateFixedBase(gs[0], v_auth));
 
     ts.append(_params->GetKeyGroup()->CascadeExponentiate(ys[1], w, gs[1], v));
     for(int i=0; i<GetNElements(); i++) { 
@@ -168,6 +168,23 @@ namespace BlogDrop {
 
   bool ChangingGenClientCiphertext::VerifyProof(int phase,
       const QSharedPointer<const PublicKey> &client_pub) const
+  {
+    return VerifyProofWithGenerators(phase, client_pub, QHash<int, Element>());
+  }
+
+  QHash<int, AbstractGroup::Element> ChangingGenClientCiphertext::GetProofGenerators(
+      int phase) const
+  {
+    QHash<int, Element> generators;
+    for(int i=0; i<GetNElements(); i++) {
+      generators[i] = ComputeGenerator(_server_pks, GetAuthorKey(), phase, i);
+    }
+    return generators;
+  }
+
+  bool ChangingGenClientCiphertext::VerifyProofWithGenerators(int phase,
+      const QSharedPointer<const PublicKey> &client_pub,
+      const QHash<int, Element> &generators) const
   {
     if(_elements.count() != GetNElements()) {
       qWarning() << "Got proof with incorrect number of elements (" << _elements.count() << ")";
@@ -195,8 +212,7 @@ namespace BlogDrop {
     QList<Element> gs;
     QList<Element> ys;
 
-    QHash<int, Element> cache;
-    InitializeLists(cache, phase, client_pub, gs, ys);
+    InitializeLists(generators, phase, client_pub, gs, ys);
 
     // t_auth = (y_auth)^c1 * (g_auth)^{r_auth}
     // t(1) = y1^c2 * g1^r2
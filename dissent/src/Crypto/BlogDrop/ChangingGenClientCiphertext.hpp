@@ -85,6 +85,20 @@ namespace BlogDrop {
        */
       virtual bool VerifyProof(int phase, const QSharedPointer<const PublicKey> &client_pub) const;
 
+      /**
+       * Returns the generator for each ciphertext element
+       * @param phase the message transmission phase/round index
+       */
+      virtual QHash<int, Element> GetProofGenerators(int phase) const;
+
+      /**
+       * Check ciphertext proof using precomputed element generators
+       * @returns true if proof is okay
+       */
+      virtual bool VerifyProofWithGenerators(int phase,
+          const QSharedPointer<const PublicKey> &client_pub,
+          const QHash<int, Element> &generators) const;
+
       /**
        * Get a byte array for this ciphertext
        */
@@ -62,7 +62,7 @@ namespace BlogDrop {
 
 
     // t0 = g0^v
-    ts.append(_params->GetKeyGroup()->Exponentiate(gs[0], v));
+    ts.append(_params->GetKeyGroup()->ExponentiateFixedBase(gs[0], v));
 
     for(int i=0; i<_n_elms; i++) {
       // t(i) = g(i)^-v
@@ -111,14 +111,14 @@ namespace BlogDrop {
     // t0 = g0^r * y0^c
     ts.append(_params->GetKeyGroup()->CascadeExponentiate(gs[0], _response, ys[0], _challenge));
 
+    const Integer neg_response = Integer(0) - _response;
     for(int i=0; i<_n_elms; i++) {
       // t(i) = g(i)^-r * y(i)^c
-      Element ti = _params->GetMessageGroup()->Exponentiate(gs[i+1], _response);
-      ti = _params->GetMessageGroup()->Inverse(ti);
-
-      Element ti_tmp = _params->GetMessageGroup()->Exponentiate(ys[i+1], _challenge);
-      ti = _params->GetMessageGroup()->Multiply(ti, ti_tmp);
-      ts.append(ti); 
+      QVector<Element> bases;
+      bases << gs[i+1] << ys[i+1];
+      QVector<Integer> exps;
+      exps << neg_response << _challenge;
+      ts.append(_params->GetMessageGroup()->MultiExponentiate(bases, exps));
     }
 
     Integer tmp = BlogDropUtils::Commit(_params, gs, ys, ts);
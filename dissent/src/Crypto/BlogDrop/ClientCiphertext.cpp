@@ -9,6 +9,74 @@
 namespace Dissent {
 namespace Crypto {
 namespace BlogDrop {
+  namespace {
+    /**
+     * Unpacks the ciphertext at an index
+     */
+    struct UnpackClientCiphertext {
+      typedef QSharedPointer<const ClientCiphertext> result_type;
+
+      UnpackClientCiphertext(const QSharedPointer<const Parameters> &params,
+          const QSharedPointer<const PublicKeySet> &server_pk_set,
+          const QSharedPointer<const PublicKey> &author_pk,
+          const QList<QByteArray> &c) :
+        params(params),
+        server_pk_set(server_pk_set),
+        author_pk(author_pk),
+        c(c)
+      {
+      }
+
+      result_type operator()(int idx) const
+      {
+        return CiphertextFactory::CreateClientCiphertext(params,
+            server_pk_set, author_pk, c[idx]);
+      }
+
+      const QSharedPointer<const Parameters> &params;
+      const QSharedPointer<const PublicKeySet> &server_pk_set;
+      const QSharedPointer<const PublicKey> &author_pk;
+      const QList<QByteArray> &c;
+    };
+
+    /**
+     * Verifies the proof of the ciphertext at an index using the
+     * generators shared by the list
+     */
+    struct VerifyClientCiphertext {
+      typedef bool result_type;
+
+      VerifyClientCiphertext(int phase,
+          const QList<QSharedPointer<const ClientCiphertext> > &ctexts,
+          const QList<QSharedPointer<const PublicKey> > &pubs,
+          const QHash<int, ClientCiphertext::Element> &generators) :
+        phase(phase),
+        ctexts(ctexts),
+        pubs(pubs),
+        generators(generators)
+      {
+      }
+
+      bool operator()(int idx) const
+      {
+        return ctexts[idx]->VerifyProofWithGenerators(phase, pubs[idx], generators);
+      }
+
+      const int phase;
+      const QList<QSharedPointer<const ClientCiphertext> > &ctexts;
+      const QList<QSharedPointer<const PublicKey> > &pubs;
+      const QHash<int, ClientCiphertext::Element> &generators;
+    };
+
+    QList<int> GetIndices(int count)
+    {
+      QList<int> indices;
+      for(int idx=0; idx<count; idx++) {
+        indices.append(idx);
+      }
+      return indices;
+    }
+  }
 
   ClientCiphertext::ClientCiphertext(const QSharedPointer<const Parameters> &params, 
       const QSharedPointer<const PublicKeySet> &server_pks,
@@ -32,64 +100,51 @@ namespace BlogDrop {
   {
     Q_ASSERT(pubs.count() == c.count());
 
-    if(!Utils::MultiThreading) {
-      QList<QSharedPointer<const ClientCiphertext> > list;
-
-      // Unpack each ciphertext
-      for(int client_idx=0; client_idx<c.count(); client_idx++) {
-        list.append(CiphertextFactory::CreateClientCiphertext(params, 
-              server_pk_set, author_pk, c[client_idx]));
-      }
-
-      // Verify each proof
-      for(int idx=0; idx<c.count(); idx++) {
-        if(list[idx]->VerifyProof(phase, pubs[idx])) {
-          c_out.append(list[idx]);
-          pubs_out.append(pubs[idx]);
-        }
-      }
+    UnpackClientCiphertext unpack(params, server_pk_set, author_pk, c);
 
+    QList<QSharedPointer<const ClientCiphertext> > list;
+    if(Utils::MultiThreading) {
+      list = QtConcurrent::blockingMapped<
+        QList<QSharedPointer<const ClientCiphertext> > >(GetIndices(c.count()), unpack);
     } else {
-      QList<QSharedPointer<MapData> > ms;
-
-      // Unpack each ciphertext copying parameters to
-      // avoid shared data. Each thread must have its
-      // own Parameters object.
       for(int client_idx=0; client_idx<c.count(); client_idx++) {
-        QSharedPointer<MapData> m(new MapData());
-        m->params = new Parameters(*params);
-        m->server_pk_set = server_pk_set->GetByteArray();
-        m->author_pk = author_pk->GetByteArray();
-        m->client_pk = pubs[client_idx]->GetByteArray();
-        m->ciphertext = c[client_idx];
-        m->phase = phase;
-        ms.append(m);
+        list.append(unpack(client_idx));
       }
+    }
 
-      QList<bool> valid_list = QtConcurrent::blockingMapped(ms, VerifyOnce);
-
-      for(int client_idx=0; client_idx<valid_list.count(); client_idx++) {
-        if(valid_list[client_idx]) {
-          c_out.append(CiphertextFactory::CreateClientCiphertext(
-                  params, server_pk_set, author_pk, c[client_idx]));
-          pubs_out.append(pubs[client_idx]);
-        }
+    QList<bool> valid = VerifyProofs(phase, list, pubs);
+    for(int client_idx=0; client_idx<valid.count(); client_idx++) {
+      if(valid[client_idx]) {
+        c_out.append(list[client_idx]);
+        pubs_out.append(pubs[client_idx]);
       }
-
-    } 
+    }
   }
 
-  bool ClientCiphertext::VerifyOnce(const QSharedPointer<MapData> &m)
+  QList<bool> ClientCiphertext::VerifyProofs(int phase,
+      const QList<QSharedPointer<const ClientCiphertext> > &ctexts,
+      const QList<QSharedPointer<const PublicKey> > &pubs)
   {
-    QSharedPointer<const Parameters> params(m->params);
-    QSharedPointer<const PublicKeySet> server_pk_set(new PublicKeySet(params, m->server_pk_set));
-    QSharedPointer<const PublicKey> author_pk(new PublicKey(params, m->author_pk));
-    QSharedPointer<const PublicKey> client_pk(new PublicKey(params, m->client_pk));
-
-    QSharedPointer<const ClientCiphertext> c = CiphertextFactory::CreateClientCiphertext(params, server_pk_set,
-        author_pk, m->ciphertext);
-
-    return c->VerifyProof(m->phase, client_pk);
+    Q_ASSERT(pubs.count() == ctexts.count());
+    if(ctexts.isEmpty()) {
+      return QList<bool>();
+    }
+
+    // Every ciphertext in the list shares the parameters, server keys,
+    // and author key, and so the generators
+    QHash<int, Element> generators = ctexts[0]->GetProofGenerators(phase);
+    VerifyClientCiphertext verify(phase, ctexts, pubs, generators);
+
+    if(Utils::MultiThreading) {
+      return QtConcurrent::blockingMapped<QList<bool> >(
+          GetIndices(ctexts.count()), verify);
+    }
+
+    QList<bool> valid;
+    for(int client_idx=0; client_idx<ctexts.count(); client_idx++) {
+      valid.append(verify(client_idx));
+    }
+    return valid;
   }
 
 }
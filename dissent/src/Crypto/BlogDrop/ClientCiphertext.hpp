@@ -1,6 +1,7 @@
 #ifndef DISSENT_CRYPTO_BLOGDROP_CLIENT_CIPHERTEXT_H_GUARD
 #define DISSENT_CRYPTO_BLOGDROP_CLIENT_CIPHERTEXT_H_GUARD
 
+#include <QHash>
 #include <QSet>
 
 #include "Crypto/AbstractGroup/Element.hpp"
@@ -24,16 +25,6 @@ namespace BlogDrop {
 
       typedef Dissent::Crypto::AbstractGroup::Element Element;
 
-      class MapData {
-        public: 
-          Parameters *params;
-          QByteArray server_pk_set;
-          QByteArray author_pk;
-          QByteArray client_pk;
-          QByteArray ciphertext;
-          int phase;
-      }; 
-
       /**
        * Constructor: Initialize a ciphertext with a fresh
        * one-time public key
@@ -79,6 +70,33 @@ namespace BlogDrop {
        */
       virtual bool VerifyProof(int phase, const QSharedPointer<const PublicKey> &client_pub) const = 0;
 
+      /**
+       * Returns the proof generators that depend only on the round, server
+       * keys, and author key, so that they are computed once per list of
+       * ciphertexts rather than once per proof.
+       * Ciphertexts whose proofs use fixed generators return an empty hash.
+       * @param phase transmission round/phase index
+       */
+      virtual QHash<int, Element> GetProofGenerators(int /*phase*/) const
+      {
+        return QHash<int, Element>();
+      }
+
+      /**
+       * Check ciphertext proof using generators from GetProofGenerators
+       * of a ciphertext with the same server keys and author key
+       * @param phase transmission round/phase index
+       * @param client_pub client (NOT author) public key
+       * @param generators the shared generators
+       * @returns true if proof is okay
+       */
+      virtual bool VerifyProofWithGenerators(int phase,
+          const QSharedPointer<const PublicKey> &client_pub,
+          const QHash<int, Element> &/*generators*/) const
+      {
+        return VerifyProof(phase, client_pub);
+      }
+
       /**
        * Get a byte array for this ciphertext
        */
@@ -86,7 +104,8 @@ namespace BlogDrop {
 
       /**
        * Verify a set of proofs. Uses threading if available, so this might
-       * be much faster than verifying each proof in turn
+       * be much faster than verifying each proof in turn.  The parameters
+       * and keys are shared by all of the threads.
        */
       static void VerifyProofs(
           const QSharedPointer<const Parameters> &params,
@@ -98,6 +117,21 @@ namespace BlogDrop {
           QList<QSharedPointer<const ClientCiphertext> > &c_out,
           QList<QSharedPointer<const PublicKey> > &pubs_out);
 
+      /**
+       * Verify the proofs of a list of unpacked ciphertexts sharing the
+       * same parameters, server keys, and author key.  Generators common to
+       * the list are computed once.  Each proof is still checked on its own
+       * and in full, in parallel if threading is available; the
+       * challenge/response proofs cannot be folded into one combined check.
+       * @param phase transmission round/phase index
+       * @param ctexts the ciphertexts
+       * @param pubs the client public keys, one per ciphertext
+       * @returns whether each proof is valid
+       */
+      static QList<bool> VerifyProofs(int phase,
+          const QList<QSharedPointer<const ClientCiphertext> > &ctexts,
+          const QList<QSharedPointer<const PublicKey> > &pubs);
+
       virtual inline QList<Element> GetElements() const 
       { 
         return _elements; 
@@ -131,11 +165,6 @@ namespace BlogDrop {
       QSharedPointer<const PublicKeySet> _server_pks;
       QSharedPointer<const PublicKey> _author_pub;
       const int _n_elms;
-
-    private:
-
-      static bool VerifyOnce(const QSharedPointer<MapData> &m);
-
   };
 
 }
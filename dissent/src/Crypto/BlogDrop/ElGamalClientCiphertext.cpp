@@ -20,7 +20,7 @@ namespace BlogDrop {
       QSharedPointer<const PublicKey> pub(new PublicKey(priv));
       _one_time_privs.append(priv);
       _one_time_pubs.append(pub);
-      _elements.append(_params->GetMessageGroup()->Exponentiate(_server_pks->GetElement(),
+      _elements.append(_params->GetMessageGroup()->ExponentiateFixedBase(_server_pks->GetElement(),
           _one_time_privs[i]->GetInteger())); 
     }
   }
@@ -108,7 +108,7 @@ namespace BlogDrop {
     QList<Integer> vs;
 
     Integer v_auth = _params->GetKeyGroup()->RandomExponent();
-    ts.append(_params->GetKeyGroup()->Exponentiate(gs[0], v_auth));
+    ts.append(_params->GetKeyGroup()->ExponentiateFixedBase(gs[0], v_auth));
 
     for(int i=0; i<(2*_n_elms); i++) { 
       Integer v = _params->GetMessageGroup()->RandomExponent();
@@ -168,8 +168,8 @@ namespace BlogDrop {
 
     int v_idx = 0;
     for(int i=1; i<(1+(2*_n_elms)); i++) {
-      ts.append(_params->GetKeyGroup()->Exponentiate(gs[i], vs[v_idx])); i++;
-      ts.append(_params->GetMessageGroup()->Exponentiate(gs[i], vs[v_idx]));
+      ts.append(_params->GetKeyGroup()->ExponentiateFixedBase(gs[i], vs[v_idx])); i++;
+      ts.append(_params->GetMessageGroup()->ExponentiateFixedBase(gs[i], vs[v_idx]));
 
       v_idx++;
     }
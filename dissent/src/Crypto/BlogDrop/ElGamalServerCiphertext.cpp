@@ -80,7 +80,7 @@ namespace BlogDrop {
     QList<Element> ts;
 
     // t0 = g0^v
-    ts.append(_params->GetKeyGroup()->Exponentiate(g_key, v));
+    ts.append(_params->GetKeyGroup()->ExponentiateFixedBase(g_key, v));
 
     for(int i=0; i<_n_elms; i++) {
       // t(i) = g(i)^-v
@@ -145,14 +145,14 @@ namespace BlogDrop {
     ts.append(_params->GetKeyGroup()->CascadeExponentiate(g_key, _response,
         pub->GetElement(), _challenge));
 
+    const Integer neg_response = Integer(0) - _response;
     for(int i=0; i<_n_elms; i++) {
       // t(i) = g(i)^-r * y(i)^c
-      Element ti = _params->GetMessageGroup()->Exponentiate(
-          _client_pks[i]->GetElement(), _response);
-      ti = _params->GetMessageGroup()->Inverse(ti);
-      Element ti_tmp = _params->GetMessageGroup()->Exponentiate(_elements[i], _challenge);
-      ti = _params->GetMessageGroup()->Multiply(ti, ti_tmp);
-      ts.append(ti); 
+      QVector<Element> bases;
+      bases << _client_pks[i]->GetElement() << _elements[i];
+      QVector<Integer> exps;
+      exps << neg_response << _challenge;
+      ts.append(_params->GetMessageGroup()->MultiExponentiate(bases, exps));
     }
 
     QList<Element> gs;
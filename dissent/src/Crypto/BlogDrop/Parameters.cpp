@@ -82,8 +82,8 @@ namespace BlogDrop {
   Parameters::Parameters(const Parameters &p) :
     _proof_type(p._proof_type),
     _round_nonce(p._round_nonce),
-    _key_group(p._key_group->Copy()),
-    _msg_group(p._msg_group->Copy()),
+    _key_group(p._key_group),
+    _msg_group(p._msg_group),
     _n_elements(p._n_elements)
   {
   }
@@ -11,7 +11,8 @@ namespace Dissent {
     namespace BlogDrop {
 
       /**
-       * Object holding group definition
+       * Object holding group definition.  Parameters are immutable and
+       * may be shared by several threads.
        */
       class Parameters {
 
@@ -100,7 +101,7 @@ namespace Dissent {
           virtual ~Parameters() {}
 
           /**
-           * Copy constructor
+           * Copy constructor, the copy shares the groups of p
            */
           Parameters(const Parameters &p);
 
@@ -13,14 +13,14 @@ namespace BlogDrop {
 
   PublicKey::PublicKey(const QSharedPointer<const PrivateKey> &key) :
     _params(key->GetParameters()),
-    _public_key(_params->GetKeyGroup()->Exponentiate(
+    _public_key(_params->GetKeyGroup()->ExponentiateFixedBase(
           _params->GetKeyGroup()->GetGenerator(), key->GetInteger()))
   {
   }
   
   PublicKey::PublicKey(const PrivateKey &key) :
     _params(key.GetParameters()),
-    _public_key(_params->GetKeyGroup()->Exponentiate(
+    _public_key(_params->GetKeyGroup()->ExponentiateFixedBase(
           _params->GetKeyGroup()->GetGenerator(), key.GetInteger()))
   {
   }
@@ -45,7 +45,7 @@ namespace BlogDrop {
     const Integer v = _params->GetKeyGroup()->RandomExponent();
 
     // t = g^v
-    const Element t = _params->GetKeyGroup()->Exponentiate(
+    const Element t = _params->GetKeyGroup()->ExponentiateFixedBase(
         _params->GetKeyGroup()->GetGenerator(), v);
 
     // c = H(g, y, t)
@@ -13,7 +13,8 @@ namespace Crypto {
 namespace BlogDrop {
 
   /**
-   * Object holding BlogDrop public key (g^sk)
+   * Object holding BlogDrop public key (g^sk), which is immutable and
+   * may be shared by several threads
    */
   class PublicKey {
 
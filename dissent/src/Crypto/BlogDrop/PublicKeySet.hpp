@@ -17,6 +17,7 @@ namespace BlogDrop {
    * Object holding a collection of public keys. 
    * This object does some preprocessing on the keys to 
    * speed up ciphertext operations.
+   * Sets are immutable and may be shared by several threads.
    */
   class PublicKeySet {
 
@@ -11,6 +11,47 @@
 namespace Dissent {
 namespace Crypto {
 namespace BlogDrop {
+  namespace {
+    /**
+     * Unpacks and verifies the ciphertext at an index, returning a null
+     * pointer if its proof is invalid
+     */
+    struct VerifyServerCiphertext {
+      typedef QSharedPointer<const ServerCiphertext> result_type;
+
+      VerifyServerCiphertext(const QSharedPointer<const Parameters> &params,
+          const QSharedPointer<const PublicKeySet> &server_pk_set,
+          const QSharedPointer<const PublicKey> &author_pk,
+          const QList<QSharedPointer<const ClientCiphertext> > &client_ctexts,
+          int phase,
+          const QList<QSharedPointer<const PublicKey> > &pubs,
+          const QList<QByteArray> &c) :
+        params(params),
+        server_pk_set(server_pk_set),
+        author_pk(author_pk),
+        client_ctexts(client_ctexts),
+        phase(phase),
+        pubs(pubs),
+        c(c)
+      {
+      }
+
+      result_type operator()(int idx) const
+      {
+        result_type ctext = CiphertextFactory::CreateServerCiphertext(params,
+            server_pk_set, author_pk, client_ctexts, c[idx]);
+        return ctext->VerifyProof(phase, pubs[idx]) ? ctext : result_type();
+      }
+
+      const QSharedPointer<const Parameters> &params;
+      const QSharedPointer<const PublicKeySet> &server_pk_set;
+      const QSharedPointer<const PublicKey> &author_pk;
+      const QList<QSharedPointer<const ClientCiphertext> > &client_ctexts;
+      const int phase;
+      const QList<QSharedPointer<const PublicKey> > &pubs;
+      const QList<QByteArray> &c;
+    };
+  }
 
   ServerCiphertext::ServerCiphertext(const QSharedPointer<const Parameters> &params,
       const QSharedPointer<const PublicKey> &author_pub, 
@@ -32,83 +73,29 @@ namespace BlogDrop {
   {
     Q_ASSERT(pubs.count() == c.count());
 
-    if(!Utils::MultiThreading) {
-      QList<QSharedPointer<const ServerCiphertext> > list;
+    VerifyServerCiphertext verify(params, server_pk_set, author_pk,
+        client_ctexts, phase, pubs, c);
 
-      // Unpack each ciphertext
+    QList<QSharedPointer<const ServerCiphertext> > list;
+    if(Utils::MultiThreading) {
+      QList<int> indices;
       for(int server_idx=0; server_idx<c.count(); server_idx++) {
-        list.append(CiphertextFactory::CreateServerCiphertext(params, 
-              server_pk_set, author_pk, client_ctexts, c[server_idx]));
-      }
-
-      // Verify each proof
-      for(int idx=0; idx<c.count(); idx++) {
-        if(list[idx]->VerifyProof(phase, pubs[idx])) {
-          c_out.append(list[idx]);
-        }
+        indices.append(server_idx);
       }
 
+      list = QtConcurrent::blockingMapped<
+        QList<QSharedPointer<const ServerCiphertext> > >(indices, verify);
     } else {
-      QList<QByteArray> ctext_bytes;
-      for(int i=0; i<client_ctexts.count(); i++) {
-        ctext_bytes.append(client_ctexts[i]->GetByteArray());
-      }
-
-      QList<QSharedPointer<MapData> > ms;
-
-      // Unpack each ciphertext copying parameters to
-      // avoid shared data
       for(int server_idx=0; server_idx<c.count(); server_idx++) {
-        QSharedPointer<MapData> m(new MapData());
-        m->params = new Parameters(*params);
-
-        QByteArray mine;
-        QDataStream stream(&mine, QIODevice::WriteOnly);
-        stream << ctext_bytes;
-
-        m->client_ciphertext_list = mine;
-        m->server_pk_set = server_pk_set->GetByteArray();
-        m->author_pk = author_pk->GetByteArray();
-        m->server_pk = pubs[server_idx]->GetByteArray();
-        m->server_ciphertext = c[server_idx];
-        m->phase = phase;
-
-        ms.append(m);
+        list.append(verify(server_idx));
       }
+    }
 
-      QList<bool> valid_list = QtConcurrent::blockingMapped(ms, VerifyOnce);
-
-      for(int server_idx=0; server_idx<valid_list.count(); server_idx++) {
-        if(valid_list[server_idx]) {
-          c_out.append(CiphertextFactory::CreateServerCiphertext(
-              params, server_pk_set, author_pk, client_ctexts, c[server_idx]));
-        }
+    foreach(const QSharedPointer<const ServerCiphertext> &ctext, list) {
+      if(ctext) {
+        c_out.append(ctext);
       }
-
-    } 
-  }
-
-  bool ServerCiphertext::VerifyOnce(const QSharedPointer<MapData> &m)
-  {
-    QSharedPointer<const Parameters> params(m->params);
-
-    QSharedPointer<const PublicKeySet> server_pk_set(new PublicKeySet(params, m->server_pk_set));
-    QSharedPointer<const PublicKey> author_pk(new PublicKey(params, m->author_pk)); 
-    QSharedPointer<const PublicKey> server_pk(new PublicKey(params, m->server_pk)); 
-
-    QList<QByteArray> client_ctexts_raw;
-    QDataStream stream(m->client_ciphertext_list);
-    stream >> client_ctexts_raw;
-
-    QList<QSharedPointer<const ClientCiphertext> > client_ctexts;
-    for(int i=0; i<client_ctexts_raw.count(); i++) {
-      client_ctexts.append(CiphertextFactory::CreateClientCiphertext(
-            params, server_pk_set, author_pk, client_ctexts_raw[i]));
     }
-
-    QSharedPointer<const ServerCiphertext> s = CiphertextFactory::CreateServerCiphertext(
-              params, server_pk_set, author_pk, client_ctexts, m->server_ciphertext);
-    return s->VerifyProof(m->phase, server_pk);
   }
 }
 }
@@ -21,16 +21,6 @@ namespace BlogDrop {
 
       typedef Dissent::Crypto::AbstractGroup::Element Element;
 
-      typedef struct {
-        Parameters *params;
-        QByteArray client_ciphertext_list;
-        QByteArray server_pk_set;
-        QByteArray author_pk;
-        QByteArray server_pk;
-        QByteArray server_ciphertext;
-        int phase;
-      } MapData;
-
       /**
        * Constructor: Initialize a ciphertext
        * @param params Group parameters
@@ -62,7 +52,8 @@ namespace BlogDrop {
 
       /**
        * Verify a set of proofs. Uses threading if available, so this might
-       * be much faster than verifying each proof in turn
+       * be much faster than verifying each proof in turn.  The parameters,
+       * keys, and client ciphertexts are shared by all of the threads.
        */
       static void VerifyProofs(
           const QSharedPointer<const Parameters> &params,
@@ -89,10 +80,6 @@ namespace BlogDrop {
       QSharedPointer<const PublicKey> _author_pub;
       QList<Element> _elements;
       const int _n_elms;
-
-    private: 
-
-      static bool VerifyOnce(const QSharedPointer<MapData> &m);
   };
 }
 }
@@ -1,17 +1,61 @@
 #ifdef CRYPTOPP
 
+#include <algorithm>
 #include <QDebug>
 #include <QScopedPointer>
+#include <cryptopp/aes.h>
+#include <cryptopp/modes.h>
 #include <cryptopp/osrng.h> 
 #include "Crypto/CryptoRandom.hpp"
+#include "Utils/Xor.hpp"
 #include "Helper.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  /**
+   * Chunk size used by XorBlock, small enough to remain in the L1 cache
+   */
+  static const int XOR_CHUNK_SIZE = 4096;
+
+  /**
+   * Presents an AES-CTR keystream as a CryptoPP RandomNumberGenerator.
+   * CryptoPP uses AES-NI for the block operations when the processor
+   * supports it.
+   */
+  class CtrKeystream : public CryptoPP::RandomNumberGenerator {
+    public:
+      CtrKeystream(const byte *key, size_t length)
+      {
+        byte iv[CryptoPP::AES::BLOCKSIZE];
+        memset(iv, 0, sizeof(iv));
+        m_cipher.SetKeyWithIV(key, length, iv);
+      }
+
+      virtual void GenerateBlock(byte *output, size_t size)
+      {
+        memset(output, 0, size);
+        m_cipher.ProcessData(output, output, size);
+      }
+
+      void XorBlock(byte *data, size_t length)
+      {
+        m_cipher.ProcessData(data, data, length);
+      }
+
+      void Seek(quint64 position)
+      {
+        m_cipher.Seek(position);
+      }
+
+    private:
+      CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption m_cipher;
+  };
 
   class CryptoRandomImpl : public ICryptoRandomImpl {
     public:
-      CryptoRandomImpl(const QByteArray &seed)
+      CryptoRandomImpl(const QByteArray &seed,
+          CryptoRandom::GeneratorType type) :
+        m_ctr(0)
       {
         if(seed.isEmpty()) {
           try {
@@ -31,6 +75,14 @@ namespace Crypto {
           seed_tmp.resize(seed_length);
         }
 
+        if(type == CryptoRandom::CTR_AES) {
+          m_ctr = new CtrKeystream(
+              reinterpret_cast<const byte *>(seed_tmp.constData()),
+              seed_tmp.size());
+          m_data.reset(m_ctr);
+          return;
+        }
+
         CryptoPP::BlockTransformation *bt = new CryptoPP::AES::Encryption(
             reinterpret_cast<byte *>(seed_tmp.data()), seed_tmp.size());
 
@@ -68,13 +120,40 @@ namespace Crypto {
         m_data->GenerateBlock(reinterpret_cast<byte *>(data.data()), data.size());
       }
 
+      virtual void XorBlock(char *data, int length)
+      {
+        if(m_ctr) {
+          m_ctr->XorBlock(reinterpret_cast<byte *>(data), length);
+          return;
+        }
+
+        byte chunk[XOR_CHUNK_SIZE];
+        for(int offset = 0; offset < length; offset += XOR_CHUNK_SIZE) {
+          int size = std::min(XOR_CHUNK_SIZE, length - offset);
+          m_data->GenerateBlock(chunk, size);
+          Utils::Xor(data + offset, data + offset,
+              reinterpret_cast<const char *>(chunk), size);
+        }
+      }
+
+      virtual bool Seek(quint64 position)
+      {
+        if(!m_ctr) {
+          return false;
+        }
+        m_ctr->Seek(position);
+        return true;
+      }
+
       CryptoPP::RandomNumberGenerator &GetHandle() { return *m_data; }
 
     private:
       QScopedPointer<CryptoPP::RandomNumberGenerator> m_data;
+      CtrKeystream *m_ctr;
   };
 
-  CryptoRandom::CryptoRandom(const QByteArray &seed) : m_data(new CryptoRandomImpl(seed))
+  CryptoRandom::CryptoRandom(const QByteArray &seed, GeneratorType type) :
+    m_data(new CryptoRandomImpl(seed, type))
   {
   }
 
@@ -1,5 +1,6 @@
 #ifdef CRYPTOPP
 
+#include "Crypto/AbstractGroup/AbstractGroup.hpp"
 #include "Crypto/DiffieHellman.hpp"
 #include "cryptopp/dh.h"
 #include "Helper.hpp"
@@ -15,6 +16,10 @@ namespace Crypto {
 
       virtual QByteArray GetSharedSecret(const QByteArray &remote_pub) const
       {
+        if(remote_pub.size() != int(m_dh_params.PublicKeyLength())) {
+          return QByteArray();
+        }
+
         QByteArray shared = QByteArray(m_dh_params.AgreedValueLength(), 0);
 
         bool valid = m_dh_params.Agree(reinterpret_cast<byte *>(shared.data()),
@@ -68,8 +73,63 @@ namespace Crypto {
       QByteArray m_private_key;
   };
 
-  DiffieHellman::DiffieHellman(const QByteArray &data, bool seed) :
-    m_data(new DiffieHellmanImpl(data, seed))
+  /**
+   * Diffie-Hellman over NIST P-256, the private component is the scalar and
+   * the public component the compressed point
+   */
+  class EcDiffieHellmanImpl : public IDiffieHellmanImpl {
+    public:
+      EcDiffieHellmanImpl(const QByteArray &data, bool seed)
+      {
+        QSharedPointer<const AbstractGroup::AbstractGroup> group =
+          DiffieHellman::GetEcGroup();
+        Integer order = group->GetOrder();
+        Integer priv;
+        if(data.isEmpty() || seed) {
+          CryptoRandom rng(data);
+          priv = rng.GetInteger(1, order);
+        } else {
+          priv = Integer(data) % order;
+        }
+
+        m_private_key = priv.GetByteArray();
+        m_public_key = group->ElementToByteArray(
+            group->ExponentiateFixedBase(group->GetGenerator(), priv));
+      }
+
+      virtual QByteArray GetSharedSecret(const QByteArray &remote_pub) const
+      {
+        QSharedPointer<const AbstractGroup::AbstractGroup> group =
+          DiffieHellman::GetEcGroup();
+        AbstractGroup::Element remote = group->ElementFromByteArray(remote_pub);
+        if(group->IsIdentity(remote) || !group->IsElement(remote)) {
+          return QByteArray();
+        }
+
+        return group->ElementToByteArray(
+            group->Exponentiate(remote, Integer(m_private_key)));
+      }
+
+      virtual QByteArray GetPublicComponent() const
+      {
+        return m_public_key;
+      }
+
+      virtual QByteArray GetPrivateComponent() const
+      {
+        return m_private_key;
+      }
+
+    private:
+      QByteArray m_public_key;
+      QByteArray m_private_key;
+  };
+
+  DiffieHellman::DiffieHellman(const QByteArray &data, bool seed, KeyType type) :
+    m_type(type),
+    m_data(type == ELLIPTIC_CURVE ?
+        static_cast<IDiffieHellmanImpl *>(new EcDiffieHellmanImpl(data, seed)) :
+        static_cast<IDiffieHellmanImpl *>(new DiffieHellmanImpl(data, seed)))
   {
   }
 }
@@ -0,0 +1,89 @@
+#ifdef CRYPTOPP
+#include <QDebug>
+#include <cryptopp/queue.h>
+#include "Crypto/CryptoRandom.hpp"
+#include "Crypto/EcdsaPrivateKey.hpp"
+#include "EcdsaPublicKeyImpl.hpp"
+#include "Helper.hpp"
+
+using namespace CryptoPP;
+
+namespace Dissent {
+namespace Crypto {
+  class CppEcdsaPrivateKeyImpl : public CppEcdsaPublicKeyImpl {
+    public:
+      CppEcdsaPrivateKeyImpl(const QByteArray &data, bool seed) :
+        m_private_key(new KeyBase::PrivateKey())
+      {
+        if(seed) {
+          CryptoRandom rand(data);
+          m_private_key->Initialize(GetCppRandom(rand), GetParameters());
+        } else {
+          ByteQueue queue;
+          queue.Put2(reinterpret_cast<const byte *>(data.data()), data.size(), 0, true);
+
+          try {
+            m_private_key->Load(queue);
+          } catch (std::exception &e) {
+            qWarning() << "In CppEcdsaPrivateKey: " << e.what();
+            m_valid = false;
+            return;
+          }
+
+          if(!(m_private_key->GetGroupParameters() == GetParameters())) {
+            qWarning() << "In CppEcdsaPrivateKey: invalid curve";
+            m_valid = false;
+            return;
+          }
+        }
+
+        Configure(m_private_key->AccessGroupParameters());
+        m_public_key.reset(new KeyBase::PublicKey());
+        m_private_key->MakePublicKey(*m_public_key);
+        Configure(m_public_key->AccessGroupParameters());
+        m_valid = true;
+      }
+
+      virtual QByteArray GetByteArray() const
+      {
+        if(!IsValid()) {
+          return QByteArray();
+        }
+
+        return CppGetByteArray(*m_private_key);
+      }
+
+      virtual QByteArray Sign(const QByteArray &data) const
+      {
+        if(!IsValid()) {
+          qCritical() << "Trying to sign with an invalid key";
+          return QByteArray();
+        }
+
+        KeyBase::Signer signer(*m_private_key);
+        QByteArray sig(signer.MaxSignatureLength(), 0);
+        CryptoRandom rand;
+        size_t length = signer.SignMessage(GetCppRandom(rand),
+            reinterpret_cast<const byte *>(data.data()), data.size(),
+            reinterpret_cast<byte *>(sig.data()));
+        sig.resize(length);
+        return sig;
+      }
+
+    private:
+      QScopedPointer<KeyBase::PrivateKey> m_private_key;
+  };
+
+  EcdsaPrivateKey::EcdsaPrivateKey(const QByteArray &data, bool seed) :
+    EcdsaPublicKey(new CppEcdsaPrivateKeyImpl(data, data.size() == 0 ? true : seed))
+  {
+  }
+
+  EcdsaPrivateKey::EcdsaPrivateKey(const QString &file) :
+    EcdsaPublicKey(new CppEcdsaPrivateKeyImpl(AsymmetricKey::ReadFile(file), false))
+  {
+  }
+}
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifdef CRYPTOPP
+#include <QDebug>
+#include <cryptopp/oids.h>
+#include <cryptopp/queue.h>
+#include "Crypto/CryptoRandom.hpp"
+#include "Crypto/EcdsaPrivateKey.hpp"
+#include "EcdsaPublicKeyImpl.hpp"
+#include "Helper.hpp"
+
+using namespace CryptoPP;
+
+namespace Dissent {
+namespace Crypto {
+  CppEcdsaPublicKeyImpl::CppEcdsaPublicKeyImpl() :
+    m_valid(false)
+  {
+  }
+
+  CppEcdsaPublicKeyImpl::CppEcdsaPublicKeyImpl(const QByteArray &data, bool seed) :
+    m_public_key(new KeyBase::PublicKey())
+  {
+    if(seed) {
+      CryptoRandom rand(data);
+      KeyBase::PrivateKey key;
+      key.Initialize(GetCppRandom(rand), GetParameters());
+      key.MakePublicKey(*m_public_key);
+    } else {
+      ByteQueue queue;
+      queue.Put2(reinterpret_cast<const byte *>(data.data()), data.size(), 0, true);
+
+      try {
+        m_public_key->Load(queue);
+      } catch (std::exception &e) {
+        qWarning() << "In CppEcdsaPublicKey: " << e.what();
+        m_valid = false;
+        return;
+      }
+
+      // Only accept points on our curve, keys may come from the network
+      if(!(m_public_key->GetGroupParameters() == GetParameters()) ||
+          !GetParameters().GetCurve().VerifyPoint(m_public_key->GetPublicElement()))
+      {
+        qWarning() << "In CppEcdsaPublicKey: invalid curve or point";
+        m_valid = false;
+        return;
+      }
+    }
+
+    Configure(m_public_key->AccessGroupParameters());
+    m_valid = true;
+  }
+
+  CppEcdsaPublicKeyImpl::CppEcdsaPublicKeyImpl(KeyBase::PublicKey *key, bool validate) :
+    m_public_key(key), m_valid(validate)
+  {
+  }
+
+  bool CppEcdsaPublicKeyImpl::IsValid() const
+  {
+    return m_valid;
+  }
+
+  int CppEcdsaPublicKeyImpl::GetKeySize() const
+  {
+    return GetParameters().GetSubgroupOrder().BitCount();
+  }
+
+  int CppEcdsaPublicKeyImpl::GetSignatureLength() const
+  {
+    KeyBase::Verifier verifier(*m_public_key);
+    return verifier.SignatureLength();
+  }
+
+  QSharedPointer<AsymmetricKey> CppEcdsaPublicKeyImpl::GetPublicKey() const
+  {
+    if(!IsValid()) {
+      return QSharedPointer<AsymmetricKey>();
+    }
+
+    return QSharedPointer<AsymmetricKey>(new EcdsaPublicKey(
+          new CppEcdsaPublicKeyImpl(new KeyBase::PublicKey(*m_public_key), true)));
+  }
+
+  QByteArray CppEcdsaPublicKeyImpl::GetByteArray() const
+  {
+    if(!IsValid()) {
+      return QByteArray();
+    }
+
+    return CppGetByteArray(*m_public_key);
+  }
+
+  QByteArray CppEcdsaPublicKeyImpl::Sign(const QByteArray &) const
+  {
+    qWarning() << "In EcdsaPublicKey::Sign: Attempting to sign with a public key";
+    return QByteArray();
+  }
+
+  bool CppEcdsaPublicKeyImpl::Verify(const QByteArray &data, const QByteArray &sig) const
+  {
+    if(!IsValid()) {
+      return false;
+    }
+
+    KeyBase::Verifier verifier(*m_public_key);
+    if(sig.size() != static_cast<int>(verifier.SignatureLength())) {
+      return false;
+    }
+
+    return verifier.VerifyMessage(reinterpret_cast<const byte *>(data.data()),
+        data.size(), reinterpret_cast<const byte *>(sig.data()), sig.size());
+  }
+
+  QByteArray CppEcdsaPublicKeyImpl::Encrypt(const QByteArray &) const
+  {
+    qWarning() << "In EcdsaPublicKey::Encrypt: Encryption is not supported";
+    return QByteArray();
+  }
+
+  QByteArray CppEcdsaPublicKeyImpl::Decrypt(const QByteArray &) const
+  {
+    qWarning() << "In EcdsaPublicKey::Decrypt: Attempting to decrypt with a public key";
+    return QByteArray();
+  }
+
+  QByteArray CppEcdsaPublicKeyImpl::GetPublicPoint() const
+  {
+    if(!IsValid()) {
+      return QByteArray();
+    }
+
+    const ECP &curve = GetParameters().GetCurve();
+    QByteArray point(curve.EncodedPointSize(true), 0);
+    curve.EncodePoint(reinterpret_cast<byte *>(point.data()),
+        m_public_key->GetPublicElement(), true);
+    return point;
+  }
+
+  const CppEcdsaPublicKeyImpl::Parameters &CppEcdsaPublicKeyImpl::GetParameters()
+  {
+    static Parameters params(ASN1::secp256r1());
+    return params;
+  }
+
+  void CppEcdsaPublicKeyImpl::Configure(Parameters &params)
+  {
+    params.SetEncodeAsOID(true);
+    params.SetPointCompression(true);
+  }
+
+  EcdsaPublicKey::EcdsaPublicKey(const QByteArray &data, bool seed) :
+    AsymmetricKey(new CppEcdsaPublicKeyImpl(data, data.size() == 0 ? true : seed))
+  {
+  }
+
+  EcdsaPublicKey::EcdsaPublicKey(const QString &file) :
+    AsymmetricKey(new CppEcdsaPublicKeyImpl(AsymmetricKey::ReadFile(file), false))
+  {
+  }
+}
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef DISSENT_CRYPTO_CPP_ECDSA_PUBLIC_KEY_IMPL_H_GUARD
+#define DISSENT_CRYPTO_CPP_ECDSA_PUBLIC_KEY_IMPL_H_GUARD
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+#include "Crypto/EcdsaPublicKey.hpp"
+#include <cryptopp/eccrypto.h>
+#include <cryptopp/sha.h>
+
+namespace Dissent {
+namespace Crypto {
+  class CppEcdsaPublicKeyImpl : public BaseEcdsaPublicKeyImpl {
+    public:
+      typedef CryptoPP::ECDSA<CryptoPP::ECP, CryptoPP::SHA256> KeyBase;
+      typedef CryptoPP::DL_GroupParameters_EC<CryptoPP::ECP> Parameters;
+
+      CppEcdsaPublicKeyImpl(const QByteArray &data, bool seed);
+      CppEcdsaPublicKeyImpl(KeyBase::PublicKey *key, bool validate = false);
+      virtual bool IsValid() const;
+      virtual int GetKeySize() const;
+      virtual int GetSignatureLength() const;
+      virtual QSharedPointer<AsymmetricKey> GetPublicKey() const;
+      virtual QByteArray GetByteArray() const;
+      virtual QByteArray Sign(const QByteArray &data) const;
+      virtual bool Verify(const QByteArray &data, const QByteArray &sig) const;
+      virtual QByteArray Encrypt(const QByteArray &data) const;
+      virtual QByteArray Decrypt(const QByteArray &data) const;
+      virtual QByteArray GetPublicPoint() const;
+
+      /**
+       * Returns the curve all keys are defined over
+       */
+      static const Parameters &GetParameters();
+
+    protected:
+      CppEcdsaPublicKeyImpl();
+
+      /**
+       * Encode keys with the curve OID and compressed points
+       */
+      static void Configure(Parameters &params);
+
+      QScopedPointer<KeyBase::PublicKey> m_public_key;
+      bool m_valid;
+  };
+}
+}
+
+#endif
@@ -1,10 +1,16 @@
 #ifdef CRYPTOPP
 
+#include <cryptopp/eprecomp.h>
+#include <cryptopp/gfpcrypt.h>
 #include <cryptopp/integer.h>
 #include <cryptopp/nbtheory.h>
 #include <cryptopp/modarith.h>
 
+#include <QScopedPointer>
+
+#include "Crypto/FixedBase.hpp"
 #include "Crypto/Integer.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "Helper.hpp"
 
 namespace Dissent {
@@ -93,6 +99,12 @@ namespace Crypto {
         return new CppIntegerImpl(m_data.InverseMod(GetData(mod)));
       }
 
+      virtual IFixedBaseImpl *Precompute(const IIntegerImpl * const mod,
+          int max_exp_bits, int storage) const;
+
+      virtual IIntegerImpl *MultiPow(const QVector<const IIntegerImpl *> &bases,
+          const QVector<const IIntegerImpl *> &exps) const;
+
       virtual bool Equals(const IIntegerImpl * const other) const
       {
         return m_data == GetData(other);
@@ -134,6 +146,89 @@ namespace Crypto {
       CryptoPP::Integer m_data;
   };
 
+  /**
+   * Crypto++'s fixed base precomputation, with the table held in Montgomery
+   * form
+   */
+  class CppFixedBaseImpl : public IFixedBaseImpl {
+    public:
+      CppFixedBaseImpl(const CryptoPP::Integer &base,
+          const CryptoPP::Integer &modulus, int max_exp_bits, int storage)
+      {
+        m_group.SetModulus(modulus);
+        m_table.SetBase(m_group, base % modulus);
+        m_table.Precompute(m_group, max_exp_bits, storage);
+      }
+
+      virtual IIntegerImpl *Pow(const IIntegerImpl * const exp) const
+      {
+        // The Montgomery representation has scratch space, so each
+        // exponentiation uses its own copy to remain thread safe
+        CryptoPP::ModExpPrecomputation group(m_group);
+        return new CppIntegerImpl(m_table.Exponentiate(group,
+              CppIntegerImpl::GetData(exp)));
+      }
+
+    private:
+      CryptoPP::ModExpPrecomputation m_group;
+      CryptoPP::DL_FixedBasePrecomputationImpl<CryptoPP::Integer> m_table;
+  };
+
+  IFixedBaseImpl *CppIntegerImpl::Precompute(const IIntegerImpl * const mod,
+      int max_exp_bits, int storage) const
+  {
+    return new CppFixedBaseImpl(m_data, GetData(mod), max_exp_bits, storage);
+  }
+
+  namespace {
+    /**
+     * Multiplication modulo n for MultiExponentiation, in Montgomery form
+     * for odd moduli
+     */
+    struct ModularOps {
+      typedef CryptoPP::Integer Value;
+
+      ModularOps(const CryptoPP::ModularArithmetic &ring) : ring(ring) {}
+
+      Value Identity() const { return ring.MultiplicativeIdentity(); }
+      Value Multiply(const Value &a, const Value &b) const { return ring.Multiply(a, b); }
+      Value Square(const Value &a) const { return ring.Square(a); }
+
+      const CryptoPP::ModularArithmetic &ring;
+    };
+  }
+
+  IIntegerImpl *CppIntegerImpl::MultiPow(const QVector<const IIntegerImpl *> &bases,
+      const QVector<const IIntegerImpl *> &exps) const
+  {
+    // The ring has scratch space, so it is local to this call
+    QScopedPointer<CryptoPP::ModularArithmetic> ring(m_data.IsOdd() ?
+        new CryptoPP::MontgomeryRepresentation(m_data) :
+        new CryptoPP::ModularArithmetic(m_data));
+
+    QVector<CryptoPP::Integer> cbases;
+    QVector<QByteArray> cexps;
+    for(int idx = 0; idx < bases.size(); idx++) {
+      CryptoPP::Integer base = GetData(bases[idx]);
+      CryptoPP::Integer exp = GetData(exps[idx]);
+      // base^-e = (base^-1)^e
+      if(exp.IsNegative()) {
+        base = base.InverseMod(m_data);
+        exp = -exp;
+      }
+
+      QByteArray encoded(exp.MinEncodedSize(), 0);
+      exp.Encode(reinterpret_cast<byte *>(encoded.data()), encoded.size());
+
+      cbases.append(ring->ConvertIn(base));
+      cexps.append(encoded);
+    }
+
+    ModularOps ops(*ring);
+    return new CppIntegerImpl(ring->ConvertOut(
+          MultiExponentiation::Compute(ops, cbases, cexps)));
+  }
+
   Integer::Integer(int value) :
     m_data(new CppIntegerImpl(value))
   {
@@ -16,6 +16,8 @@ namespace Crypto {
           const Integer &max, bool prime) = 0;
       virtual Integer GetInteger(int bit_count, bool prime) = 0;
       virtual void GenerateBlock(QByteArray &data) = 0;
+      virtual void XorBlock(char *data, int length) = 0;
+      virtual bool Seek(quint64 position) = 0;
   };
 
   /**
@@ -23,11 +25,28 @@ namespace Crypto {
    */
   class CryptoRandom : public Utils::Random {
     public:
+      /**
+       * The algorithms available for expanding a seed
+       */
+      enum GeneratorType {
+        /**
+         * ANSI X9.17 over AES
+         */
+        X917 = 0,
+        /**
+         * AES in counter mode, a seekable keystream
+         */
+        CTR_AES
+      };
+
       /**
        * Constructor
-       * @param seed optional seed
+       * @param seed optional seed, without one an automatically seeded
+       * X917 generator is used regardless of type
+       * @param type the algorithm used to expand the seed
        */
-      explicit CryptoRandom(const QByteArray &seed = QByteArray());
+      explicit CryptoRandom(const QByteArray &seed = QByteArray(),
+          GeneratorType type = X917);
 
       /**
        * Returns the optimal seed size, less than will provide suboptimal
@@ -62,6 +81,38 @@ namespace Crypto {
         return m_data->GenerateBlock(data);
       }
 
+      /**
+       * Xors the next data.size() bytes of output directly into data, rather
+       * than generating them into a temporary buffer.  The result is
+       * identical to xoring data with the output of GenerateBlock.
+       * @param data the buffer to xor the output into
+       */
+      void XorBlock(QByteArray &data)
+      {
+        m_data->XorBlock(data.data(), data.size());
+      }
+
+      /**
+       * Xors the next length bytes of output directly into data
+       * @param data the buffer to xor the output into
+       * @param length the number of bytes to xor
+       */
+      void XorBlock(char *data, int length)
+      {
+        m_data->XorBlock(data, length);
+      }
+
+      /**
+       * Moves a seekable generator to a byte offset into its output stream,
+       * so a portion of the stream can be generated on demand
+       * @param position the byte offset
+       * @returns false if the generator does not support seeking
+       */
+      bool Seek(quint64 position)
+      {
+        return m_data->Seek(position);
+      }
+
       ICryptoRandomImpl *GetHandle() { return m_data.data(); }
     private:
       QExplicitlySharedDataPointer<ICryptoRandomImpl> m_data;
@@ -1,14 +1,218 @@
 #include <QDataStream>
+#include <QPair>
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
+#include "Utils/Utils.hpp"
+
+#include "AbstractGroup/CppECGroup.hpp"
 #include "DiffieHellman.hpp"
+#include "FixedBase.hpp"
 #include "Hash.hpp"
 #include "Integer.hpp"
 #include "CryptoRandom.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  namespace {
+    /**
+     * Derives the shared secrets for a contiguous range of public components,
+     * useful for QtConcurrent.  Each range uses its own key instance, since
+     * the underlying implementation does not promise thread safety.
+     */
+    struct SharedSecretRange {
+      SharedSecretRange(const QByteArray &private_key,
+          DiffieHellman::KeyType type, const QVector<QByteArray> &remote_pubs) :
+        _private_key(private_key), _type(type), _remote_pubs(remote_pubs)
+      {
+      }
+
+      typedef QVector<QByteArray> result_type;
+
+      QVector<QByteArray> operator()(const QPair<int, int> &range) const
+      {
+        DiffieHellman key(_private_key, false, _type);
+        QVector<QByteArray> secrets;
+        secrets.reserve(range.second - range.first);
+        for(int idx = range.first; idx < range.second; idx++) {
+          const QByteArray &remote_pub = _remote_pubs[idx];
+          secrets.append(remote_pub.isEmpty() ? QByteArray() :
+              key.GetSharedSecret(remote_pub));
+        }
+        return secrets;
+      }
+
+      const QByteArray _private_key;
+      const DiffieHellman::KeyType _type;
+      const QVector<QByteArray> &_remote_pubs;
+    };
+
+    /**
+     * Hashes the transcript of a shared secret proof into a challenge
+     */
+    QByteArray ProofChallenge(const QByteArray &generator,
+        const QByteArray &prover_pub, const QByteArray &remote_pub,
+        const QByteArray &dh_secret, const QByteArray &commit_1,
+        const QByteArray &commit_2)
+    {
+      QByteArray data;
+      QDataStream hstream(&data, QIODevice::WriteOnly);
+      hstream << generator << prover_pub << remote_pub << dh_secret <<
+        commit_1 << commit_2;
+      return Hash().ComputeHash(data);
+    }
+
+    /**
+     * ProveSharedSecret in the elliptic curve group, the Chaum-Pedersen
+     * proof that log_g(g^a) == log_(g^b)(g^ab) with responses mod q
+     */
+    QByteArray EcProveSharedSecret(const DiffieHellman &key,
+        const QByteArray &remote_pub)
+    {
+      QSharedPointer<const AbstractGroup::AbstractGroup> group =
+        DiffieHellman::GetEcGroup();
+      AbstractGroup::Element other = group->ElementFromByteArray(
+          DiffieHellman::Untag(remote_pub, DiffieHellman::ELLIPTIC_CURVE));
+      Integer order = group->GetOrder();
+      Integer value = group->RandomExponent();
+
+      QByteArray dh_secret = key.GetSharedSecret(remote_pub);
+      QByteArray commit_1 = group->ElementToByteArray(
+          group->ExponentiateFixedBase(group->GetGenerator(), value));
+      QByteArray commit_2 = group->ElementToByteArray(
+          group->Exponentiate(other, value));
+
+      QByteArray challenge_bytes = ProofChallenge(
+          group->ElementToByteArray(group->GetGenerator()),
+          key.GetPublicComponent(), remote_pub, dh_secret, commit_1, commit_2);
+      Integer challenge(challenge_bytes);
+
+      // r = v - ca mod q
+      Integer prover_priv(key.GetPrivateComponent());
+      Integer response = (value - prover_priv.Multiply(challenge, order)) % order;
+
+      QByteArray out;
+      QDataStream stream(&out, QIODevice::WriteOnly);
+      stream << dh_secret << challenge_bytes << response.GetByteArray();
+      return out;
+    }
+
+    /**
+     * VerifySharedSecret in the elliptic curve group
+     */
+    QByteArray EcVerifySharedSecret(const QByteArray &prover_pub,
+        const QByteArray &remote_pub, const QByteArray &proof)
+    {
+      QSharedPointer<const AbstractGroup::AbstractGroup> group =
+        DiffieHellman::GetEcGroup();
+
+      QDataStream stream(proof);
+      QByteArray dh_secret_bytes, challenge_bytes, response_bytes;
+      stream >> dh_secret_bytes >> challenge_bytes >> response_bytes;
+
+      // The secret is a bare point, the public components are tagged
+      QList<AbstractGroup::Element> elements;
+      foreach(const QByteArray &bytes, QList<QByteArray>() <<
+          DiffieHellman::Untag(prover_pub, DiffieHellman::ELLIPTIC_CURVE) <<
+          DiffieHellman::Untag(remote_pub, DiffieHellman::ELLIPTIC_CURVE) <<
+          dh_secret_bytes)
+      {
+        if(bytes.isEmpty()) {
+          return QByteArray();
+        }
+
+        AbstractGroup::Element element = group->ElementFromByteArray(bytes);
+        if(group->IsIdentity(element) || !group->IsElement(element)) {
+          return QByteArray();
+        }
+        elements.append(element);
+      }
+
+      Integer challenge(challenge_bytes);
+      Integer response(response_bytes);
+
+      // commit'_1 = g^r * (g^a)^c, commit'_2 = (g^b)^r * (g^ab)^c
+      QByteArray commit_1 = group->ElementToByteArray(group->CascadeExponentiate(
+            group->GetGenerator(), response, elements[0], challenge));
+      QByteArray commit_2 = group->ElementToByteArray(group->CascadeExponentiate(
+            elements[1], response, elements[2], challenge));
+
+      QByteArray expected_challenge = ProofChallenge(
+          group->ElementToByteArray(group->GetGenerator()),
+          prover_pub, remote_pub, dh_secret_bytes, commit_1, commit_2);
+
+      return (challenge_bytes == expected_challenge) ?
+        dh_secret_bytes : QByteArray();
+    }
+  }
+
+  QSharedPointer<const AbstractGroup::AbstractGroup> DiffieHellman::GetEcGroup()
+  {
+    static QSharedPointer<const AbstractGroup::AbstractGroup> group(
+        AbstractGroup::CppECGroup::GetGroup(AbstractGroup::ECParams::NIST_P256));
+    return group;
+  }
+
+  DiffieHellman::KeyType DiffieHellman::GetKeyType(const QByteArray &public_component)
+  {
+    return (!public_component.isEmpty() &&
+        public_component.at(0) == char(ELLIPTIC_CURVE)) ? ELLIPTIC_CURVE : MODULAR;
+  }
+
+  QByteArray DiffieHellman::Untag(const QByteArray &public_component, KeyType type)
+  {
+    if(public_component.size() < 2 || public_component.at(0) != char(type)) {
+      return QByteArray();
+    }
+    return public_component.mid(1);
+  }
+
+  QByteArray DiffieHellman::GetSharedSecret(const QByteArray &remote_pub) const
+  {
+    QByteArray remote = Untag(remote_pub, m_type);
+    return remote.isEmpty() ? QByteArray() : m_data->GetSharedSecret(remote);
+  }
+
+  QVector<QByteArray> DiffieHellman::GetSharedSecrets(
+      const QVector<QByteArray> &remote_pubs) const
+  {
+    int count = remote_pubs.size();
+    int workers = 1;
+    if(Utils::MultiThreading) {
+      workers = qBound(1, QThreadPool::globalInstance()->maxThreadCount(),
+          qMax(count, 1));
+    }
+
+    SharedSecretRange task(GetPrivateComponent(), GetKeyType(), remote_pubs);
+    if(workers == 1) {
+      return task(QPair<int, int>(0, count));
+    }
+
+    QList<QPair<int, int> > ranges;
+    for(int widx = 0; widx < workers; widx++) {
+      ranges.append(QPair<int, int>((count * widx) / workers,
+            (count * (widx + 1)) / workers));
+    }
+
+    // The calling thread participates in the blocking map, so this is
+    // safe even when called from within the global thread pool
+    QList<QVector<QByteArray> > partials =
+      QtConcurrent::blockingMapped(ranges, task);
+
+    QVector<QByteArray> secrets;
+    secrets.reserve(count);
+    foreach(const QVector<QByteArray> &partial, partials) {
+      secrets += partial;
+    }
+    return secrets;
+  }
+
   QByteArray DiffieHellman::ProveSharedSecret(const QByteArray &remote_pub) const
   {
+    if(GetKeyType() == ELLIPTIC_CURVE) {
+      return EcProveSharedSecret(*this, remote_pub);
+    }
+
     Integer phi = GetPInt() - 1;
 
     // A random value v in the group Z_q
@@ -25,7 +229,7 @@ namespace Crypto {
     QByteArray dh_secret = GetSharedSecret(other_pub);
 
     // t_1 = g^v
-    QByteArray commit_1 = rand_key.GetPublicComponent();
+    QByteArray commit_1 = Untag(rand_key.GetPublicComponent(), MODULAR);
 
     // t_2 = (g^b)^v  -- Where b is the other guy's secret
     QByteArray commit_2 = rand_key.GetSharedSecret(other_pub);
@@ -55,6 +259,16 @@ namespace Crypto {
   QByteArray DiffieHellman::VerifySharedSecret(const QByteArray &prover_pub,
       const QByteArray &remote_pub, const QByteArray &proof)
   {
+    if(GetKeyType(prover_pub) == ELLIPTIC_CURVE) {
+      return EcVerifySharedSecret(prover_pub, remote_pub, proof);
+    }
+
+    QByteArray prover_bytes = Untag(prover_pub, MODULAR);
+    QByteArray remote_bytes = Untag(remote_pub, MODULAR);
+    if(prover_bytes.isEmpty() || remote_bytes.isEmpty()) {
+      return QByteArray();
+    }
+
     // For modular arithmetic in our DH group
     Integer modulus = GetPInt();
     Integer generator = GetGInt();
@@ -69,13 +283,13 @@ namespace Crypto {
 
     // commit'_1 = (g^r) * (g^a)^c
     // commit'_1 = (g^r) * (public_key_a)^challenge
-    Integer public_key_a(prover_pub);
-    Integer commit_1 = generator.Pow(response, modulus).Multiply(
+    Integer public_key_a(prover_bytes);
+    Integer commit_1 = FixedBase::GetGenerator(generator, modulus).Pow(response).Multiply(
         public_key_a.Pow(challenge, modulus), modulus);
 
     // commit'_2 = (g^b)^r * (g^ab)^c
     // commit'_2 = (public_key_b)^response * (dh_secret)^challenge
-    Integer public_key_b(remote_pub);
+    Integer public_key_b(remote_bytes);
     Integer commit_2 = public_key_b.Pow(response, modulus).Multiply(
         dh_secret.Pow(challenge, modulus), modulus);
 
@@ -3,12 +3,18 @@
 
 #include <QByteArray>
 #include <QSharedData>
+#include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
 #include "Integer.hpp"
 
 namespace Dissent {
 namespace Crypto {
+namespace AbstractGroup {
+  class AbstractGroup;
+}
+
   class IDiffieHellmanImpl : public QSharedData
   {
     public:
@@ -23,6 +29,22 @@ namespace Crypto {
    */
   class DiffieHellman {
     public:
+      /**
+       * The groups in which the agreement may take place, public components
+       * begin with their key type as a tag byte
+       */
+      enum KeyType {
+        /**
+         * The modular group given by GetP, GetQ, and GetG
+         */
+        MODULAR = 0,
+        /**
+         * NIST P-256, public components (after the tag) and secrets are
+         * compressed points
+         */
+        ELLIPTIC_CURVE
+      };
+
       static QByteArray GetP()
       {
         static QByteArray p = QByteArray::fromHex("0x"
@@ -72,20 +94,50 @@ namespace Crypto {
         return q;
       }
 
+      /**
+       * Returns the elliptic curve group, shared by every key
+       */
+      static QSharedPointer<const AbstractGroup::AbstractGroup> GetEcGroup();
+
+      /**
+       * Returns the key type tagged in a public component, MODULAR unless
+       * it is tagged ELLIPTIC_CURVE
+       * @param public_component the public component
+       */
+      static KeyType GetKeyType(const QByteArray &public_component);
+
+      /**
+       * Returns a public component without its tag, or an empty array if it
+       * is not tagged with the expected type
+       * @param public_component the public component
+       * @param type the expected key type
+       */
+      static QByteArray Untag(const QByteArray &public_component, KeyType type);
+
       /**
        * Constructor
        * @param data empty, private key, or seed if seed is true
        * @param seed specifies is data is a private key or a (default) seed
+       * @param type the group in which to generate the key
        */
       DiffieHellman(const QByteArray &data = QByteArray(),
-          bool seed = true);
+          bool seed = true, KeyType type = MODULAR);
+
+      /**
+       * Returns the group this key belongs to
+       */
+      KeyType GetKeyType() const
+      {
+        return m_type;
+      }
 
       /**
-       * Retrieves the public component of the Diffie-Hellman agreement
+       * Retrieves the public component of the Diffie-Hellman agreement,
+       * tagged with its key type
        */
       QByteArray GetPublicComponent() const
       {
-        return m_data->GetPublicComponent();
+        return QByteArray(1, char(m_type)) + m_data->GetPublicComponent();
       }
 
       /**
@@ -97,13 +149,21 @@ namespace Crypto {
       }
 
       /**
-       * Return the shared secret given the other sides public component
+       * Return the shared secret given the other sides public component,
+       * empty if it is not tagged with this key's type
        * @param remote_pub the other sides public component
        */
-      QByteArray GetSharedSecret(const QByteArray &remote_pub) const
-      {
-        return m_data->GetSharedSecret(remote_pub);
-      }
+      QByteArray GetSharedSecret(const QByteArray &remote_pub) const;
+
+      /**
+       * Returns the shared secret with each of the remote public components,
+       * in order.  When multithreading is enabled, the secrets are derived
+       * in parallel by one worker per thread pool thread.  Empty or invalid
+       * public components produce an empty secret.
+       * @param remote_pubs the other sides public components
+       */
+      QVector<QByteArray> GetSharedSecrets(
+          const QVector<QByteArray> &remote_pubs) const;
 
       /**
        * Return a non-interactive zero-knowledge proof of a shared Diffie-Hellman
@@ -130,6 +190,7 @@ namespace Crypto {
           const QByteArray &remote_pub, const QByteArray &proof);
 
     private:
+      KeyType m_type;
       QSharedDataPointer<IDiffieHellmanImpl> m_data;
   };
 }
@@ -2,6 +2,7 @@
 #include <QDebug>
 #include "CryptoRandom.hpp"
 #include "DsaPublicKey.hpp"
+#include "FixedBase.hpp"
 
 namespace Dissent {
 namespace Crypto {
@@ -100,7 +101,8 @@ namespace Crypto {
     }
 
     Integer secret = CryptoRandom().GetInteger(2, key->GetSubgroupOrder());
-    Integer shared = key->GetGenerator().Pow(secret, key->GetModulus());
+    Integer shared = FixedBase::GetGenerator(key->GetGenerator(),
+        key->GetModulus()).Pow(secret);
     Integer encrypted = encoded.Multiply(key->GetPublicElement().
         Pow(secret, key->GetModulus()), key->GetModulus());
 
@@ -140,7 +142,7 @@ namespace Crypto {
     }
       
     Integer secret = CryptoRandom().GetInteger(2, first.GetSubgroupOrder());
-    Integer shared = generator.Pow(secret, modulus);
+    Integer shared = FixedBase::GetGenerator(generator, modulus).Pow(secret);
 
     encrypted = encrypted.Pow(secret, modulus);
     encrypted = encoded.Multiply(encrypted, modulus);
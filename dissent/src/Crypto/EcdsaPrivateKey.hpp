@@ -0,0 +1,31 @@
+#ifndef DISSENT_CRYPTO_ECDSA_PRIVATE_KEY_H_GUARD
+#define DISSENT_CRYPTO_ECDSA_PRIVATE_KEY_H_GUARD
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include "EcdsaPublicKey.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  class EcdsaPrivateKey : public EcdsaPublicKey {
+    public:
+      /**
+       * Creates a private ECDSA key by generating it or from data
+       * @param data either key data or seed if seed is true
+       * @param seed used to define what data is
+       */
+      EcdsaPrivateKey(const QByteArray &data = QByteArray(), bool seed = false);
+
+      /**
+       * Loads an ECDSA private key from file
+       * @param file where the key is stored
+       */
+      EcdsaPrivateKey(const QString &file);
+
+      virtual bool IsPrivateKey() const { return true; }
+  };
+}
+}
+
+#endif
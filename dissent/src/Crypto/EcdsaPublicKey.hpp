@@ -0,0 +1,81 @@
+#ifndef DISSENT_CRYPTO_ECDSA_PUBLIC_KEY_H_GUARD
+#define DISSENT_CRYPTO_ECDSA_PUBLIC_KEY_H_GUARD
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include "AsymmetricKey.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  class BaseEcdsaPublicKeyImpl : public BaseAsymmetricKeyImpl {
+    public:
+      virtual QByteArray GetPublicPoint() const = 0;
+  };
+
+  /**
+   * An ECDSA public key over NIST P-256.  Signatures are 64 bytes and keys
+   * encode to well under 100 bytes, versus several hundred for DSA, and
+   * signing and verifying avoid large-modulus exponentiations.
+   */
+  class EcdsaPublicKey : public AsymmetricKey {
+    public:
+      /**
+       * Creates a public ECDSA key by generating it or from data
+       * @param data either key data or seed if seed is true
+       * @param seed used to define what data is
+       */
+      EcdsaPublicKey(const QByteArray &data = QByteArray(), bool seed = false);
+
+      /**
+       * Loads an ECDSA public key from file
+       * @param file where the key is stored
+       */
+      EcdsaPublicKey(const QString &file);
+
+      EcdsaPublicKey(BaseEcdsaPublicKeyImpl *key) : AsymmetricKey(key)
+      {
+      }
+
+      virtual bool IsPrivateKey() const { return false; }
+
+      virtual bool VerifyKey(const AsymmetricKey &key) const
+      {
+        const BaseEcdsaPublicKeyImpl *other = key.GetKeyImpl<BaseEcdsaPublicKeyImpl>();
+        const BaseEcdsaPublicKeyImpl *data = GetKey();
+
+        return IsValid() && key.IsValid() && other &&
+          (key.IsPrivateKey() != IsPrivateKey()) &&
+          (other->GetPublicPoint() == data->GetPublicPoint());
+      }
+
+      virtual bool Equals(const AsymmetricKey &key) const
+      {
+        const BaseEcdsaPublicKeyImpl *other = key.GetKeyImpl<BaseEcdsaPublicKeyImpl>();
+        const BaseEcdsaPublicKeyImpl *data = GetKey();
+
+        return IsValid() && key.IsValid() && other &&
+          (key.IsPrivateKey() == IsPrivateKey()) &&
+          (other->GetPublicPoint() == data->GetPublicPoint()) &&
+          (!IsPrivateKey() || (key.GetByteArray() == GetByteArray()));
+      }
+
+      virtual KeyTypes GetKeyType() const { return AsymmetricKey::ECDSA; }
+      virtual bool SupportsEncryption() const { return false; }
+      virtual bool SupportsVerification() const { return true; }
+
+      /**
+       * Returns the compressed encoding of the public point
+       */
+      QByteArray GetPublicPoint() const { return GetKey()->GetPublicPoint(); }
+
+    protected:
+      const BaseEcdsaPublicKeyImpl *GetKey() const
+      {
+        return GetKeyImpl<BaseEcdsaPublicKeyImpl>();
+      }
+  };
+}
+}
+
+#endif
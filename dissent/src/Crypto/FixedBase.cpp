@@ -0,0 +1,88 @@
+#include <QCache>
+#include <QDataStream>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "FixedBase.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  namespace {
+    QMutex cache_lock;
+    QCache<QByteArray, FixedBase> generator_cache(FixedBase::GeneratorCacheSize);
+    QCache<QByteArray, FixedBase> cache(FixedBase::CacheSize);
+
+    /**
+     * Returns the table for base and modulus from table_cache, building
+     * and inserting it on a miss
+     */
+    FixedBase Lookup(QCache<QByteArray, FixedBase> &table_cache,
+        const Integer &base, const Integer &modulus)
+    {
+      QByteArray key;
+      QDataStream stream(&key, QIODevice::WriteOnly);
+      stream << modulus << base;
+
+      {
+        QMutexLocker locker(&cache_lock);
+        FixedBase *cached = table_cache.object(key);
+        if(cached) {
+          return *cached;
+        }
+      }
+
+      // Build outside of the lock, concurrent builders of the same table
+      // simply race to insert it
+      FixedBase fixed(base, modulus);
+
+      QMutexLocker locker(&cache_lock);
+      if(!table_cache.contains(key)) {
+        table_cache.insert(key, new FixedBase(fixed));
+      }
+      return fixed;
+    }
+  }
+
+  FixedBase::FixedBase() :
+    _base(0),
+    _modulus(0)
+  {
+  }
+
+  FixedBase::FixedBase(const Integer &base, const Integer &modulus,
+      int max_exp_bits) :
+    _base(base),
+    _modulus(modulus)
+  {
+    if(modulus <= 2 || (modulus % 2) == 0) {
+      return;
+    }
+
+    if(max_exp_bits < 1) {
+      max_exp_bits = modulus.GetBitCount();
+    }
+
+    _impl = QSharedPointer<const IFixedBaseImpl>(base.GetHandle()->Precompute(
+          modulus.GetHandle(), max_exp_bits, Storage));
+  }
+
+  Integer FixedBase::Pow(const Integer &exp) const
+  {
+    if(!_impl || exp < 0) {
+      return _base.Pow(exp, _modulus);
+    }
+    return Integer(_impl->Pow(exp.GetHandle()));
+  }
+
+  FixedBase FixedBase::Get(const Integer &base, const Integer &modulus)
+  {
+    return Lookup(cache, base, modulus);
+  }
+
+  FixedBase FixedBase::GetGenerator(const Integer &generator,
+      const Integer &modulus)
+  {
+    return Lookup(generator_cache, generator, modulus);
+  }
+}
+}
@@ -0,0 +1,111 @@
+#ifndef DISSENT_CRYPTO_FIXED_BASE_H_GUARD
+#define DISSENT_CRYPTO_FIXED_BASE_H_GUARD
+
+#include <QSharedPointer>
+
+#include "Integer.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  /**
+   * Backend specific table of precomputed powers of a fixed base
+   */
+  class IFixedBaseImpl {
+    public:
+      virtual ~IFixedBaseImpl() {}
+
+      /**
+       * Returns base^exp mod modulus
+       * @param exp a non-negative exponent
+       */
+      virtual IIntegerImpl *Pow(const IIntegerImpl * const exp) const = 0;
+  };
+
+  /**
+   * A base that is exponentiated many times under the same modulus, such
+   * as a group generator or a long-lived public key.  A table of powers of
+   * the base is built once, after which an exponentiation costs roughly
+   * 1/Storage of the squarings of Integer::Pow.  The table is immutable and
+   * shared by copies, so a FixedBase may be used from many threads.
+   */
+  class FixedBase {
+    public:
+      /**
+       * Constructs a null base
+       */
+      FixedBase();
+
+      /**
+       * Builds the table for base modulo modulus
+       * @param base the fixed base
+       * @param modulus the modulus, tables are only built for odd moduli
+       * @param max_exp_bits the largest exponent the table covers, defaults
+       * to the size of the modulus.  Larger exponents are still correct.
+       */
+      FixedBase(const Integer &base, const Integer &modulus,
+          int max_exp_bits = -1);
+
+      /**
+       * Returns base^exp mod modulus
+       * @param exp the exponent
+       */
+      Integer Pow(const Integer &exp) const;
+
+      /**
+       * Returns the base
+       */
+      Integer GetBase() const { return _base; }
+
+      /**
+       * Returns the modulus
+       */
+      Integer GetModulus() const { return _modulus; }
+
+      /**
+       * True for a default constructed base
+       */
+      bool IsNull() const { return _modulus == 0; }
+
+      /**
+       * Returns the shared table for base and modulus, building it on first
+       * use.  The most recently used CacheSize tables are retained, so that
+       * keys recreated every round reuse their tables.  Group generators
+       * should use GetGenerator, so that short-lived bases do not evict them.
+       * @param base the fixed base
+       * @param modulus the modulus
+       */
+      static FixedBase Get(const Integer &base, const Integer &modulus);
+
+      /**
+       * Returns the shared table for a group generator, building it on first
+       * use.  Generator tables are retained separately from those of Get.
+       * @param generator the group generator
+       * @param modulus the modulus
+       */
+      static FixedBase GetGenerator(const Integer &generator,
+          const Integer &modulus);
+
+      /**
+       * Number of precomputed powers of the base in each table
+       */
+      static const int Storage = 16;
+
+      /**
+       * Number of tables retained by Get
+       */
+      static const int CacheSize = 32;
+
+      /**
+       * Number of tables retained by GetGenerator
+       */
+      static const int GeneratorCacheSize = 8;
+
+    private:
+      Integer _base;
+      Integer _modulus;
+      QSharedPointer<const IFixedBaseImpl> _impl;
+  };
+}
+}
+
+#endif
@@ -4,10 +4,13 @@
 #include <QByteArray>
 #include <QSharedData>
 #include <QString>
+#include <QVector>
 #include "Utils/Utils.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  class IFixedBaseImpl;
+
   class IIntegerImpl : public QSharedData {
     public:
       virtual ~IIntegerImpl() {}
@@ -23,6 +26,10 @@ namespace Crypto {
       virtual IIntegerImpl *PowCascade(const IIntegerImpl * const x0, const IIntegerImpl * const e0,
           const IIntegerImpl * const x1, const IIntegerImpl * const e1) const = 0;
       virtual IIntegerImpl *Inverse(const IIntegerImpl * const mod) const = 0;
+      virtual IFixedBaseImpl *Precompute(const IIntegerImpl * const mod,
+          int max_exp_bits, int storage) const = 0;
+      virtual IIntegerImpl *MultiPow(const QVector<const IIntegerImpl *> &bases,
+          const QVector<const IIntegerImpl *> &exps) const = 0;
       virtual bool Equals(const IIntegerImpl * const other) const = 0;
       virtual bool LessThan(const IIntegerImpl * const other) const = 0;
       virtual bool LessThanOrEqual(const IIntegerImpl * const other) const = 0;
@@ -160,6 +167,25 @@ namespace Crypto {
             x2.m_data.constData(), e2.m_data.constData()));
       }
 
+      /**
+       * Multi-exponentiation modulo n, computes the product of
+       * bases[i]^exps[i] mod n sharing the squarings across the bases
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       * @param mod modulus for the exponentiation
+       */
+      static Integer MultiPow(const QVector<Integer> &bases,
+          const QVector<Integer> &exps, const Integer &mod)
+      {
+        Q_ASSERT(bases.size() == exps.size());
+        QVector<const IIntegerImpl *> base_data, exp_data;
+        for(int idx = 0; idx < bases.size(); idx++) {
+          base_data.append(bases[idx].m_data.constData());
+          exp_data.append(exps[idx].m_data.constData());
+        }
+        return Integer(mod.m_data->MultiPow(base_data, exp_data));
+      }
+
       /**
        * Compute x such that ax == 1 mod p
        * @param mod inverse modulo this group
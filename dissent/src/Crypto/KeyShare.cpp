@@ -4,9 +4,24 @@
 
 #include "KeyShare.hpp"
 #include "DsaPublicKey.hpp"
+#include "EcdsaPublicKey.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  namespace {
+    /**
+     * Loads a public key of any of the supported signing types
+     */
+    QSharedPointer<AsymmetricKey> LoadPublicKey(const QString &path)
+    {
+      QSharedPointer<AsymmetricKey> key(new DsaPublicKey(path));
+      if(!key->IsValid()) {
+        key = QSharedPointer<AsymmetricKey>(new EcdsaPublicKey(path));
+      }
+      return key;
+    }
+  }
+
   KeyShare::KeyShare(const QString &path) :
     _fs_enabled(!path.isEmpty()),
     _path(path)
@@ -24,7 +39,7 @@ namespace Crypto {
       QString key_path = _path + "/" + name + ".pub";
       QFile key_file(key_path);
       if(key_file.exists()) {
-        QSharedPointer<AsymmetricKey> key(new DsaPublicKey(key_path));
+        QSharedPointer<AsymmetricKey> key(LoadPublicKey(key_path));
         KeyShare *ks = const_cast<KeyShare *>(this);
         ks->_keys[name] = key;
         return key;
@@ -66,7 +81,7 @@ namespace Crypto {
     QDir key_path(_path, "*.pub");
     foreach(const QString &key_name, key_path.entryList()) {
       QString path = _path + "/" + key_name;
-      QSharedPointer<AsymmetricKey> key(new DsaPublicKey(path));
+      QSharedPointer<AsymmetricKey> key(LoadPublicKey(path));
       if(!key->IsValid()) {
         qDebug() << "Invalid key:" << path;
         continue;
@@ -0,0 +1,245 @@
+#ifndef DISSENT_CRYPTO_MULTI_EXPONENTIATION_H_GUARD
+#define DISSENT_CRYPTO_MULTI_EXPONENTIATION_H_GUARD
+
+#include <QByteArray>
+#include <QVector>
+
+namespace Dissent {
+namespace Crypto {
+  /**
+   * Computes the product of bases[i]^exps[i], sharing the squarings across
+   * all of the bases.  Straus' interleaved window method is used for small
+   * inputs and Pippenger's bucket method for large ones.  The group is
+   * described by an Ops class providing:
+   *   typedef ... Value;
+   *   Value Identity() const;
+   *   Value Multiply(const Value &a, const Value &b) const;
+   *   Value Square(const Value &a) const;
+   * Exponents are non-negative big-endian magnitudes, as returned by
+   * Integer::GetByteArray.
+   */
+  class MultiExponentiation {
+    public:
+      /**
+       * Inputs with at least this many bases use Pippenger's method
+       */
+      static const int PippengerThreshold = 128;
+
+      /**
+       * Returns the product of bases[i]^exps[i]
+       * @param ops the group operations
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      template<typename Ops> static typename Ops::Value Compute(const Ops &ops,
+          const QVector<typename Ops::Value> &bases, const QVector<QByteArray> &exps)
+      {
+        Q_ASSERT(bases.size() == exps.size());
+
+        int bits = 0;
+        foreach(const QByteArray &exp, exps) {
+          bits = qMax(bits, GetBitCount(exp));
+        }
+
+        if(bits == 0) {
+          return ops.Identity();
+        }
+
+        if(bases.size() < PippengerThreshold) {
+          return Straus(ops, bases, exps, bits);
+        }
+        return Pippenger(ops, bases, exps, bits);
+      }
+
+      /**
+       * Returns the number of significant bits in a big-endian magnitude
+       */
+      static int GetBitCount(const QByteArray &exp)
+      {
+        for(int idx = 0; idx < exp.size(); idx++) {
+          unsigned char byte = exp[idx];
+          if(byte == 0) {
+            continue;
+          }
+
+          int bits = (exp.size() - idx - 1) * 8;
+          for(; byte; byte >>= 1) {
+            bits++;
+          }
+          return bits;
+        }
+        return 0;
+      }
+
+      /**
+       * Returns bits [start, start + count) of a big-endian magnitude
+       */
+      static int GetWindow(const QByteArray &exp, int start, int count)
+      {
+        int value = 0;
+        for(int bit = start + count - 1; bit >= start; bit--) {
+          int byte_idx = exp.size() - 1 - (bit / 8);
+          int set = 0;
+          if(byte_idx >= 0) {
+            set = (static_cast<unsigned char>(exp[byte_idx]) >> (bit % 8)) & 1;
+          }
+          value = (value << 1) | set;
+        }
+        return value;
+      }
+
+      /**
+       * Returns the window for Straus' method, trading the per-base table
+       * against the number of multiplications
+       */
+      static int StrausWindow(int bits)
+      {
+        int best = 1;
+        int best_cost = bits;
+        for(int window = 2; window <= 6; window++) {
+          int cost = ((1 << window) - 2) + (bits + window - 1) / window;
+          if(cost < best_cost) {
+            best = window;
+            best_cost = cost;
+          }
+        }
+        return best;
+      }
+
+      /**
+       * Returns the window for Pippenger's method, trading the number of
+       * buckets against the number of windows
+       */
+      static int PippengerWindow(int count, int bits)
+      {
+        int best = 1;
+        qint64 best_cost = -1;
+        for(int window = 1; window <= 16; window++) {
+          qint64 windows = (bits + window - 1) / window;
+          qint64 cost = windows * (count + (qint64(2) << window));
+          if(best_cost < 0 || cost < best_cost) {
+            best = window;
+            best_cost = cost;
+          }
+        }
+        return best;
+      }
+
+    private:
+      /**
+       * A running product that avoids multiplying by the identity
+       */
+      template<typename Ops> class Accumulator {
+        public:
+          typedef typename Ops::Value Value;
+
+          Accumulator() : _empty(true) {}
+
+          void Multiply(const Ops &ops, const Value &value)
+          {
+            if(_empty) {
+              _value = value;
+              _empty = false;
+            } else {
+              _value = ops.Multiply(_value, value);
+            }
+          }
+
+          void Multiply(const Ops &ops, const Accumulator &other)
+          {
+            if(!other._empty) {
+              Multiply(ops, other._value);
+            }
+          }
+
+          void Square(const Ops &ops)
+          {
+            if(!_empty) {
+              _value = ops.Square(_value);
+            }
+          }
+
+          Value Get(const Ops &ops) const
+          {
+            return _empty ? ops.Identity() : _value;
+          }
+
+        private:
+          Value _value;
+          bool _empty;
+      };
+
+      template<typename Ops> static typename Ops::Value Straus(const Ops &ops,
+          const QVector<typename Ops::Value> &bases,
+          const QVector<QByteArray> &exps, int bits)
+      {
+        typedef typename Ops::Value Value;
+        int window = StrausWindow(bits);
+        int table_size = 1 << window;
+
+        // tables[idx][digit] = bases[idx]^digit
+        QVector<QVector<Value> > tables(bases.size());
+        for(int idx = 0; idx < bases.size(); idx++) {
+          QVector<Value> &table = tables[idx];
+          table.resize(table_size);
+          table[1] = bases[idx];
+          for(int digit = 2; digit < table_size; digit++) {
+            table[digit] = ops.Multiply(table[digit - 1], bases[idx]);
+          }
+        }
+
+        Accumulator<Ops> result;
+        int windows = (bits + window - 1) / window;
+        for(int widx = windows - 1; widx >= 0; widx--) {
+          for(int bit = 0; bit < window; bit++) {
+            result.Square(ops);
+          }
+
+          for(int idx = 0; idx < bases.size(); idx++) {
+            int digit = GetWindow(exps[idx], widx * window, window);
+            if(digit) {
+              result.Multiply(ops, tables[idx][digit]);
+            }
+          }
+        }
+        return result.Get(ops);
+      }
+
+      template<typename Ops> static typename Ops::Value Pippenger(const Ops &ops,
+          const QVector<typename Ops::Value> &bases,
+          const QVector<QByteArray> &exps, int bits)
+      {
+        int window = PippengerWindow(bases.size(), bits);
+        int bucket_count = 1 << window;
+
+        Accumulator<Ops> result;
+        int windows = (bits + window - 1) / window;
+        for(int widx = windows - 1; widx >= 0; widx--) {
+          for(int bit = 0; bit < window; bit++) {
+            result.Square(ops);
+          }
+
+          // buckets[digit] = product of the bases with this digit
+          QVector<Accumulator<Ops> > buckets(bucket_count);
+          for(int idx = 0; idx < bases.size(); idx++) {
+            int digit = GetWindow(exps[idx], widx * window, window);
+            if(digit) {
+              buckets[digit].Multiply(ops, bases[idx]);
+            }
+          }
+
+          // sum = prod buckets[digit]^digit, via running products
+          Accumulator<Ops> running, sum;
+          for(int digit = bucket_count - 1; digit > 0; digit--) {
+            running.Multiply(ops, buckets[digit]);
+            sum.Multiply(ops, running);
+          }
+          result.Multiply(ops, sum);
+        }
+        return result.Get(ops);
+      }
+  };
+}
+}
+
+#endif
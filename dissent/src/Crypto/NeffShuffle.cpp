@@ -1,14 +1,216 @@
 #include <QDataStream>
 #include <QDebug>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include "Utils/Utils.hpp"
 
 #include "DsaPrivateKey.hpp"
 #include "DsaPublicKey.hpp"
+#include "FixedBase.hpp"
 #include "NeffShuffle.hpp"
 #include "CryptoRandom.hpp"
 #include "Hash.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  namespace {
+    /**
+     * A base and exponent, the base may have a precomputed table
+     */
+    struct PowTerm {
+      PowTerm(const Integer &base, const Integer &exponent) :
+        base(base), exponent(exponent)
+      {
+      }
+
+      PowTerm(const FixedBase &fixed, const Integer &exponent) :
+        fixed(fixed), exponent(exponent)
+      {
+      }
+
+      PowTerm() {}
+
+      Integer Pow(const Integer &modulus) const
+      {
+        return fixed.IsNull() ? base.Pow(exponent, modulus) :
+          fixed.Pow(exponent);
+      }
+
+      FixedBase fixed;
+      Integer base;
+      Integer exponent;
+    };
+
+    typedef QVector<PowTerm> PowList;
+
+    /**
+     * Evaluates a per-index function over a contiguous range of indexes,
+     * useful for QtConcurrent
+     */
+    template<typename T, typename F> struct RangeTask {
+      RangeTask(const F &function) : _function(function)
+      {
+      }
+
+      typedef QVector<T> result_type;
+
+      QVector<T> operator()(const QPair<int, int> &range) const
+      {
+        QVector<T> results;
+        results.reserve(range.second - range.first);
+        for(int idx = range.first; idx < range.second; idx++) {
+          results.append(_function(idx));
+        }
+        return results;
+      }
+
+      const F _function;
+    };
+
+    /**
+     * Evaluates function(idx) for idx in [0, count), splitting the indexes
+     * into one contiguous range per worker.  Results are returned in index
+     * order, regardless of scheduling, so callers remain deterministic.
+     */
+    template<typename T, typename F>
+      QVector<T> ParallelMap(int count, int workers, const F &function)
+    {
+      workers = qBound(1, workers, qMax(count, 1));
+      if(workers == 1) {
+        return RangeTask<T, F>(function)(QPair<int, int>(0, count));
+      }
+
+      int per_worker = count / workers;
+      int remainder = count % workers;
+
+      QList<QPair<int, int> > ranges;
+      int start = 0;
+      for(int widx = 0; widx < workers; widx++) {
+        int end = start + per_worker + (widx < remainder ? 1 : 0);
+        ranges.append(QPair<int, int>(start, end));
+        start = end;
+      }
+
+      // The calling thread participates in the blocking map, so this is
+      // safe even when called from within the global thread pool
+      QList<QVector<T> > partials =
+        QtConcurrent::blockingMapped(ranges, RangeTask<T, F>(function));
+
+      QVector<T> results;
+      results.reserve(count);
+      foreach(const QVector<T> &partial, partials) {
+        results += partial;
+      }
+      return results;
+    }
+
+    /**
+     * Computes base^exponent % modulus for a list of terms
+     */
+    struct PowAt {
+      PowAt(const PowList &terms, const Integer &modulus) :
+        _terms(terms), _modulus(modulus)
+      {
+      }
+
+      Integer operator()(int idx) const
+      {
+        return _terms[idx].Pow(_modulus);
+      }
+
+      const PowList &_terms;
+      const Integer &_modulus;
+    };
+
+    /**
+     * Computes the product of bases[i]^exps[i] % modulus over one of an
+     * even split of the indexes
+     */
+    struct MultiPowAt {
+      MultiPowAt(const QVector<Integer> &bases, const QVector<Integer> &exps,
+          const Integer &modulus, int parts) :
+        _bases(bases), _exps(exps), _modulus(modulus), _parts(parts)
+      {
+      }
+
+      Integer operator()(int part) const
+      {
+        int start = (_bases.size() * part) / _parts;
+        int end = (_bases.size() * (part + 1)) / _parts;
+        return Integer::MultiPow(_bases.mid(start, end - start),
+            _exps.mid(start, end - start), _modulus);
+      }
+
+      const QVector<Integer> &_bases;
+      const QVector<Integer> &_exps;
+      const Integer &_modulus;
+      const int _parts;
+    };
+
+    /**
+     * Removes a layer of encryption from a list of ciphertexts
+     */
+    struct DecryptAt {
+      DecryptAt(const DsaPrivateKey &key, const QVector<QByteArray> &input) :
+        _key(key), _input(input)
+      {
+      }
+
+      QByteArray operator()(int idx) const
+      {
+        return _key.SeriesDecrypt(_input[idx]);
+      }
+
+      const DsaPrivateKey &_key;
+      const QVector<QByteArray> &_input;
+    };
+  }
+
+  int NeffShuffle::Workers = 0;
+
+  namespace {
+    /**
+     * Returns base^exponent % modulus for each term, in order
+     */
+    QVector<Integer> Pow(const PowList &terms, const Integer &modulus)
+    {
+      return ParallelMap<Integer>(terms.size(),
+          NeffShuffle::GetWorkerCount(), PowAt(terms, modulus));
+    }
+
+    /**
+     * Returns the product of bases[i]^exps[i] % modulus, each worker
+     * computes a multi-exponentiation over its share of the bases
+     */
+    Integer MultiPow(const QVector<Integer> &bases,
+        const QVector<Integer> &exps, const Integer &modulus)
+    {
+      int parts = qBound(1, NeffShuffle::GetWorkerCount(), qMax(bases.size(), 1));
+      QVector<Integer> partials = ParallelMap<Integer>(parts, parts,
+          MultiPowAt(bases, exps, modulus, parts));
+
+      Integer product = 1;
+      foreach(const Integer &partial, partials) {
+        product = (product * partial) % modulus;
+      }
+      return product;
+    }
+  }
+
+  int NeffShuffle::GetWorkerCount()
+  {
+    if(!Utils::MultiThreading) {
+      return 1;
+    }
+
+    if(Workers > 0) {
+      return Workers;
+    }
+
+    return qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+  }
+
   bool NeffShuffle::Shuffle(const QVector<QByteArray> &input,
       const DsaPrivateKey &private_key,
       const QVector<DsaPublicKey> &remaining_keys,
@@ -35,6 +237,9 @@ namespace Crypto {
       h = (h * key.GetPublicElement()) % modulus;
     }
 
+    FixedBase fixed_g = FixedBase::GetGenerator(generator, modulus);
+    FixedBase fixed_h = FixedBase::Get(h, modulus);
+
     if(input.size() == 0) {
       qCritical() << "Cannot perform a shuffle on a 0 sized input";
       return false;
@@ -60,14 +265,19 @@ namespace Crypto {
     // Rencryption
     QVector<Integer> X_bar, Y_bar;
     QVector<QPair<QByteArray, int> > sortable;
+
+    PowList reencryption;
+    for(int idx = 0; idx < k; idx++) {
+      reencryption.append(PowTerm(fixed_g, beta[idx]));
+      reencryption.append(PowTerm(fixed_h, beta[idx]));
+    }
+    QVector<Integer> reencryption_pow = Pow(reencryption, modulus);
     
     for(int idx = 0; idx < k; idx++) {
-      Integer X_bar_l = (X[idx] *
-          generator.Pow(beta[idx], modulus)) % modulus;
+      Integer X_bar_l = (X[idx] * reencryption_pow[2 * idx]) % modulus;
       X_bar.append(X_bar_l);
 
-      Integer Y_bar_l = (Y[idx] *
-          h.Pow(beta[idx], modulus)) % modulus;
+      Integer Y_bar_l = (Y[idx] * reencryption_pow[2 * idx + 1]) % modulus;
       Y_bar.append(Y_bar_l);
 
       QByteArray toutput;
@@ -108,26 +318,40 @@ namespace Crypto {
 
     // Part 1 -- Generation of initial shares
 
-    Integer Gamma = generator.Pow(gamma, modulus);
-    QVector<Integer> A, C, U, W;
+    Integer Gamma = fixed_g.Pow(gamma);
+    QVector<Integer> A, U, W;
+
+    PowList shares;
+    for(int idx = 0; idx < k; idx++) {
+      shares.append(PowTerm(fixed_g, a[idx]));
+      shares.append(PowTerm(fixed_g, u[idx]));
+      shares.append(PowTerm(fixed_g, (gamma * w[idx]) % subgroup));
+    }
+    QVector<Integer> shares_pow = Pow(shares, modulus);
+
     for(int idx = 0; idx < k; idx++) {
-      A.append(generator.Pow(a[idx], modulus));
-      U.append(generator.Pow(u[idx], modulus));
-      W.append(generator.Pow((gamma * w[idx]) % subgroup, modulus));
+      A.append(shares_pow[3 * idx]);
+      U.append(shares_pow[3 * idx + 1]);
+      W.append(shares_pow[3 * idx + 2]);
     }
 
+    PowList permuted;
     for(int idx = 0; idx < k; idx++) {
-      C.append(A[pi[idx]].Pow(gamma, modulus));
+      permuted.append(PowTerm(A[pi[idx]], gamma));
     }
+    QVector<Integer> C = Pow(permuted, modulus);
 
-    Integer delta_sum = tau_0, x_multi = 1, y_multi = 1;
+    Integer delta_sum = tau_0;
+    QVector<Integer> delta_exps;
     for(int idx = 0; idx < k; idx++) {
       delta_sum = (delta_sum + w[idx] * beta[pi[idx]]) % subgroup;
-      x_multi = (x_multi * X[idx].Pow((w[inv_pi[idx]] - u[idx]) % subgroup, modulus)) % modulus;
-      y_multi = (y_multi * Y[idx].Pow((w[inv_pi[idx]] - u[idx]) % subgroup, modulus)) % modulus;
+      delta_exps.append((w[inv_pi[idx]] - u[idx]) % subgroup);
     }
-    Integer Delta_0 = (generator.Pow(delta_sum, modulus) * x_multi) % modulus;
-    Integer Delta_1 = (h.Pow(delta_sum, modulus) * y_multi) % modulus;
+    Integer x_multi = MultiPow(X, delta_exps, modulus);
+    Integer y_multi = MultiPow(Y, delta_exps, modulus);
+
+    Integer Delta_0 = (fixed_g.Pow(delta_sum) * x_multi) % modulus;
+    Integer Delta_1 = (fixed_h.Pow(delta_sum) * y_multi) % modulus;
 
     stream << output << Gamma << A << C << U << W << Delta_0 << Delta_1;
 
@@ -137,23 +361,30 @@ namespace Crypto {
     rand = CryptoRandom(cseed);
 
     QVector<Integer> p, B;
+    PowList challenges;
     for(int idx = 0; idx < k; idx++) {
       p.append(rand.GetInteger(2, subgroup));
-      B.append((generator.Pow(p[idx], modulus) *
-            U[idx].Inverse(modulus)) % modulus);
+      challenges.append(PowTerm(fixed_g, p[idx]));
+    }
+    QVector<Integer> challenges_pow = Pow(challenges, modulus);
+
+    for(int idx = 0; idx < k; idx++) {
+      B.append((challenges_pow[idx] * U[idx].Inverse(modulus)) % modulus);
     }
 
     // Part 3 -- Prover
 
-    QVector<Integer> b, d, D;
+    QVector<Integer> b, d;
     for(int idx = 0; idx < k; idx++) {
       b.append((p[idx] - u[idx]) % subgroup);
     }
 
+    PowList commitments;
     for(int idx = 0; idx < k; idx++) {
       d.append((gamma * b[pi[idx]]) % subgroup);
-      D.append(generator.Pow(d[idx], modulus));
+      commitments.append(PowTerm(fixed_g, d[idx]));
     }
+    QVector<Integer> D = Pow(commitments, modulus);
 
     stream << D;
 
@@ -206,17 +437,18 @@ namespace Crypto {
       theta.append(erand.GetInteger(0, subgroup));
     }
 
-    QVector<Integer> Theta;
-    Theta.append(generator.Pow(subgroup - (theta[0] * s_t[0]) % subgroup, modulus));
+    PowList thetas;
+    thetas.append(PowTerm(fixed_g, subgroup - (theta[0] * s_t[0]) % subgroup));
     for(int idx = 1; idx < k; idx++) {
-      Theta.append(generator.Pow((theta[idx - 1] * r_t[idx] - theta[idx] * s_t[idx]) % subgroup, modulus));
+      thetas.append(PowTerm(fixed_g, (theta[idx - 1] * r_t[idx] - theta[idx] * s_t[idx]) % subgroup));
     }
 
     for(int idx = k; idx < (2 * k - 1); idx++) {
-      Theta.append(generator.Pow((gamma * theta[idx - 1] - theta[idx]) % subgroup, modulus));
+      thetas.append(PowTerm(fixed_g, (gamma * theta[idx - 1] - theta[idx]) % subgroup));
     }
 
-    Theta.append(generator.Pow((gamma * theta[2 * k - 2]) % subgroup, modulus));
+    thetas.append(PowTerm(fixed_g, (gamma * theta[2 * k - 2]) % subgroup));
+    QVector<Integer> Theta = Pow(thetas, modulus);
 
     stream << Theta;
 
@@ -250,25 +482,33 @@ namespace Crypto {
     cseed = hash.ComputeHash(proof);
     rand = CryptoRandom(cseed);
 
-    QVector<QByteArray> decrypted;
+    QVector<QByteArray> decrypted = ParallelMap<QByteArray>(k,
+        GetWorkerCount(), DecryptAt(private_key, output));
     QVector<QPair<Integer, Integer> > decryption_proof;
 
-    foreach(const QByteArray &encrypted, output) {
-      decrypted.append(private_key.SeriesDecrypt(encrypted));
-      if(decrypted.last().isEmpty()) {
+    QVector<Integer> t_values, c_values;
+    PowList decryption_commits;
+    for(int idx = 0; idx < k; idx++) {
+      if(decrypted[idx].isEmpty()) {
         qDebug() << "Invalid encryption";
         return false;
       }
 
-      QDataStream tstream(encrypted);
+      QDataStream tstream(output[idx]);
       Integer shared;
       tstream >> shared;
 
-      Integer t = erand.GetInteger(2, subgroup);
-      Integer T = shared.Pow(t, modulus);
-      Integer c = rand.GetInteger(2, subgroup);
-      Integer s = (t + c * private_key.GetPrivateExponent()) % subgroup;
-      decryption_proof.append(QPair<Integer, Integer>(T, s));
+      t_values.append(erand.GetInteger(2, subgroup));
+      c_values.append(rand.GetInteger(2, subgroup));
+      decryption_commits.append(PowTerm(shared, t_values[idx]));
+    }
+    QVector<Integer> decryption_commits_pow = Pow(decryption_commits, modulus);
+
+    for(int idx = 0; idx < k; idx++) {
+      Integer s = (t_values[idx] + c_values[idx] *
+          private_key.GetPrivateExponent()) % subgroup;
+      decryption_proof.append(QPair<Integer, Integer>(
+            decryption_commits_pow[idx], s));
     }
 
     stream << decrypted;
@@ -297,6 +537,9 @@ namespace Crypto {
       h = (h * keys[idx].GetPublicElement()) % modulus;
     }
 
+    FixedBase fixed_g = FixedBase::GetGenerator(generator, modulus);
+    FixedBase fixed_h = FixedBase::Get(h, modulus);
+
     QVector<Integer> X, Y;
     for(int idx = 0; idx < input.size(); idx++) {
       QDataStream tstream(input[idx]);
@@ -342,6 +585,9 @@ namespace Crypto {
     }
     istream << shuffle_output << Gamma << A << C << U << W << Delta_0 << Delta_1;
 
+    // Gamma is a base for 2k of the verification exponentiations
+    FixedBase fixed_Gamma(Gamma, modulus);
+
     QVector<Integer> X_bar, Y_bar;
     for(int idx = 0; idx < input.size(); idx++) {
       if(idx > 0 && shuffle_output[idx - 1] > shuffle_output[idx]) {
@@ -362,10 +608,15 @@ namespace Crypto {
     rand = CryptoRandom(cseed);
 
     QVector<Integer> p, B;
+    PowList challenges;
     for(int idx = 0; idx < k; idx++) {
       p.append(rand.GetInteger(2, subgroup));
-      B.append((generator.Pow(p[idx], modulus) *
-            U[idx].Inverse(modulus)) % modulus);
+      challenges.append(PowTerm(fixed_g, p[idx]));
+    }
+    QVector<Integer> challenges_pow = Pow(challenges, modulus);
+
+    for(int idx = 0; idx < k; idx++) {
+      B.append((challenges_pow[idx] * U[idx].Inverse(modulus)) % modulus);
     }
 
     // Part 3 -- Prover
@@ -430,74 +681,95 @@ namespace Crypto {
 
     // Part 6.5 - Verifier
 
+    if(alpha.size() != 2 * k - 1) {
+      qDebug() << "Invalid alpha size";
+      return false;
+    }
+
     QVector<Integer> R, S, R_t, S_t;
-    Integer U_ = generator.Pow(subgroup - t, modulus);
-    Integer W_ = Gamma.Pow(subgroup - t, modulus);
 
+    PowList rs;
     for(int idx = 0; idx < k; idx++) {
-      R.append((A[idx] * B[idx].Pow(lambda, modulus)) % modulus);
+      rs.append(PowTerm(B[idx], lambda));
+      rs.append(PowTerm(D[idx], lambda));
+    }
+    rs.append(PowTerm(fixed_g, subgroup - t));
+    rs.append(PowTerm(fixed_Gamma, subgroup - t));
+    QVector<Integer> rs_pow = Pow(rs, modulus);
+
+    Integer U_ = rs_pow[2 * k];
+    Integer W_ = rs_pow[2 * k + 1];
+
+    for(int idx = 0; idx < k; idx++) {
+      R.append((A[idx] * rs_pow[2 * idx]) % modulus);
       R_t.append((R[idx] * U_) % modulus);
 
-      S.append((C[idx] * D[idx].Pow(lambda, modulus)) % modulus);
+      S.append((C[idx] * rs_pow[2 * idx + 1]) % modulus);
       S_t.append((S[idx] * W_) % modulus);
     }
 
-    if(Theta[0] !=
-        ((R_t[0].Pow(c, modulus) *
-         S_t[0].Pow(subgroup - alpha[0], modulus)) % modulus))
-    {
-      qDebug() << "Failed Theta[0] check";
-      return false;
-    }
-
+    PowList thetas;
+    thetas.append(PowTerm(R_t[0], c));
+    thetas.append(PowTerm(S_t[0], subgroup - alpha[0]));
     for(int idx = 1; idx < k; idx++) {
-      if(Theta[idx] !=
-          ((R_t[idx].Pow(alpha[idx - 1], modulus) *
-            S_t[idx].Pow(subgroup - alpha[idx], modulus)) % modulus))
-      {
-        qDebug().nospace() << "Failed Theta[" << idx <<"] check";
-        return false;
-      }
+      thetas.append(PowTerm(R_t[idx], alpha[idx - 1]));
+      thetas.append(PowTerm(S_t[idx], subgroup - alpha[idx]));
     }
 
     for(int idx = k; idx < 2 * k - 1; idx++) {
+      thetas.append(PowTerm(fixed_Gamma, alpha[idx - 1]));
+      thetas.append(PowTerm(fixed_g, subgroup - alpha[idx]));
+    }
+
+    thetas.append(PowTerm(fixed_Gamma, alpha[2 * k - 2]));
+    thetas.append(PowTerm(fixed_g, subgroup - c));
+    QVector<Integer> thetas_pow = Pow(thetas, modulus);
+
+    for(int idx = 0; idx < 2 * k; idx++) {
       if(Theta[idx] !=
-          ((Gamma.Pow(alpha[idx - 1], modulus) *
-            generator.Pow(subgroup - alpha[idx], modulus)) % modulus))
+          ((thetas_pow[2 * idx] * thetas_pow[2 * idx + 1]) % modulus))
       {
         qDebug().nospace() << "Failed Theta[" << idx <<"] check";
         return false;
       }
     }
 
-    if(Theta[2 * k - 1] !=
-        ((Gamma.Pow(alpha[2 * k - 2], modulus) *
-          generator.Pow(subgroup - c, modulus)) % modulus))
-    {
-      qDebug().nospace() << "Failed Theta[" << (2 * k - 1) <<"] check";
+    // Part 7 -- Verifier
+
+    if(sigma.size() != k) {
+      qDebug() << "Invalid sigma size";
       return false;
     }
 
-    // Part 7 -- Verifier
+    PowList sigmas;
+    for(int idx = 0; idx < k; idx++) {
+      sigmas.append(PowTerm(fixed_Gamma, sigma[idx]));
+    }
+    QVector<Integer> sigmas_pow = Pow(sigmas, modulus);
 
-    Integer iota_0 = 1, iota_1 = 1;
     for(int idx = 0; idx < k; idx++) {
-      iota_0 = (iota_0 * X_bar[idx].Pow(sigma[idx], modulus) *
-          X[idx].Pow(subgroup - p[idx], modulus)) % modulus;
-      iota_1 = (iota_1 * Y_bar[idx].Pow(sigma[idx], modulus) *
-          Y[idx].Pow(subgroup - p[idx], modulus)) % modulus;
-      if(Gamma.Pow(sigma[idx], modulus) != ((W[idx] * D[idx]) % modulus)) {
+      if(sigmas_pow[idx] != ((W[idx] * D[idx]) % modulus)) {
         qDebug().nospace() << "Failed sigma[" << idx << "] check";
         return false;
       }
     }
 
-    if(iota_0 != ((Delta_0 * generator.Pow(tau, modulus)) % modulus)) {
+    // iota_0 = prod X_bar^sigma X^-p, iota_1 = prod Y_bar^sigma Y^-p
+    QVector<Integer> iota_0_bases = X_bar + X;
+    QVector<Integer> iota_1_bases = Y_bar + Y;
+    QVector<Integer> iota_exps = sigma;
+    for(int idx = 0; idx < k; idx++) {
+      iota_exps.append(subgroup - p[idx]);
+    }
+    Integer iota_0 = MultiPow(iota_0_bases, iota_exps, modulus);
+    Integer iota_1 = MultiPow(iota_1_bases, iota_exps, modulus);
+
+    if(iota_0 != ((Delta_0 * fixed_g.Pow(tau)) % modulus)) {
       qDebug() << "Failed Iota_0 check";
       return false;
     }
 
-    if(iota_1 != ((Delta_1 * h.Pow(tau, modulus)) % modulus)) {
+    if(iota_1 != ((Delta_1 * fixed_h.Pow(tau)) % modulus)) {
       qDebug() << "Failed Iota_1 check";
       return false;
     }
@@ -521,6 +793,7 @@ namespace Crypto {
     cseed = hash.ComputeHash(proof);
     rand = CryptoRandom(cseed);
 
+    PowList decryptions;
     for(int idx = 0; idx < k; idx++) {
       QDataStream tstream_in(shuffle_output[idx]);
       Integer shared_in, secret_in;
@@ -531,7 +804,6 @@ namespace Crypto {
       tstream_out >> shared_out >> secret_out;
 
       Integer pair = (secret_in * secret_out.Inverse(modulus)) % modulus;
-      Integer T = decryption_proof[idx].first;
       Integer s = decryption_proof[idx].second;
       Integer c = rand.GetInteger(2, subgroup);
       if(shared_in != shared_out) {
@@ -539,7 +811,16 @@ namespace Crypto {
         return false;
       }
 
-      if(shared_out.Pow(s, modulus) != ((T * pair.Pow(c, modulus)) % modulus)) {
+      decryptions.append(PowTerm(shared_out, s));
+      decryptions.append(PowTerm(pair, c));
+    }
+    QVector<Integer> decryptions_pow = Pow(decryptions, modulus);
+
+    for(int idx = 0; idx < k; idx++) {
+      Integer T = decryption_proof[idx].first;
+      if(decryptions_pow[2 * idx] !=
+          ((T * decryptions_pow[2 * idx + 1]) % modulus))
+      {
         qDebug() << "Invalid decryption proof";
         return false;
       }
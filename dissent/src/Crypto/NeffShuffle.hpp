@@ -11,6 +11,12 @@
 
 namespace Dissent {
 namespace Crypto {
+  /**
+   * Neff's verifiable shuffle.  The independent modular exponentiations in
+   * each step of the proof and its verification are spread across
+   * GetWorkerCount() workers; all randomness is drawn serially, so the
+   * transcript does not depend upon the number of workers.
+   */
   class NeffShuffle {
     public:
       /**
@@ -43,6 +49,18 @@ namespace Crypto {
           const QVector<DsaPublicKey> &keys,
           const QByteArray &input_proof,
           QVector<QByteArray> &output);
+
+      /**
+       * Number of workers used for the exponentiations in Shuffle and
+       * Verify, 0 uses the size of the global thread pool
+       */
+      static int Workers;
+
+      /**
+       * Returns the number of workers in effect, 1 when
+       * Utils::MultiThreading is disabled
+       */
+      static int GetWorkerCount();
   };
 }
 }
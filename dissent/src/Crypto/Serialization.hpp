@@ -9,6 +9,8 @@
 #include "AsymmetricKey.hpp"
 #include "DsaPrivateKey.hpp"
 #include "DsaPublicKey.hpp"
+#include "EcdsaPrivateKey.hpp"
+#include "EcdsaPublicKey.hpp"
 #include "RsaPrivateKey.hpp"
 #include "RsaPublicKey.hpp"
 
@@ -52,6 +54,13 @@ namespace Crypto {
           key = QSharedPointer<DsaPublicKey>(new DsaPublicKey(bkey));
         }
         break;
+      case AsymmetricKey::ECDSA:
+        if(private_key) {
+          key = QSharedPointer<EcdsaPrivateKey>(new EcdsaPrivateKey(bkey));
+        } else {
+          key = QSharedPointer<EcdsaPublicKey>(new EcdsaPublicKey(bkey));
+        }
+        break;
       default:
         qWarning() << "Invalid key type" << key_type;
     }
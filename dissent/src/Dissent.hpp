@@ -2,7 +2,9 @@
 #define DISSENT_DISSENT_H_GUARD
 
 #include "Anonymity/BaseDCNetRound.hpp"
+#include "Anonymity/BatchVerifier.hpp"
 #include "Anonymity/CSDCNetRound.hpp"
+#include "Anonymity/HeresyRound.hpp"
 #include "Anonymity/Log.hpp"
 #include "Anonymity/NeffKeyShuffleRound.hpp"
 #include "Anonymity/NeffShuffleRound.hpp"
@@ -30,6 +32,10 @@
 #include "Crypto/AsymmetricKey.hpp"
 #include "Crypto/DsaPrivateKey.hpp"
 #include "Crypto/DsaPublicKey.hpp"
+#include "Crypto/EcdsaPrivateKey.hpp"
+#include "Crypto/EcdsaPublicKey.hpp"
+#include "Crypto/FixedBase.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "Crypto/NeffShuffle.hpp"
 #include "Crypto/RsaPrivateKey.hpp"
 #include "Crypto/RsaPublicKey.hpp"
@@ -103,6 +109,7 @@
 #include "Session/ClientRegister.hpp"
 #include "Session/ClientSession.hpp"
 #include "Session/ClientStates.hpp"
+#include "Session/EphemeralKeyPool.hpp"
 #include "Session/SerializeList.hpp"
 #include "Session/ServerAgree.hpp"
 #include "Session/ServerEnlist.hpp"
@@ -130,9 +137,17 @@
 #include "Transports/EdgeFactory.hpp"
 #include "Transports/EdgeListener.hpp"
 #include "Transports/EdgeListenerFactory.hpp"
+#ifdef __linux__
+#include "Transports/EpollAddress.hpp"
+#include "Transports/EpollEdge.hpp"
+#include "Transports/EpollEdgeListener.hpp"
+#endif
+#include "Transports/FrameParser.hpp"
+#include "Transports/IoThreads.hpp"
 #include "Transports/TcpAddress.hpp"
 #include "Transports/TcpEdge.hpp"
 #include "Transports/TcpEdgeListener.hpp"
+#include "Transports/TcpEdgeSocket.hpp"
 
 #include "Utils/Logging.hpp"
 #include "Utils/QRunTimeError.hpp"
@@ -149,6 +164,7 @@
 #include "Utils/Triggerable.hpp"
 #include "Utils/Triple.hpp"
 #include "Utils/Utils.hpp"
+#include "Utils/Xor.hpp"
 
 #include "Web/EchoService.hpp"
 #include "Web/GetDirectoryService.hpp"
@@ -24,6 +24,12 @@ namespace Messaging {
        */
       virtual QString ToString() const { return "Unknown ISender"; }
 
+      /**
+       * Returns the newest RPC wire format the remote peer is known to
+       * understand, 0 for the original format, see RpcHandler::WireVersion
+       */
+      virtual int GetWireVersion() const { return 0; }
+
       /**
        * Virtual destructor
        */
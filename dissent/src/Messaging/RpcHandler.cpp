@@ -1,6 +1,7 @@
 #include <QDataStream>
 #include <QVariant>
 
+#include "Utils/Serialization.hpp"
 #include "Utils/Time.hpp"
 #include "Utils/Timer.hpp"
 
@@ -12,7 +13,93 @@ namespace Messaging {
   const QString Request::RequestType = QString("r");
   const QString Response::ResponseType = QString("p");
 
+  namespace {
+    /**
+     * Methods with a compact id, the position in this table is the id
+     * carried on the wire.  Only append to this table, changing an existing
+     * entry requires a new WireVersion.  Entry 0 is reserved.
+     */
+    const char *MethodTable[] = {
+      "",
+      "SessionData",
+      "CS::Broadcast",
+      "RF::Data",
+      "CM::Ping",
+      "CM::Close",
+      "CM::Disconnect",
+      "LT::TunnelData"
+    };
+
+    const int MethodTableSize = sizeof(MethodTable) / sizeof(MethodTable[0]);
+
+    QVector<QString> BuildMethodNames()
+    {
+      QVector<QString> names;
+      for(int idx = 0; idx < MethodTableSize; idx++) {
+        names.append(QString::fromLatin1(MethodTable[idx]));
+      }
+      return names;
+    }
+
+    /**
+     * The method names as QStrings, so that decoding does not allocate.
+     * Filled by the static's initializer, which runs exactly once even
+     * when RpcHandlers on several threads get here first.
+     */
+    const QVector<QString> &GetMethodNames()
+    {
+      static const QVector<QString> names = BuildMethodNames();
+      return names;
+    }
+
+    /**
+     * The compact framing: a fixed 12 byte header followed by the payload.
+     * The first byte of the QVariantList framing is always 0 (the high byte
+     * of the list length), so the magic byte distinguishes the two.
+     *   byte 0: magic
+     *   byte 1: wire version
+     *   byte 2: type, 'n' or 'r'
+     *   byte 3: flags
+     *   bytes 4 - 7: method id
+     *   bytes 8 - 11: request id
+     */
+    const char CompactMagic = char(0xD5);
+    const int CompactHeaderSize = 12;
+
+    /**
+     * Payload is a raw QByteArray rather than a serialized QVariant
+     */
+    const char CompactRawFlag = 0x1;
+  }
+
+  int RpcHandler::GetMethodId(const QString &method)
+  {
+    return qMax(GetMethodNames().indexOf(method), 0);
+  }
+
+  const QByteArray &RpcHandler::GetFramingDictionary()
+  {
+    static const QByteArray dictionary = BuildFramingDictionary();
+    return dictionary;
+  }
+
+  QByteArray RpcHandler::BuildFramingDictionary()
+  {
+    // zlib finds matches near the end of the dictionary more cheaply, so
+    // the table is walked backwards to leave SessionData last
+    QByteArray dictionary;
+    for(int idx = MethodTableSize - 1; idx > 0; idx--) {
+      const QString &method = GetMethodNames()[idx];
+      dictionary += Serialize(Request::RequestType, 0, method,
+          QByteArray(), 0);
+      dictionary += Serialize(Request::NotificationType, 0, method,
+          QByteArray(), 0);
+    }
+    return dictionary;
+  }
+
   RpcHandler::RpcHandler() :
+    _method_callbacks(MethodTableSize),
     _current_id(1),
     _responder(new RequestResponder())
   {
@@ -52,6 +139,11 @@ namespace Messaging {
   void RpcHandler::HandleData(const QSharedPointer<ISender> &from,
       const QByteArray &data)
   {
+    if(!data.isEmpty() && data.at(0) == CompactMagic) {
+      HandleCompactData(from, data);
+      return;
+    }
+
     QVariantList container;
     QDataStream stream(data);
     stream >> container;
@@ -78,7 +170,65 @@ namespace Messaging {
     }
   }
 
+  void RpcHandler::HandleCompactData(const QSharedPointer<ISender> &from,
+      const QByteArray &data)
+  {
+    if(data.size() < CompactHeaderSize) {
+      qDebug() << "RpcHandler: Truncated message from" << from->ToString();
+      return;
+    }
+
+    int version = data.at(1);
+    if(version < 1 || version > WireVersion) {
+      qDebug() << "RpcHandler: Unsupported wire version" << version <<
+        "from" << from->ToString();
+      return;
+    }
+
+    QString type;
+    if(data.at(2) == 'n') {
+      type = Request::NotificationType;
+    } else if(data.at(2) == 'r') {
+      type = Request::RequestType;
+    } else {
+      qDebug() << "Received an unknown Rpc type:" << data.at(2);
+      return;
+    }
+
+    int method_id = Utils::Serialization::ReadInt(data, 4);
+    if(method_id <= 0 || method_id >= MethodTableSize) {
+      qDebug() << "RpcHandler: Request: Invalid method id" << method_id <<
+        ", from: " << from->ToString();
+      return;
+    }
+
+    QVariant payload;
+    if(data.at(3) & CompactRawFlag) {
+      payload = data.mid(CompactHeaderSize);
+    } else {
+      QByteArray serialized = QByteArray::fromRawData(
+          data.constData() + CompactHeaderSize, data.size() - CompactHeaderSize);
+      QDataStream stream(serialized);
+      stream >> payload;
+    }
+
+    QVariantList container;
+    container.append(type);
+    container.append(Utils::Serialization::ReadInt(data, 8));
+    container.append(GetMethodNames()[method_id]);
+    container.append(payload);
+
+    DispatchRequest(Request(_responder, from, container),
+        _method_callbacks[method_id]);
+  }
+
   void RpcHandler::HandleRequest(const Request &request)
+  {
+    DispatchRequest(request, _callbacks.value(request.GetMethod()));
+  }
+
+  void RpcHandler::DispatchRequest(const Request &request,
+      const QSharedPointer<RequestHandler> &cb)
   {
     int id = request.GetId();
     if(id <= 0) {
@@ -88,7 +238,6 @@ namespace Messaging {
     }
 
     QString method = request.GetMethod();
-    QSharedPointer<RequestHandler> cb = _callbacks[method];
     if(cb.isNull()) {
       qDebug() << "RpcHandler: Request: No such method: " << method <<
         ", from: " << request.GetFrom()->ToString();
@@ -148,17 +297,37 @@ namespace Messaging {
       const QString &method, const QVariant &data)
   {
     int id = IncrementId();
-    QVariantList container = Request::BuildNotification(id, method, data);
-
-    QByteArray msg;
-    QDataStream stream(&msg, QIODevice::WriteOnly);
-    stream << container;
+    QByteArray msg = Serialize(Request::NotificationType, id, method, data,
+        to->GetWireVersion());
 
     qDebug() << "RpcHandler: Sending notification" << id << "for" << method <<
       "to" << to->ToString();
     to->Send(msg);
   }
 
+  void RpcHandler::SendNotification(const QList<QSharedPointer<ISender> > &to,
+      const QString &method, const QVariant &data)
+  {
+    if(to.isEmpty()) {
+      return;
+    }
+
+    int id = IncrementId();
+
+    // At most one serialization per wire version
+    QHash<int, QByteArray> msgs;
+    qDebug() << "RpcHandler: Sending notification" << id << "for" << method <<
+      "to" << to.count() << "destinations";
+    foreach(const QSharedPointer<ISender> &sender, to) {
+      int version = sender->GetWireVersion();
+      if(!msgs.contains(version)) {
+        msgs[version] = Serialize(Request::NotificationType, id, method,
+            data, version);
+      }
+      sender->Send(msgs[version]);
+    }
+  }
+
   int RpcHandler::SendRequest(const QSharedPointer<ISender> &to,
       const QString &method, const QVariant &data,
       const QSharedPointer<ResponseHandler> &cb, bool timeout)
@@ -172,11 +341,8 @@ namespace Messaging {
 
     _requests[id] = QSharedPointer<RequestState>(
         new RequestState(to, cb, ctime, timer, timeout));
-    QVariantList container = Request::BuildRequest(id, method, data);
-
-    QByteArray msg;
-    QDataStream stream(&msg, QIODevice::WriteOnly);
-    stream << container;
+    QByteArray msg = Serialize(Request::RequestType, id, method, data,
+        to->GetWireVersion());
     qDebug() << "RpcHandler: Sending request" << id << "for" << method <<
       "to" << to->ToString();
     to->Send(msg);
@@ -208,6 +374,39 @@ namespace Messaging {
     request.GetFrom()->Send(msg);
   }
 
+  QByteArray RpcHandler::Serialize(const QString &type, int id,
+      const QString &method, const QVariant &data, int wire_version)
+  {
+    int method_id = GetMethodId(method);
+    if(wire_version < 1 || method_id == 0) {
+      QVariantList container = (type == Request::NotificationType) ?
+        Request::BuildNotification(id, method, data) :
+        Request::BuildRequest(id, method, data);
+
+      QByteArray msg;
+      QDataStream stream(&msg, QIODevice::WriteOnly);
+      stream << container;
+      return msg;
+    }
+
+    QByteArray header(CompactHeaderSize, 0);
+    header[0] = CompactMagic;
+    header[1] = 1;
+    header[2] = (type == Request::NotificationType) ? 'n' : 'r';
+    Utils::Serialization::WriteInt(method_id, header, 4);
+    Utils::Serialization::WriteInt(id, header, 8);
+
+    if(data.type() == QVariant::ByteArray) {
+      header[3] = CompactRawFlag;
+      return header + data.toByteArray();
+    }
+
+    QByteArray msg = header;
+    QDataStream stream(&msg, QIODevice::Append);
+    stream << data;
+    return msg;
+  }
+
   int RpcHandler::IncrementId()
   {
     return _current_id++;
@@ -221,6 +420,7 @@ namespace Messaging {
     }
 
     _callbacks[name] = cb;
+    _method_callbacks[GetMethodId(name)] = cb;
     return true;
   }
 
@@ -233,6 +433,7 @@ namespace Messaging {
 
     _callbacks[name] =
       QSharedPointer<RequestHandler>(new RequestHandler(obj, method));
+    _method_callbacks[GetMethodId(name)] = _callbacks[name];
     return true;
   }
 
@@ -244,6 +445,7 @@ namespace Messaging {
     }
 
     _callbacks.remove(name);
+    _method_callbacks[GetMethodId(name)].clear();
     return true;
   }
 }
@@ -7,6 +7,7 @@
 #include <QObject>
 #include <QString>
 #include <QSharedPointer>
+#include <QVector>
 
 #include "Utils/TimerCallback.hpp"
 #include "Utils/TimerEvent.hpp"
@@ -33,6 +34,30 @@ namespace Messaging {
       typedef Utils::TimerMethod<RpcHandler, int> TimerCallback;
       static const int TimeoutDelta = 60000;
 
+      /**
+       * The newest wire format this handler speaks.  Version 0 is the
+       * original QDataStream-serialized QVariantList, version 1 adds the
+       * compact framing for requests and notifications of the methods in
+       * the method table.  Incoming messages are accepted in either format,
+       * outgoing messages use the version negotiated with the peer, see
+       * ISender::GetWireVersion.
+       */
+      static const int WireVersion = 1;
+
+      /**
+       * Returns the method table id for a method name, 0 if the method is
+       * not in the table and must be sent by name
+       * @param method the method name
+       */
+      static int GetMethodId(const QString &method);
+
+      /**
+       * Returns the original framing of a request and a notification for
+       * each method in the method table, a zlib dictionary for priming the
+       * compression of frames, see Transports::Edge
+       */
+      static const QByteArray &GetFramingDictionary();
+
       inline static QSharedPointer<RpcHandler> GetEmpty()
       {
         static QSharedPointer<RpcHandler> handler(new RpcHandler());
@@ -75,6 +100,16 @@ namespace Messaging {
       void SendNotification(const QSharedPointer<ISender> &to,
           const QString &method, const QVariant &data);
 
+      /**
+       * Send the same notification to many destinations, the notification
+       * is serialized once and the resulting buffer shared by every send
+       * @param to the destinations for the notification
+       * @param method the remote method
+       * @param data the input data for that method
+       */
+      void SendNotification(const QList<QSharedPointer<ISender> > &to,
+          const QString &method, const QVariant &data);
+
       /**
        * Send a request
        * @param to the destination for the request
@@ -144,12 +179,44 @@ namespace Messaging {
       void StartTimer();
       void Timeout(const int &);
 
+      /**
+       * Builds the dictionary returned by GetFramingDictionary
+       */
+      static QByteArray BuildFramingDictionary();
+
+      /**
+       * Serializes a request or notification in the requested wire format
+       * @param type request or notification
+       * @param id the id of the request
+       * @param method the remote method
+       * @param data the input data for that method
+       * @param wire_version the wire format understood by the destination
+       */
+      static QByteArray Serialize(const QString &type, int id,
+          const QString &method, const QVariant &data, int wire_version);
+
+      /**
+       * Handle an incoming message in the compact framing
+       * @param from a return path to the requestor
+       * @param data serialized request message
+       */
+      void HandleCompactData(const QSharedPointer<ISender> &from,
+          const QByteArray &data);
+
       /**
        * Handle an incoming request
        * @param request the request
        */
       void HandleRequest(const Request &request);
 
+      /**
+       * Hands a request to its registered handler
+       * @param request the request
+       * @param cb the handler registered for the request's method
+       */
+      void DispatchRequest(const Request &request,
+          const QSharedPointer<RequestHandler> &cb);
+
       /**
        * Handle an incoming response
        * @param response the response
@@ -166,6 +233,11 @@ namespace Messaging {
        */
       QHash<QString, QSharedPointer<RequestHandler> > _callbacks;
 
+      /**
+       * Callbacks for the methods in the method table, indexed by method id
+       */
+      QVector<QSharedPointer<RequestHandler> > _method_callbacks;
+
       /**
        * Maps id to a callback method to handle responses
        */
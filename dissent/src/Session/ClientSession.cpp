@@ -8,6 +8,7 @@
 
 #include "ClientSession.hpp"
 #include "ServerQueued.hpp"
+#include "ServerSession.hpp"
 #include "ServerStart.hpp"
 #include "ServerStop.hpp"
 #include "SessionData.hpp"
@@ -33,8 +34,79 @@ namespace Client {
       void SetServer(const Connections::Id &server) { m_server = server; }
       Connections::Id GetServer() const { return m_server; }
 
+      /**
+       * Verifies a ServerQueued from our server and returns its agreed servers
+       * @param queued the ServerQueued message
+       */
+      QList<QSharedPointer<ServerAgree> > CheckServerQueued(const ServerQueued &queued)
+      {
+        QString server_id = GetServer().ToString();
+
+        // We need to check for order in these messages, but for now ... whatever
+
+        if(!GetKeyShare()->GetKey(server_id)->Verify(
+              queued.GetPayload(), queued.GetSignature()))
+        {
+          throw Utils::QRunTimeError("Invalid signature");
+        }
+
+        QList<QSharedPointer<ServerAgree> > servers = queued.GetAgreeList();
+        if(servers.size() != GetOverlay()->GetServerIds().size()) {
+          throw Utils::QRunTimeError("Insufficient agree messages");
+        }
+
+        foreach(const QSharedPointer<ServerAgree> &agree, servers) {
+          CheckServerAgree(*agree, servers[0]->GetRoundId());
+        }
+        return servers;
+      }
+
+      /**
+       * Generates fresh round data and registers with our server
+       * @param round_id the round to register for
+       */
+      void Register(const QByteArray &round_id)
+      {
+        GenerateRoundData();
+        ClientRegister reg(GetOverlay()->GetId(), round_id,
+            GetEphemeralKey()->GetPublicKey(), GetOptionalPublic());
+        reg.SetSignature(GetPrivateKey()->Sign(reg.GetPayload()));
+        GetOverlay()->SendNotification(GetServer(), "SessionData", reg.GetPacket());
+        m_registered_round_id = round_id;
+      }
+
+      /**
+       * Returns the round we last registered for
+       */
+      QByteArray GetRegisteredRoundId() const { return m_registered_round_id; }
+
+      /**
+       * Holds the servers of the next round, which we registered for while
+       * the current round was still running
+       */
+      void SetPendingServers(const QList<QSharedPointer<ServerAgree> > &servers)
+      {
+        m_pending_servers = servers;
+      }
+
+      QList<QSharedPointer<ServerAgree> > GetPendingServers() const
+      {
+        return m_pending_servers;
+      }
+
+      /**
+       * Forgets an early registration that will not be used
+       */
+      void ClearPendingRound()
+      {
+        m_pending_servers.clear();
+        m_registered_round_id.clear();
+      }
+
     private:
       Connections::Id m_server;
+      QByteArray m_registered_round_id;
+      QList<QSharedPointer<ServerAgree> > m_pending_servers;
   };
 
   class OfflineState : public SessionState {
@@ -66,6 +138,9 @@ namespace Client {
         AddMessageProcessor(SessionMessage::ServerQueued,
             QSharedPointer<StateCallback>(new StateCallbackImpl<WaitingForServerState>(this,
                 &WaitingForServerState::HandleServerQueued)));
+        AddMessageProcessor(SessionMessage::ServerStart,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<WaitingForServerState>(this,
+                &WaitingForServerState::HandleServerStart)));
       }
 
       virtual ProcessResult Init()
@@ -93,6 +168,16 @@ namespace Client {
         return StoreMessage;
       }
 
+      /**
+       * A ServerStart for a round registered for early
+       */
+      ProcessResult HandleServerStart(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &)
+      {
+        return StoreMessage;
+      }
+
       bool CheckServer()
       {
         QSharedPointer<Connections::Connection> server;
@@ -108,6 +193,9 @@ namespace Client {
           QSharedPointer<ClientSessionSharedState> state =
             GetSharedState().dynamicCast<ClientSessionSharedState>();
         if(server) {
+          if(server->GetRemoteId() != state->GetServer()) {
+            state->ClearPendingRound();
+          }
           state->SetServer(server->GetRemoteId());
         }
         return !server.isNull();
@@ -119,6 +207,9 @@ namespace Client {
       explicit Queuing(const QSharedPointer<Messaging::StateData> &data) :
         SessionState(data, SessionStates::Queuing, SessionMessage::ServerQueued)
       {
+        AddMessageProcessor(SessionMessage::ServerStart,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<Queuing>(this,
+                &Queuing::HandleServerStart)));
       }
 
       virtual ProcessResult HandleDisconnection(const Connections::Id &id)
@@ -139,6 +230,15 @@ namespace Client {
           GetSharedState().dynamicCast<ClientSessionSharedState>();
 
         qDebug() << state->GetOverlay()->GetId() << this;
+
+        // Already queued and registered during the previous round
+        QList<QSharedPointer<ServerAgree> > servers = state->GetPendingServers();
+        if(!servers.isEmpty()) {
+          state->SetPendingServers(QList<QSharedPointer<ServerAgree> >());
+          state->SetRoundId(servers[0]->GetRoundId());
+          state->SetServers(servers);
+          return NextState;
+        }
         return NoChange;
       }
 
@@ -150,31 +250,21 @@ namespace Client {
           GetSharedState().dynamicCast<ClientSessionSharedState>();
 
         QSharedPointer<ServerQueued> queued(msg.dynamicCast<ServerQueued>());
-
-        QString server_id = state->GetServer().ToString();
-
-        // We need to check for order in these messages, but for now ... whatever
-
-        if(!state->GetKeyShare()->GetKey(server_id)->Verify(
-              queued->GetPayload(), queued->GetSignature()))
-        {
-          throw Utils::QRunTimeError("Invalid signature");
-        }
-
-        QList<QSharedPointer<ServerAgree> > servers = queued->GetAgreeList();
-        if(servers.size() != state->GetOverlay()->GetServerIds().size()) {
-          throw Utils::QRunTimeError("Insufficient agree messages");
-        }
-
-        foreach(const QSharedPointer<ServerAgree> &agree, servers) {
-          state->CheckServerAgree(*agree, servers[0]->GetRoundId());
-        }
+        QList<QSharedPointer<ServerAgree> > servers = state->CheckServerQueued(*queued);
 
         state->SetRoundId(servers[0]->GetRoundId());
         state->SetServers(servers);
 
         return NextState;
       }
+
+    private:
+      ProcessResult HandleServerStart(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &)
+      {
+        return StoreMessage;
+      }
   };
 
   class Registering : public SessionState {
@@ -185,6 +275,9 @@ namespace Client {
         AddMessageProcessor(SessionMessage::SessionData,
             QSharedPointer<StateCallback>(new StateCallbackImpl<Registering>(this,
                 &Registering::HandleData)));
+        AddMessageProcessor(SessionMessage::ServerQueued,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<Registering>(this,
+                &Registering::HandleServerQueued)));
 
         QSharedPointer<SessionSharedState> state =
           GetSharedState().dynamicCast<SessionSharedState>();
@@ -210,12 +303,9 @@ namespace Client {
         QSharedPointer<ClientSessionSharedState> state =
           GetSharedState().dynamicCast<ClientSessionSharedState>();
 
-        state->GenerateRoundData();
-        ClientRegister reg(state->GetOverlay()->GetId(), state->GetRoundId(),
-            state->GetEphemeralKey()->GetPublicKey(), state->GetOptionalPublic());
-        reg.SetSignature(state->GetPrivateKey()->Sign(reg.GetPayload()));
-        state->GetOverlay()->SendNotification(state->GetServer(),
-            "SessionData", reg.GetPacket());
+        if(state->GetRegisteredRoundId() != state->GetRoundId()) {
+          state->Register(state->GetRoundId());
+        }
 
         qDebug() << state->GetOverlay()->GetId() << this;
         return NoChange;
@@ -233,6 +323,12 @@ namespace Client {
           throw Utils::QRunTimeError("Incorrect number of signatures");
         }
 
+        foreach(const QSharedPointer<ClientRegister> &clr, start->GetRegisterList()) {
+          if(clr->GetRoundId() != state->GetRoundId()) {
+            throw Utils::QRunTimeError("ServerStart for another round");
+          }
+        }
+
         Crypto::Hash hash;
         QByteArray hash_data = hash.ComputeHash(start->GetRegisterBytes());
         int idx = 0;
@@ -255,6 +351,28 @@ namespace Client {
       {
         return StoreMessage;
       }
+
+      /**
+       * The servers restarted their handshake after we registered
+       */
+      ProcessResult HandleServerQueued(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &msg)
+      {
+        QSharedPointer<ClientSessionSharedState> state =
+          GetSharedState().dynamicCast<ClientSessionSharedState>();
+
+        QSharedPointer<ServerQueued> queued(msg.dynamicCast<ServerQueued>());
+        QList<QSharedPointer<ServerAgree> > servers = state->CheckServerQueued(*queued);
+        if(servers[0]->GetRoundId() == state->GetRoundId()) {
+          return NoChange;
+        }
+
+        state->SetRoundId(servers[0]->GetRoundId());
+        state->SetServers(servers);
+        state->Register(state->GetRoundId());
+        return NoChange;
+      }
   };
 
   class CommState : public SessionState {
@@ -266,6 +384,9 @@ namespace Client {
         AddMessageProcessor(SessionMessage::ServerQueued,
             QSharedPointer<StateCallback>(new StateCallbackImpl<CommState>(
                 this, &CommState::HandleServerQueued)));
+        AddMessageProcessor(SessionMessage::ServerStart,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<CommState>(
+                this, &CommState::HandleServerStart)));
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<CommState>(
                 this, &CommState::HandleServerStop)));
@@ -279,6 +400,11 @@ namespace Client {
         return NoChange;
       }
 
+      virtual ProcessResult HandleRoundFinished()
+      {
+        return NextState;
+      }
+
       virtual ProcessResult ProcessPacket(
           const QSharedPointer<Messaging::ISender> &from,
           const QSharedPointer<Messaging::Message> &msg)
@@ -314,7 +440,37 @@ namespace Client {
       }
 
     private:
+      /**
+       * With pipelining, the servers are negotiating the next round while
+       * this one runs, register for it now so the next round can start as
+       * soon as this one finishes.  Otherwise, hold the message for Queuing.
+       */
       ProcessResult HandleServerQueued(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &msg)
+      {
+        if(!ServerSession::PipelineRounds) {
+          return StoreMessage;
+        }
+
+        QSharedPointer<ClientSessionSharedState> state =
+          GetSharedState().dynamicCast<ClientSessionSharedState>();
+
+        QSharedPointer<ServerQueued> queued(msg.dynamicCast<ServerQueued>());
+        QList<QSharedPointer<ServerAgree> > servers = state->CheckServerQueued(*queued);
+        QByteArray round_id = servers[0]->GetRoundId();
+        if(round_id == state->GetRoundId() ||
+            round_id == state->GetRegisteredRoundId())
+        {
+          return NoChange;
+        }
+
+        state->SetPendingServers(servers);
+        state->Register(round_id);
+        return NoChange;
+      }
+
+      ProcessResult HandleServerStart(
           const QSharedPointer<Messaging::ISender> &,
           const QSharedPointer<Messaging::Message> &)
       {
@@ -329,6 +485,20 @@ namespace Client {
           GetSharedState().dynamicCast<ClientSessionSharedState>();
         QSharedPointer<ServerStop> stop(msg.dynamicCast<ServerStop>());
 
+        // The servers gave up on the next round we registered for early
+        if(!state->GetPendingServers().isEmpty() &&
+            stop->GetRoundId() == state->GetRegisteredRoundId())
+        {
+          if(!state->GetOverlay()->IsServer(stop->GetId()) ||
+              !state->GetKeyShare()->GetKey(stop->GetId().ToString())->Verify(
+                stop->GetPayload(), stop->GetSignature()))
+          {
+            throw Utils::QRunTimeError("Invalid signature");
+          }
+          state->ClearPendingRound();
+          return NoChange;
+        }
+
         if(state->CheckServerStop(*stop)) {
           state->GetRound()->Stop();
         } else {
@@ -0,0 +1,131 @@
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "Crypto/DsaPrivateKey.hpp"
+#include "Crypto/EcdsaPrivateKey.hpp"
+#include "Utils/Utils.hpp"
+
+#include "EphemeralKeyPool.hpp"
+
+namespace Dissent {
+namespace Session {
+  namespace {
+    typedef Crypto::DiffieHellman::KeyType KeyType;
+    typedef EphemeralKeyPool::KeySet KeySet;
+
+    struct PoolState {
+      QMutex lock;
+      QHash<int, QQueue<KeySet> > ready;
+      QHash<int, int> in_flight;
+    };
+
+    /**
+     * Never destroyed, generators may still be running while the process
+     * exits
+     */
+    PoolState &GetState()
+    {
+      static PoolState *state = new PoolState();
+      return *state;
+    }
+
+    class GenerateKeySet : public QRunnable {
+      public:
+        explicit GenerateKeySet(KeyType type) : _type(type) {}
+
+        virtual void run()
+        {
+          KeySet keys = EphemeralKeyPool::Generate(_type);
+
+          PoolState &state = GetState();
+          QMutexLocker locker(&state.lock);
+          state.in_flight[_type]--;
+          state.ready[_type].enqueue(keys);
+        }
+
+      private:
+        const KeyType _type;
+    };
+  }
+
+  int EphemeralKeyPool::Size = 2;
+  int EphemeralKeyPool::LocalNodes = 1;
+
+  EphemeralKeyPool::KeySet EphemeralKeyPool::Take(KeyType type)
+  {
+    KeySet keys;
+    bool found = false;
+    {
+      PoolState &state = GetState();
+      QMutexLocker locker(&state.lock);
+      QQueue<KeySet> &ready = state.ready[type];
+      if(!ready.isEmpty()) {
+        keys = ready.dequeue();
+        found = true;
+      }
+    }
+
+    Fill(type);
+
+    if(!found) {
+      keys = Generate(type);
+    }
+    return keys;
+  }
+
+  void EphemeralKeyPool::Fill(KeyType type)
+  {
+    if(!Utils::MultiThreading || GetCapacity() < 1) {
+      return;
+    }
+
+    int missing;
+    {
+      PoolState &state = GetState();
+      QMutexLocker locker(&state.lock);
+      missing = GetCapacity() - state.ready[type].count() -
+        state.in_flight[type];
+      if(missing > 0) {
+        state.in_flight[type] += missing;
+      }
+    }
+
+    for(int idx = 0; idx < missing; idx++) {
+      QThreadPool::globalInstance()->start(new GenerateKeySet(type));
+    }
+  }
+
+  int EphemeralKeyPool::Available(KeyType type)
+  {
+    PoolState &state = GetState();
+    QMutexLocker locker(&state.lock);
+    return state.ready.value(type).count();
+  }
+
+  EphemeralKeyPool::KeySet EphemeralKeyPool::Generate(KeyType type)
+  {
+    KeySet keys;
+    if(type == Crypto::DiffieHellman::ELLIPTIC_CURVE) {
+      keys.signing_key = QSharedPointer<Crypto::AsymmetricKey>(
+          new Crypto::EcdsaPrivateKey());
+    } else {
+      keys.signing_key = QSharedPointer<Crypto::AsymmetricKey>(
+          new Crypto::DsaPrivateKey());
+    }
+
+    keys.dh_key = Crypto::DiffieHellman(QByteArray(), true, type);
+    return keys;
+  }
+
+  void EphemeralKeyPool::Clear()
+  {
+    PoolState &state = GetState();
+    QMutexLocker locker(&state.lock);
+    state.ready.clear();
+  }
+}
+}
@@ -0,0 +1,94 @@
+#ifndef DISSENT_SESSION_EPHEMERAL_KEY_POOL_H_GUARD
+#define DISSENT_SESSION_EPHEMERAL_KEY_POOL_H_GUARD
+
+#include <QSharedPointer>
+
+#include "Crypto/AsymmetricKey.hpp"
+#include "Crypto/DiffieHellman.hpp"
+
+namespace Dissent {
+namespace Session {
+  /**
+   * Keeps ephemeral round keys generated ahead of time on the global thread
+   * pool, so that starting a round only removes a key set from the pool.
+   * The pool is shared by every session in the process and holds up to
+   * Size key sets of each type for each of the LocalNodes; every Take
+   * schedules a replacement.  Without
+   * MultiThreading or with a Size of 0 keys are generated on demand.
+   */
+  class EphemeralKeyPool {
+    public:
+      /**
+       * The keys a node generates for each round
+       */
+      struct KeySet {
+        /**
+         * The ephemeral signing key
+         */
+        QSharedPointer<Crypto::AsymmetricKey> signing_key;
+
+        /**
+         * The ephemeral Diffie-Hellman key
+         */
+        Crypto::DiffieHellman dh_key;
+      };
+
+      /**
+       * Returns a fresh key set, generating one if the pool is empty, and
+       * schedules the pool to be refilled
+       * @param type the Diffie-Hellman key type, elliptic curve key sets
+       * use ECDSA signing keys and modular key sets DSA signing keys
+       */
+      static KeySet Take(Crypto::DiffieHellman::KeyType type);
+
+      /**
+       * Schedules the generation of key sets until the pool for type holds
+       * GetCapacity key sets
+       * @param type the Diffie-Hellman key type
+       */
+      static void Fill(Crypto::DiffieHellman::KeyType type);
+
+      /**
+       * Returns the number of key sets of type ready to be taken
+       * @param type the Diffie-Hellman key type
+       */
+      static int Available(Crypto::DiffieHellman::KeyType type);
+
+      /**
+       * Generates a key set on the calling thread
+       * @param type the Diffie-Hellman key type
+       */
+      static KeySet Generate(Crypto::DiffieHellman::KeyType type);
+
+      /**
+       * Drops all pregenerated key sets, key sets being generated are still
+       * added to the pool
+       */
+      static void Clear();
+
+      /**
+       * Returns the number of key sets of each type kept pregenerated,
+       * Size for each of the LocalNodes
+       */
+      static int GetCapacity() { return Size * qMax(LocalNodes, 1); }
+
+      /**
+       * Number of key sets of each type to keep pregenerated per local node
+       */
+      static int Size;
+
+      /**
+       * Number of nodes in the process drawing from the pool
+       */
+      static int LocalNodes;
+
+    private:
+      /**
+       * No instances
+       */
+      EphemeralKeyPool() {}
+  };
+}
+}
+
+#endif
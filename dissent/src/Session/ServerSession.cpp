@@ -1,4 +1,6 @@
 #include <QDebug>
+#include <QSet>
+#include <QtConcurrentMap>
 
 #include "Connections/IOverlaySender.hpp"
 #include "Crypto/AsymmetricKey.hpp"
@@ -9,6 +11,7 @@
 #include "Utils/QRunTimeError.hpp"
 #include "Utils/Timer.hpp"
 #include "Utils/TimerCallback.hpp"
+#include "Utils/Utils.hpp"
 
 #include "SessionData.hpp"
 #include "ServerEnlisted.hpp"
@@ -25,6 +28,23 @@
 namespace Dissent {
 namespace Session {
 namespace Server {
+  /**
+   * Checks a ClientRegister's signature and ephemeral key, useful for
+   * QtConcurrent
+   */
+  struct VerifyClientRegister {
+    typedef bool result_type;
+    typedef QPair<QSharedPointer<Crypto::AsymmetricKey>,
+            QSharedPointer<ClientRegister> > Input;
+
+    bool operator()(const Input &input) const
+    {
+      const ClientRegister &clr = *input.second;
+      return input.first->Verify(clr.GetPayload(), clr.GetSignature()) &&
+        clr.GetKey()->IsValid();
+    }
+  };
+
   class ServerSessionSharedState : public SessionSharedState {
     public:
       explicit ServerSessionSharedState(const QSharedPointer<ClientServer::Overlay> &overlay,
@@ -75,6 +95,78 @@ namespace Server {
           throw Utils::QRunTimeError("Invalid Ephemeral Key: " +
               clr.GetId().ToString());
         }
+
+        m_checked_registers.insert(Crypto::Hash().ComputeHash(clr.GetPacket()));
+      }
+
+      /**
+       * Checks a list of ClientRegisters as CheckClientRegister would.
+       * Registrations already checked this round, including duplicates
+       * within and across the servers' lists, are checked only once.  The
+       * first registration of each client is verified on the thread pool,
+       * further registrations from the same client share its key and are
+       * verified afterwards on this thread.
+       */
+      void CheckClientRegisters(const QList<QSharedPointer<ClientRegister> > &list)
+      {
+        QList<VerifyClientRegister::Input> pending;
+        QList<VerifyClientRegister::Input> serial;
+        QList<QByteArray> pending_hashes;
+        QList<QByteArray> serial_hashes;
+        QSet<QByteArray> seen;
+        QSet<Connections::Id> ids;
+
+        foreach(const QSharedPointer<ClientRegister> &clr, list) {
+          QByteArray hash = Crypto::Hash().ComputeHash(clr->GetPacket());
+          if(m_checked_registers.contains(hash) || seen.contains(hash)) {
+            continue;
+          }
+          seen.insert(hash);
+
+          if(clr->GetRoundId() != GetRoundId()) {
+            CheckClientRegister(*clr);
+          }
+
+          // KeyShare loads keys lazily, so look them up on this thread
+          QSharedPointer<Crypto::AsymmetricKey> key =
+            GetKeyShare()->GetKey(clr->GetId().ToString());
+          if(!key) {
+            CheckClientRegister(*clr);
+          }
+
+          if(ids.contains(clr->GetId())) {
+            serial.append(VerifyClientRegister::Input(key, clr));
+            serial_hashes.append(hash);
+          } else {
+            ids.insert(clr->GetId());
+            pending.append(VerifyClientRegister::Input(key, clr));
+            pending_hashes.append(hash);
+          }
+        }
+
+        QList<bool> results;
+        VerifyClientRegister verify;
+        if(Utils::MultiThreading && pending.count() > 1) {
+          results = QtConcurrent::blockingMapped<QList<bool> >(pending, verify);
+        } else {
+          foreach(const VerifyClientRegister::Input &input, pending) {
+            results.append(verify(input));
+          }
+        }
+
+        pending.append(serial);
+        pending_hashes.append(serial_hashes);
+        foreach(const VerifyClientRegister::Input &input, serial) {
+          results.append(verify(input));
+        }
+
+        for(int idx = 0; idx < results.count(); idx++) {
+          if(!results[idx]) {
+            // Produces the specific error
+            CheckClientRegister(*pending[idx].second);
+          }
+          m_checked_registers.insert(pending_hashes[idx]);
+        }
       }
 
       void Reset()
@@ -85,6 +177,7 @@ namespace Server {
         m_agree.clear();
         m_registered_msgs.clear();
         m_verify.clear();
+        m_checked_registers.clear();
         SetRoundId(QByteArray());
       }
 
@@ -145,6 +238,32 @@ namespace Server {
         return stop.GetImmediate();
       }
 
+      /**
+       * With pipelined rounds, passes round messages that arrive during the
+       * next round's handshake to the round that is still running
+       */
+      Messaging::State::ProcessResult HandleRoundData(
+          const QSharedPointer<Messaging::ISender> &from,
+          const QSharedPointer<Messaging::Message> &msg)
+      {
+        QSharedPointer<Anonymity::Round> round = GetRound();
+        if(!round || round->Stopped()) {
+          return Messaging::State::NoChange;
+        }
+
+        QSharedPointer<SessionData> rm(msg.dynamicCast<SessionData>());
+        QSharedPointer<Connections::IOverlaySender> sender =
+          from.dynamicCast<Connections::IOverlaySender>();
+
+        if(!sender) {
+          throw Utils::QRunTimeError("Received wayward message from: " +
+              from->ToString());
+        }
+
+        round->ProcessPacket(sender->GetRemoteId(), rm->GetPacket());
+        return Messaging::State::NoChange;
+      }
+
       void SetInit(const QSharedPointer<ServerInit> &init) { m_init = init; }
       QSharedPointer<ServerInit> GetInit() const { return m_init; }
 
@@ -172,6 +291,7 @@ namespace Server {
       QByteArray m_agree;
       RegisterMap m_registered_msgs;
       VerifyMap m_verify;
+      QSet<QByteArray> m_checked_registers;
   };
 
   class OfflineState : public SessionState {
@@ -218,6 +338,14 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<WaitingForServersState>(this,
                 &WaitingForServersState::HandleServerStop)));
+
+        if(ServerSession::PipelineRounds) {
+          QSharedPointer<ServerSessionSharedState> state =
+            GetSharedState().dynamicCast<ServerSessionSharedState>();
+          AddMessageProcessor(SessionMessage::SessionData,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                  state.data(), &ServerSessionSharedState::HandleRoundData)));
+        }
       }
 
       virtual ProcessResult Init()
@@ -293,6 +421,14 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<InitState>(this,
                 &InitState::HandleServerStop)));
+
+        if(ServerSession::PipelineRounds) {
+          QSharedPointer<ServerSessionSharedState> state =
+            GetSharedState().dynamicCast<ServerSessionSharedState>();
+          AddMessageProcessor(SessionMessage::SessionData,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                  state.data(), &ServerSessionSharedState::HandleRoundData)));
+        }
       }
 
       virtual ProcessResult Init()
@@ -404,6 +540,13 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<SessionSharedState>(
                 state.data(), &SessionSharedState::DefaultHandleServerStop)));
+
+        if(ServerSession::PipelineRounds) {
+          AddMessageProcessor(SessionMessage::SessionData,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                  state.dynamicCast<ServerSessionSharedState>().data(),
+                  &ServerSessionSharedState::HandleRoundData)));
+        }
       }
 
       virtual ProcessResult Init()
@@ -557,6 +700,13 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<SessionSharedState>(
                 state.data(), &SessionSharedState::DefaultHandleServerStop)));
+
+        if(ServerSession::PipelineRounds) {
+          AddMessageProcessor(SessionMessage::SessionData,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                  state.dynamicCast<ServerSessionSharedState>().data(),
+                  &ServerSessionSharedState::HandleRoundData)));
+        }
       }
 
       virtual ProcessResult Init()
@@ -665,6 +815,13 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<SessionSharedState>(
                 state.data(), &SessionSharedState::DefaultHandleServerStop)));
+
+        if(ServerSession::PipelineRounds) {
+          AddMessageProcessor(SessionMessage::SessionData,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                  state.dynamicCast<ServerSessionSharedState>().data(),
+                  &ServerSessionSharedState::HandleRoundData)));
+        }
       }
 
       ~RegisteringState()
@@ -683,7 +840,8 @@ namespace Server {
         Utils::TimerCallback *cb =
           new Utils::TimerMethod<RegisteringState, int>(this,
               &RegisteringState::FinishClientRegister, 0);
-        m_register_timer = Utils::Timer::GetInstance().QueueCallback(cb, ROUND_TIMER);
+        m_register_timer = Utils::Timer::GetInstance().QueueCallback(cb,
+            ServerSession::RegistrationTimeout);
 
         ServerQueued queued(state->GetServers(), QByteArray(16, 0),
             state->GetServersBytes());
@@ -721,7 +879,7 @@ namespace Server {
         state->CheckClientRegister(*clr);
         m_registered_msgs[remote_id] = clr;
         qDebug() << state->GetOverlay()->GetId() << this << remote_id << "registered";
-        return NoChange;
+        return CheckRegistrationComplete();
       }
 
       virtual ProcessResult HandleConnection(const Connections::Id &remote)
@@ -740,10 +898,41 @@ namespace Server {
       {
         QSharedPointer<ServerSessionSharedState> state =
           GetSharedState().dynamicCast<ServerSessionSharedState>();
-        return state->DefaultHandleDisconnection(id);
+        if(state->GetOverlay()->IsServer(id)) {
+          return state->DefaultHandleDisconnection(id);
+        }
+        return CheckRegistrationComplete();
       }
 
     private:
+      /**
+       * When closing registration early, ends registration once every
+       * connected client has registered
+       */
+      ProcessResult CheckRegistrationComplete()
+      {
+        if(!ServerSession::CloseRegistrationEarly || m_registered_msgs.isEmpty()) {
+          return NoChange;
+        }
+
+        QSharedPointer<ServerSessionSharedState> state =
+          GetSharedState().dynamicCast<ServerSessionSharedState>();
+        Connections::ConnectionTable &ct = state->GetOverlay()->GetConnectionTable();
+        foreach(const QSharedPointer<Connections::Connection> &con, ct.GetConnections()) {
+          Connections::Id remote_id = con->GetRemoteId();
+          if(!state->GetOverlay()->IsServer(remote_id) &&
+              !m_registered_msgs.contains(remote_id))
+          {
+            return NoChange;
+          }
+        }
+
+        qDebug() << state->GetOverlay()->GetId() << this <<
+          "all connected clients registered.";
+        state->SetClientRegisterMsgs(m_registered_msgs);
+        return NextState;
+      }
+
       ProcessResult HandleServerList(
           const QSharedPointer<Messaging::ISender> &,
           const QSharedPointer<Messaging::Message> &)
@@ -765,7 +954,6 @@ namespace Server {
         StateChange(NextState);
       }
 
-      int ROUND_TIMER = 30 * 1000;
       Utils::TimerEvent m_register_timer;
       ServerSessionSharedState::RegisterMap m_registered_msgs;
   };
@@ -786,6 +974,13 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerStop,
             QSharedPointer<StateCallback>(new StateCallbackImpl<SessionSharedState>(
                 state.data(), &SessionSharedState::DefaultHandleServerStop)));
+
+        if(ServerSession::PipelineRounds) {
+          AddMessageProcessor(SessionMessage::SessionData,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                  state.dynamicCast<ServerSessionSharedState>().data(),
+                  &ServerSessionSharedState::HandleRoundData)));
+        }
       }
 
       virtual ProcessResult Init()
@@ -830,9 +1025,7 @@ namespace Server {
               remote_id.ToString());
         }
 
-        foreach(const QSharedPointer<ClientRegister> &clr, list->GetRegisterList()) {
-          state->CheckClientRegister(*clr);
-        }
+        state->CheckClientRegisters(list->GetRegisterList());
 
         foreach(const QSharedPointer<ClientRegister> &clr, list->GetRegisterList()) {
           if(m_registered_msgs.contains(clr->GetId())) {
@@ -884,6 +1077,14 @@ namespace Server {
             QSharedPointer<StateCallback>(new StateCallbackImpl<VerifyListState>(this,
                 &VerifyListState::HandleData)));
 
+        // The proposer may begin the following handshake before the last
+        // ServerVerifyList reaches us
+        if(ServerSession::PipelineRounds) {
+          AddMessageProcessor(SessionMessage::ServerInit,
+              QSharedPointer<StateCallback>(new StateCallbackImpl<VerifyListState>(this,
+                  &VerifyListState::HandleServerInit)));
+        }
+
         QSharedPointer<SessionSharedState> state =
           GetSharedState().dynamicCast<SessionSharedState>();
         AddMessageProcessor(SessionMessage::ServerStop,
@@ -970,10 +1171,79 @@ namespace Server {
         return StoreMessage;
       }
 
+      ProcessResult HandleServerInit(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &)
+      {
+        return StoreMessage;
+      }
+
       ServerSessionSharedState::VerifyMap m_verify;
       QByteArray m_registered;
   };
 
+  /**
+   * With pipelined rounds, holds a server whose next round is agreed upon
+   * until the running round finishes, so that no server starts a round while
+   * another is still in the previous one
+   */
+  class WaitingForRoundState : public SessionState {
+    public:
+      WaitingForRoundState(const QSharedPointer<Messaging::StateData> &data) :
+        SessionState(data,
+            SessionStates::WaitingForRound,
+            SessionMessage::None)
+      {
+        AddMessageProcessor(SessionMessage::ServerVerifyList,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<WaitingForRoundState>(this,
+                &WaitingForRoundState::HandleServerVerifyList)));
+
+        QSharedPointer<ServerSessionSharedState> state =
+          GetSharedState().dynamicCast<ServerSessionSharedState>();
+        AddMessageProcessor(SessionMessage::SessionData,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<ServerSessionSharedState>(
+                state.data(), &ServerSessionSharedState::HandleRoundData)));
+        AddMessageProcessor(SessionMessage::ServerStop,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<SessionSharedState>(
+                state.data(), &SessionSharedState::DefaultHandleServerStop)));
+      }
+
+      virtual ProcessResult Init()
+      {
+        QSharedPointer<ServerSessionSharedState> state =
+          GetSharedState().dynamicCast<ServerSessionSharedState>();
+
+        QSharedPointer<Anonymity::Round> round = state->GetRound();
+        if(!round || round->Stopped()) {
+          return NextState;
+        }
+
+        qDebug() << state->GetOverlay()->GetId() << this <<
+          "waiting for round" << round->GetNonce().toBase64();
+        return NoChange;
+      }
+
+      virtual ProcessResult HandleRoundFinished()
+      {
+        return NextState;
+      }
+
+      virtual ProcessResult HandleDisconnection(const Connections::Id &id)
+      {
+        QSharedPointer<ServerSessionSharedState> state =
+          GetSharedState().dynamicCast<ServerSessionSharedState>();
+        return state->DefaultHandleDisconnection(id);
+      }
+
+    private:
+      ProcessResult HandleServerVerifyList(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &)
+      {
+        return StoreMessage;
+      }
+  };
+
   class CommState : public SessionState {
     public:
       explicit CommState(const QSharedPointer<Messaging::StateData> &data) :
@@ -1011,7 +1281,14 @@ namespace Server {
         }
 
         state->GetRound()->Start();
-        return NoChange;
+
+        // Negotiate the next round while this one runs
+        return ServerSession::PipelineRounds ? NextState : NoChange;
+      }
+
+      virtual ProcessResult HandleRoundFinished()
+      {
+        return NextState;
       }
 
       virtual ProcessResult ProcessPacket(
@@ -1054,6 +1331,10 @@ namespace Server {
 }
 
   using namespace Server;
+
+  int ServerSession::RegistrationTimeout = 30 * 1000;
+  bool ServerSession::CloseRegistrationEarly = false;
+  bool ServerSession::PipelineRounds = false;
   
   ServerSession::ServerSession(
           const QSharedPointer<ClientServer::Overlay> &overlay,
@@ -1081,6 +1362,8 @@ namespace Server {
           SessionStates::VerifyList, SessionMessage::ServerVerifyList));
     GetStateMachine().AddState(new Messaging::StateFactory<CommState>(
           SessionStates::Communicating, SessionMessage::SessionData));
+    GetStateMachine().AddState(new Messaging::StateFactory<WaitingForRoundState>(
+          SessionStates::WaitingForRound, SessionMessage::None));
 
     GetStateMachine().AddTransition(SessionStates::Offline,
         SessionStates::WaitingForServers);
@@ -1094,8 +1377,15 @@ namespace Server {
         SessionStates::Registering);
     GetStateMachine().AddTransition(SessionStates::Registering,
         SessionStates::ListExchange);
-    GetStateMachine().AddTransition(SessionStates::ListExchange,
-        SessionStates::VerifyList);
+    if(PipelineRounds) {
+      GetStateMachine().AddTransition(SessionStates::ListExchange,
+          SessionStates::WaitingForRound);
+      GetStateMachine().AddTransition(SessionStates::WaitingForRound,
+          SessionStates::VerifyList);
+    } else {
+      GetStateMachine().AddTransition(SessionStates::ListExchange,
+          SessionStates::VerifyList);
+    }
     GetStateMachine().AddTransition(SessionStates::VerifyList,
         SessionStates::Communicating);
     GetStateMachine().AddTransition(SessionStates::Communicating,
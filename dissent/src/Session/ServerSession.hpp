@@ -40,6 +40,26 @@ namespace Session {
        */
       virtual ~ServerSession();
 
+      /**
+       * Longest time in ms that a server accepts client registrations for
+       * the upcoming round
+       */
+      static int RegistrationTimeout;
+
+      /**
+       * Close registration as soon as every client connected to this server
+       * has registered rather than waiting out RegistrationTimeout, so that
+       * consecutive rounds follow each other after a few round trips
+       */
+      static bool CloseRegistrationEarly;
+
+      /**
+       * Run the next round's enlist, agree and registration exchanges while
+       * the current round is still running, so that the next round starts
+       * right after the current one finishes
+       */
+      static bool PipelineRounds;
+
     protected:
       /**
        * Constructor
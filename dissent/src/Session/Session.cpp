@@ -71,7 +71,7 @@ namespace Session {
       return;
     }
 
-    GetStateMachine().StateComplete();
+    GetStateMachine().HandleRoundFinished();
   }
 
   void Session::HandleData(const Messaging::Request &notification)
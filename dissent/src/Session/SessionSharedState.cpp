@@ -1,14 +1,24 @@
 #include "SessionSharedState.hpp"
 
 #include "Crypto/DiffieHellman.hpp"
-#include "Crypto/DsaPrivateKey.hpp"
 #include "Crypto/Hash.hpp"
 #include "Utils/QRunTimeError.hpp"
 
+#include "EphemeralKeyPool.hpp"
 #include "SerializeList.hpp"
 
 namespace Dissent {
 namespace Session {
+  namespace {
+    Crypto::DiffieHellman::KeyType GetDiffieHellmanType()
+    {
+      return SessionSharedState::EllipticCurveKeys ?
+        Crypto::DiffieHellman::ELLIPTIC_CURVE : Crypto::DiffieHellman::MODULAR;
+    }
+  }
+
+  bool SessionSharedState::EllipticCurveKeys = false;
+
   SessionSharedState::SessionSharedState(
       const QSharedPointer<ClientServer::Overlay> &overlay,
       const QSharedPointer<Crypto::AsymmetricKey> &my_key,
@@ -20,6 +30,7 @@ namespace Session {
     m_keys(keys),
     m_create_round(create_round)
   {
+    overlay->SetRelayKeys(my_key, keys);
   }
 
   SessionSharedState::~SessionSharedState()
@@ -28,10 +39,10 @@ namespace Session {
 
   void SessionSharedState::GenerateRoundData()
   {
-    m_ephemeral_key = QSharedPointer<Crypto::AsymmetricKey>(new Crypto::DsaPrivateKey());
-    Crypto::DiffieHellman dh_key;
-    m_optional_public = dh_key.GetPublicComponent();
-    m_optional_private = dh_key.GetPrivateComponent();
+    EphemeralKeyPool::KeySet keys = EphemeralKeyPool::Take(GetDiffieHellmanType());
+    m_ephemeral_key = keys.signing_key;
+    m_optional_public = keys.dh_key.GetPublicComponent();
+    m_optional_private = keys.dh_key.GetPrivateComponent();
   }
 
   void SessionSharedState::SetServers(
@@ -102,7 +113,36 @@ namespace Session {
     m_last = hashvalue;
 
     QSharedPointer<ServerStop> stop = msg.dynamicCast<ServerStop>();
-    CheckServerStop(*(msg.dynamicCast<ServerStop>()));
+
+    // With pipelined rounds, the next round's handshake runs alongside the
+    // round this stop is meant for
+    if(m_round && !m_round->Stopped() &&
+        (stop->GetRoundId() != GetRoundId()) &&
+        (stop->GetRoundId() == m_round->GetNonce()))
+    {
+      if(!GetOverlay()->IsServer(stop->GetId()) ||
+          !GetKeyShare()->GetKey(stop->GetId().ToString())->Verify(
+            stop->GetPayload(), stop->GetSignature()))
+      {
+        throw Utils::QRunTimeError("Invalid signature");
+      }
+
+      if(GetOverlay()->GetServerIds().first() == GetOverlay()->GetId()) {
+        GetOverlay()->Broadcast("SessionData", msg->GetPacket());
+      }
+
+      qDebug() << GetOverlay()->GetId() << "Stopping Round:" <<
+        stop->GetRoundId().toBase64() << "Reason:" << stop->GetReason() <<
+        "Immediately: " << stop->GetImmediate();
+      if(stop->GetImmediate()) {
+        m_round->Stop("Stopped by " + stop->GetId().ToString());
+      } else {
+        m_round->SetInterrupted();
+      }
+      return Messaging::State::NoChange;
+    }
+
+    CheckServerStop(*stop);
 
     if(GetOverlay()->GetServerIds().first() == GetOverlay()->GetId()) {
       qDebug() << "Received a ServerStop message from" << stop->GetId() << "... redistributing...";
@@ -139,7 +179,8 @@ namespace Session {
     Identity::Roster clients(client_idents);
     Identity::Roster servers(server_idents);
 
-    Crypto::DiffieHellman dh_key(GetOptionalPrivate().toByteArray(), false);
+    Crypto::DiffieHellman dh_key(GetOptionalPrivate().toByteArray(), false,
+        GetDiffieHellmanType());
     Identity::PrivateIdentity my_ident(GetOverlay()->GetId(),
         GetEphemeralKey(), dh_key);
     m_round = m_create_round(clients, servers, my_ident,
@@ -67,10 +67,16 @@ namespace Session {
 
       /**
        * Generates round data for the upcoming round, including ephemeral signing key
-       * and in some cases a DiffieHellman key.
+       * and in some cases a DiffieHellman key, taken from the EphemeralKeyPool.
        */
       void GenerateRoundData();
 
+      /**
+       * Generate ECDSA round signing keys and elliptic curve Diffie-Hellman
+       * keys rather than DSA and modular Diffie-Hellman keys
+       */
+      static bool EllipticCurveKeys;
+
       /**
        * Returns the ephemeral round key
        */
@@ -31,7 +31,8 @@ namespace Session {
         Registering,
         ListExchange,
         VerifyList,
-        Communicating
+        Communicating,
+        WaitingForRound
       };
 
       /** 
@@ -76,6 +77,14 @@ namespace Session {
         return Messaging::State::NoChange;
       }
 
+      /**
+       * The running round finished, only states that wait on the round move on
+       */
+      virtual ProcessResult HandleRoundFinished()
+      {
+        return Messaging::State::NoChange;
+      }
+
       virtual QString ToString() const { return SessionStates::StateTypeToString(GetState()); }
 
     protected:
@@ -139,6 +148,16 @@ namespace Session {
         }
       }
 
+      /**
+       * The running round finished
+       */
+      void HandleRoundFinished()
+      {
+        if(GetCurrentState()) {
+          ResultProcessor(GetCurrentState().dynamicCast<SessionState>()->HandleRoundFinished());
+        }
+      }
+
     private:
       virtual void Transitioning(qint8 from, qint8 to)
       {
@@ -60,5 +60,22 @@ namespace Tests {
     addr3 = TcpAddress("http://asdfasdf:2345");
     EXPECT_FALSE(addr3.Valid());
   }
+
+#ifdef __linux__
+  TEST(Address, Epoll) {
+    const Address addr0 = AddressFactory::GetInstance().CreateAddress("epoll://:1000");
+    const Address taddr = AddressFactory::GetInstance().CreateAddress("tcp://:1000");
+    const EpollAddress &eaddr0 = static_cast<const EpollAddress &>(addr0);
+    EXPECT_TRUE(eaddr0.Valid());
+    EXPECT_EQ(eaddr0.GetPort(), 1000);
+    EXPECT_EQ(eaddr0.GetType(), EpollAddress::Scheme);
+    EXPECT_NE(addr0, taddr);
+    EXPECT_EQ(AddressFactory::GetInstance().CreateAny(EpollAddress::Scheme).GetType(),
+        EpollAddress::Scheme);
+
+    Address addr1 = EpollAddress(QUrl("tcp://:1000"));
+    EXPECT_FALSE(addr1.Valid());
+  }
+#endif
 }
 }
@@ -0,0 +1,133 @@
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  namespace {
+    class VerifiedCollector : public BatchVerifier::Handler {
+      public:
+        virtual void HandleVerified(const Connections::Id &, const QByteArray &,
+            const QByteArray &msg, bool valid)
+        {
+          msgs.append(msg);
+          results.append(valid);
+        }
+
+        QList<QByteArray> msgs;
+        QList<bool> results;
+    };
+  }
+
+  TEST(BatchVerifier, Ordering)
+  {
+    QSharedPointer<AsymmetricKey> private_key(new DsaPrivateKey());
+    QSharedPointer<AsymmetricKey> public_key(private_key->GetPublicKey());
+
+    VerifiedCollector collector;
+    BatchVerifier verifier(&collector);
+
+    CryptoRandom rand;
+    QList<QByteArray> msgs;
+    QList<bool> expected;
+    int count = 50;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray msg(64, 0);
+      rand.GenerateBlock(msg);
+      QByteArray data = msg + private_key->Sign(msg);
+
+      bool valid = rand.GetInt(0, 4) != 0;
+      if(!valid) {
+        data[0] = data[0] ^ 0xff;
+      }
+
+      msgs.append(msg);
+      expected.append(valid);
+      verifier.Queue(Connections::Id(), public_key, data);
+    }
+
+    // A message too short to contain a signature
+    verifier.Queue(Connections::Id(), public_key, QByteArray(4, 0));
+    expected.append(false);
+
+    while(verifier.Pending()) {
+      MockExec();
+    }
+
+    ASSERT_EQ(count + 1, collector.results.count());
+    EXPECT_EQ(expected, collector.results);
+    for(int idx = 0; idx < count; idx++) {
+      if(expected[idx]) {
+        EXPECT_EQ(msgs[idx], collector.msgs[idx]);
+      }
+    }
+  }
+
+  TEST(BatchVerifier, InterleavedKeys)
+  {
+    QList<QSharedPointer<AsymmetricKey> > private_keys;
+    QList<QSharedPointer<AsymmetricKey> > public_keys;
+    for(int idx = 0; idx < 3; idx++) {
+      private_keys.append(QSharedPointer<AsymmetricKey>(new DsaPrivateKey()));
+      public_keys.append(private_keys.last()->GetPublicKey());
+    }
+
+    VerifiedCollector collector;
+    BatchVerifier verifier(&collector);
+
+    CryptoRandom rand;
+    QList<QByteArray> msgs;
+    int count = 30;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray msg(64, 0);
+      rand.GenerateBlock(msg);
+      int key = rand.GetInt(0, private_keys.count());
+      msgs.append(msg);
+      verifier.Queue(Connections::Id(), public_keys[key],
+          msg + private_keys[key]->Sign(msg));
+    }
+
+    while(verifier.Pending()) {
+      MockExec();
+    }
+
+    ASSERT_EQ(count, collector.results.count());
+    EXPECT_EQ(msgs, collector.msgs);
+    EXPECT_FALSE(collector.results.contains(false));
+  }
+
+  TEST(BatchVerifier, CallerSharesKey)
+  {
+    QSharedPointer<AsymmetricKey> private_key(new DsaPrivateKey());
+    QSharedPointer<AsymmetricKey> public_key(private_key->GetPublicKey());
+
+    VerifiedCollector collector;
+    BatchVerifier verifier(&collector);
+
+    CryptoRandom rand;
+    QList<QByteArray> msgs;
+    QList<QByteArray> signed_msgs;
+    int count = 30;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray msg(64, 0);
+      rand.GenerateBlock(msg);
+      msgs.append(msg);
+      signed_msgs.append(msg + private_key->Sign(msg));
+      verifier.Queue(Connections::Id(), public_key, signed_msgs.last());
+    }
+
+    // The workers use their own copy, so the caller may keep using the key
+    int idx = 0;
+    while(verifier.Pending()) {
+      QByteArray msg;
+      EXPECT_TRUE(BatchVerifier::Verify(public_key,
+            signed_msgs[idx % count], msg));
+      EXPECT_EQ(msgs[idx % count], msg);
+      idx++;
+      MockExec();
+    }
+
+    ASSERT_EQ(count, collector.results.count());
+    EXPECT_EQ(msgs, collector.msgs);
+    EXPECT_FALSE(collector.results.contains(false));
+  }
+}
+}
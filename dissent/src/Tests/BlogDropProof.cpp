@@ -204,6 +204,87 @@ namespace Tests {
     Utils::MultiThreading = tmp;
   }
 
+  void BatchVerifyOnce(QSharedPointer<const Parameters> params)
+  {
+    const int nservers = Random::GetInstance().GetInt(TEST_RANGE_MIN, TEST_RANGE_MAX);
+    const int nclients = Random::GetInstance().GetInt(TEST_RANGE_MIN, TEST_RANGE_MAX);
+    const int bad_idx = Random::GetInstance().GetInt(0, nclients);
+
+    QSharedPointer<Parameters> p(new Parameters(*params));
+
+    const QSharedPointer<const PrivateKey> author_priv(new PrivateKey(params));
+    const QSharedPointer<const PublicKey> author_pk(new PublicKey(author_priv));
+    const QSharedPointer<const PrivateKey> other_priv(new PrivateKey(params));
+    const QSharedPointer<const PublicKey> other_pk(new PublicKey(other_priv));
+
+    QList<QSharedPointer<const PublicKey> > server_pks;
+    for(int i=0; i<nservers; i++) {
+      QSharedPointer<const PrivateKey> priv(new PrivateKey(params));
+      server_pks.append(QSharedPointer<const PublicKey>(new PublicKey(priv)));
+    }
+    QSharedPointer<const PublicKeySet> server_pk_set(new PublicKeySet(params, server_pks));
+    QSharedPointer<const PrivateKey> server_sk(new PrivateKey(params));
+
+    QList<QByteArray> ctexts;
+    QList<QSharedPointer<const PublicKey> > client_pks;
+    for(int i=0; i<nclients; i++) {
+      // The bad client proves its ciphertext against the wrong author
+      QSharedPointer<const PrivateKey> priv(new PrivateKey(params));
+      BlogDropClient client(p, priv, server_pk_set,
+          (i == bad_idx) ? other_pk : author_pk);
+      ctexts.append(client.GenerateCoverCiphertext());
+      client_pks.append(QSharedPointer<const PublicKey>(new PublicKey(priv)));
+    }
+
+    BlogDropServer verified(p, server_sk, server_pk_set, author_pk);
+    QSet<int> bad_clients;
+    EXPECT_FALSE(verified.AddClientCiphertexts(ctexts, client_pks, true, bad_clients));
+    EXPECT_EQ(QSet<int>() << bad_idx, bad_clients);
+
+    BlogDropServer unverified(p, server_sk, server_pk_set, author_pk);
+    bad_clients.clear();
+    EXPECT_TRUE(unverified.AddClientCiphertexts(ctexts, client_pks, false, bad_clients));
+    EXPECT_EQ(QSet<int>() << bad_idx, unverified.FindBadClients());
+
+    // Bad clients are indexed within the list just added, not the bin
+    QList<QByteArray> good_ctexts = ctexts;
+    QList<QSharedPointer<const PublicKey> > good_pks = client_pks;
+    QByteArray bad_ctext = good_ctexts.takeAt(bad_idx);
+    QSharedPointer<const PublicKey> bad_pk = good_pks.takeAt(bad_idx);
+
+    BlogDropServer incremental(p, server_sk, server_pk_set, author_pk);
+    bad_clients.clear();
+    EXPECT_TRUE(incremental.AddClientCiphertexts(good_ctexts, good_pks, true, bad_clients));
+    EXPECT_TRUE(bad_clients.isEmpty());
+    EXPECT_FALSE(incremental.AddClientCiphertexts(QList<QByteArray>() << bad_ctext,
+          QList<QSharedPointer<const PublicKey> >() << bad_pk, true, bad_clients));
+    EXPECT_EQ(QSet<int>() << 0, bad_clients);
+  }
+
+  TEST_P(BlogDropProofTest, IntegerElGamalBatchVerify)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = GetParam();
+    BatchVerifyOnce(Parameters::Parameters::IntegerElGamalTesting());
+    Utils::MultiThreading = tmp;
+  }
+
+  TEST_P(BlogDropProofTest, IntegerHashingBatchVerify)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = GetParam();
+    BatchVerifyOnce(Parameters::Parameters::IntegerHashingTesting());
+    Utils::MultiThreading = tmp;
+  }
+
+  TEST_P(BlogDropProofTest, CppECHashingBatchVerify)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = GetParam();
+    BatchVerifyOnce(Parameters::Parameters::CppECHashingProduction());
+    Utils::MultiThreading = tmp;
+  }
+
   void ElGamalEndToEndOnce(QSharedPointer<const Parameters> params, bool random = true)
   {
     int nservers; 
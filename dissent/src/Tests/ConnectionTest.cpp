@@ -3,6 +3,42 @@
 
 namespace Dissent {
 namespace Tests {
+  namespace {
+    /**
+     * An edge whose congestion is controlled by the test
+     */
+    class CongestibleEdge : public Edge {
+      public:
+        CongestibleEdge() :
+          Edge(BufferAddress(1), BufferAddress(2), true),
+          congested(false),
+          queued(0)
+        {
+        }
+
+        virtual void Send(const QByteArray &data)
+        {
+          sent.append(data);
+          queued += data.size();
+        }
+
+        virtual qint64 GetBytesQueued() const { return queued; }
+
+        virtual bool Congested() const { return congested; }
+
+        void Drain()
+        {
+          congested = false;
+          queued = 0;
+          emit WriteQueueDrained();
+        }
+
+        QList<QByteArray> sent;
+        bool congested;
+        qint64 queued;
+    };
+  }
+
   TEST(Connection, SingleConnect)
   {
     ConnectionManager::UseTimer = false;
@@ -398,5 +434,49 @@ namespace Tests {
       next = Timer::GetInstance().VirtualRun();
     }
   }
+
+  TEST(Connection, Congestion)
+  {
+    QSharedPointer<CongestibleEdge> edge(new CongestibleEdge());
+    edge->SetSharedPointer(edge);
+    Connection con(edge, Id(), Id());
+
+    QByteArray data(1024, 'a');
+    con.Send(data);
+    EXPECT_EQ(1, edge->sent.count());
+    EXPECT_FALSE(con.Congested());
+
+    // Held back while the edge is congested
+    edge->congested = true;
+    con.Send(data);
+    con.Send(data);
+    EXPECT_EQ(1, edge->sent.count());
+    EXPECT_TRUE(con.Congested());
+    EXPECT_EQ(2 * data.size(), con.GetBytesHeld());
+
+    // Released in order once the edge drains
+    edge->sent.clear();
+    data[0] = 'b';
+    con.Send(data);
+    edge->Drain();
+    ASSERT_EQ(3, edge->sent.count());
+    EXPECT_EQ('a', edge->sent[0][0]);
+    EXPECT_EQ('b', edge->sent[2][0]);
+    EXPECT_FALSE(con.Congested());
+    EXPECT_EQ(0, con.GetBytesHeld());
+
+    // Sends pass straight through after draining
+    con.Send(data);
+    EXPECT_EQ(4, edge->sent.count());
+
+    // A peer that stops reading is dropped
+    edge->congested = true;
+    edge->queued = Connection::MaximumBacklog - data.size();
+    con.Send(data);
+    EXPECT_FALSE(edge->Stopped());
+    con.Send(data);
+    EXPECT_TRUE(edge->Stopped());
+    EXPECT_EQ(0, con.GetBytesHeld());
+  }
 }
 }
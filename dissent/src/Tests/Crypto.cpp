@@ -319,6 +319,16 @@ namespace Tests {
     AsymmetricKeySerialization<DsaPrivateKey, DsaPublicKey>();
   }
 
+  TEST(Crypto, EcdsaKey)
+  {
+    AsymmetricKeyTest<EcdsaPrivateKey, EcdsaPublicKey>();
+  }
+
+  TEST(Crypto, EcdsaKeySerialization)
+  {
+    AsymmetricKeySerialization<EcdsaPrivateKey, EcdsaPublicKey>();
+  }
+
   TEST(Crypto, DiffieHellman)
   {
     DiffieHellman dh0, dh1, dh2;
@@ -350,5 +360,73 @@ namespace Tests {
         dh0.GetPublicComponent(), dh1.GetPublicComponent(), proof_0_1);
     EXPECT_EQ(shared_0_1, verif_2);
   }
+
+  TEST(Crypto, EcDiffieHellman)
+  {
+    DiffieHellman dh0(QByteArray(), true, DiffieHellman::ELLIPTIC_CURVE);
+    DiffieHellman dh1(QByteArray(), true, DiffieHellman::ELLIPTIC_CURVE);
+    DiffieHellman dh2(QByteArray(), true, DiffieHellman::ELLIPTIC_CURVE);
+    DiffieHellman mod_dh;
+    EXPECT_EQ(dh0.GetKeyType(), DiffieHellman::ELLIPTIC_CURVE);
+    EXPECT_EQ(mod_dh.GetKeyType(), DiffieHellman::MODULAR);
+
+    QByteArray shared_0_1 = dh0.GetSharedSecret(dh1.GetPublicComponent());
+    QByteArray shared_1_0 = dh1.GetSharedSecret(dh0.GetPublicComponent());
+    QByteArray shared_0_2 = dh0.GetSharedSecret(dh2.GetPublicComponent());
+    EXPECT_FALSE(shared_0_1.isEmpty());
+    EXPECT_EQ(shared_0_1, shared_1_0);
+    EXPECT_NE(shared_0_1, shared_0_2);
+    EXPECT_TRUE(dh0.GetSharedSecret(mod_dh.GetPublicComponent()).isEmpty());
+    EXPECT_TRUE(mod_dh.GetSharedSecret(dh0.GetPublicComponent()).isEmpty());
+    EXPECT_EQ(DiffieHellman::GetKeyType(dh0.GetPublicComponent()),
+        DiffieHellman::ELLIPTIC_CURVE);
+    EXPECT_EQ(DiffieHellman::GetKeyType(mod_dh.GetPublicComponent()),
+        DiffieHellman::MODULAR);
+    // Untagged components are rejected
+    EXPECT_TRUE(dh0.GetSharedSecret(dh1.GetPublicComponent().mid(1)).isEmpty());
+
+    DiffieHellman dh0_0(dh0.GetPrivateComponent(), false,
+        DiffieHellman::ELLIPTIC_CURVE);
+    EXPECT_EQ(dh0.GetPublicComponent(), dh0_0.GetPublicComponent());
+    EXPECT_EQ(dh0.GetPrivateComponent(), dh0_0.GetPrivateComponent());
+
+    Id id;
+    DiffieHellman dh3_0(id.GetByteArray(), true, DiffieHellman::ELLIPTIC_CURVE);
+    DiffieHellman dh3_1(id.GetByteArray(), true, DiffieHellman::ELLIPTIC_CURVE);
+    EXPECT_EQ(dh3_0.GetPublicComponent(), dh3_1.GetPublicComponent());
+
+    QByteArray proof_0_1 = dh0.ProveSharedSecret(dh1.GetPublicComponent());
+    EXPECT_EQ(shared_0_1, DiffieHellman::VerifySharedSecret(
+          dh0.GetPublicComponent(), dh1.GetPublicComponent(), proof_0_1));
+    EXPECT_TRUE(DiffieHellman::VerifySharedSecret(dh0.GetPublicComponent(),
+          dh2.GetPublicComponent(), proof_0_1).isEmpty());
+
+    QVector<QByteArray> remote_pubs;
+    remote_pubs << dh1.GetPublicComponent() << dh2.GetPublicComponent();
+    QVector<QByteArray> expected;
+    expected << shared_0_1 << shared_0_2;
+    EXPECT_EQ(expected, dh0.GetSharedSecrets(remote_pubs));
+  }
+
+  TEST(Crypto, DiffieHellmanBatch)
+  {
+    DiffieHellman local;
+    QVector<QByteArray> remote_pubs;
+    QVector<QByteArray> expected;
+    for(int idx = 0; idx < 10; idx++) {
+      DiffieHellman remote;
+      remote_pubs.append(remote.GetPublicComponent());
+      expected.append(remote.GetSharedSecret(local.GetPublicComponent()));
+    }
+    remote_pubs.append(QByteArray());
+    expected.append(QByteArray());
+
+    bool multithreading = Utils::MultiThreading;
+    Utils::MultiThreading = false;
+    EXPECT_EQ(expected, local.GetSharedSecrets(remote_pubs));
+    Utils::MultiThreading = true;
+    EXPECT_EQ(expected, local.GetSharedSecrets(remote_pubs));
+    Utils::MultiThreading = multithreading;
+  }
 }
 }
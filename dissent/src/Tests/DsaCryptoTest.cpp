@@ -255,5 +255,67 @@ namespace Tests {
       EXPECT_TRUE(x.contains(val));
     }
   }
+
+  TEST(Crypto, NeffShuffleWorkers)
+  {
+    int values = 20;
+    int keys = 3;
+
+    DsaPrivateKey base_key;
+    Integer generator = base_key.GetGenerator();
+    Integer subgroup = base_key.GetSubgroupOrder();
+    Integer modulus = base_key.GetModulus();
+
+    QVector<DsaPrivateKey> private_keys;
+    QVector<DsaPublicKey> public_keys;
+
+    for(int idx = 0; idx < keys; idx++) {
+      private_keys.append(DsaPrivateKey(modulus, subgroup, generator));
+      public_keys.append(DsaPublicKey(modulus, subgroup, generator,
+            private_keys.last().GetPublicElement()));
+    }
+
+    CryptoRandom rand;
+    QVector<QByteArray> input;
+    for(int idx = 0; idx < values; idx++) {
+      Integer tmp_val = rand.GetInteger(0, subgroup);
+      input.append(DsaPublicKey::SeriesEncrypt(public_keys,
+            generator.Pow(tmp_val, modulus).GetByteArray()));
+    }
+
+    bool multithreading = Utils::MultiThreading;
+    int workers = NeffShuffle::Workers;
+    Utils::MultiThreading = true;
+
+    NeffShuffle shuffle;
+    QVector<DsaPublicKey> npub_keys = public_keys;
+    npub_keys.pop_front();
+
+    // Proofs generated with any number of workers verify with any other
+    NeffShuffle::Workers = 4;
+    QVector<QByteArray> output, serial_output, parallel_output;
+    QByteArray proof;
+    EXPECT_TRUE(shuffle.Shuffle(input, private_keys[0], npub_keys, output, proof));
+
+    NeffShuffle::Workers = 1;
+    EXPECT_TRUE(shuffle.Verify(input, public_keys, proof, serial_output));
+    EXPECT_EQ(output, serial_output);
+
+    EXPECT_TRUE(shuffle.Shuffle(input, private_keys[0], npub_keys, output, proof));
+    NeffShuffle::Workers = 3;
+    EXPECT_TRUE(shuffle.Verify(input, public_keys, proof, parallel_output));
+    EXPECT_EQ(output, parallel_output);
+
+    // A proof over different input fails regardless of the number of workers
+    QVector<QByteArray> other_input = input;
+    other_input[0] = DsaPublicKey::SeriesEncrypt(public_keys,
+        generator.Pow(rand.GetInteger(0, subgroup), modulus).GetByteArray());
+    EXPECT_FALSE(shuffle.Verify(other_input, public_keys, proof, parallel_output));
+    NeffShuffle::Workers = 1;
+    EXPECT_FALSE(shuffle.Verify(other_input, public_keys, proof, serial_output));
+
+    NeffShuffle::Workers = workers;
+    Utils::MultiThreading = multithreading;
+  }
 }
 }
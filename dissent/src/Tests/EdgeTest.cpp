@@ -1,3 +1,6 @@
+#include <string.h>
+#include <zlib.h>
+
 #include "DissentTest.hpp"
 #include <QDebug>
 
@@ -111,6 +114,189 @@ namespace Tests {
     EXPECT_EQ(sc.GetCount(), 1);
   }
 
+  TEST(EdgeTest, BufferCompression)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    int level = Edge::CompressionLevel;
+    Edge::CompressionLevel = 6;
+
+    const BufferAddress addr0(1000);
+    BufferEdgeListener be0(addr0);
+    MockEdgeHandler meh0(&be0);
+    be0.Start();
+
+    const BufferAddress addr1(10001);
+    BufferEdgeListener be1(addr1);
+    MockEdgeHandler meh1(&be1);
+    be1.Start();
+
+    be1.CreateEdgeTo(addr0);
+    RunUntil();
+    ASSERT_FALSE(meh0.edge.isNull());
+    ASSERT_FALSE(meh1.edge.isNull());
+
+    meh0.edge->SetCompression(true);
+    meh1.edge->SetCompression(true);
+
+    BufferSink sink0;
+    meh0.edge->SetSink(&sink0);
+
+    QList<QByteArray> msgs;
+    msgs.append(QByteArray(64 * 1024, 0));
+    msgs.append(QByteArray(Edge::CompressionThreshold - 1, 'a'));
+    msgs.append(QByteArray());
+    QByteArray random(8 * 1024, 0);
+    CryptoRandom().GenerateBlock(random);
+    // Like an Rpc frame, never mistaken for a compressed one
+    random[0] = 0;
+    // Sent uncompressed once the edge measures that it does not compress
+    for(int idx = 0; idx < 20; idx++) {
+      msgs.append(random);
+    }
+    msgs.append(QByteArray(4096, 'b'));
+
+    foreach(const QByteArray &msg, msgs) {
+      meh1.edge->Send(msg);
+    }
+    RunUntil();
+
+    ASSERT_EQ(msgs.count(), sink0.Count());
+    for(int idx = 0; idx < msgs.count(); idx++) {
+      EXPECT_EQ(msgs[idx], sink0.At(idx).second);
+    }
+
+    Edge::CompressionLevel = level;
+  }
+
+  TEST(EdgeTest, BufferCompressionMalformed)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    int level = Edge::CompressionLevel;
+    Edge::CompressionLevel = 6;
+
+    const BufferAddress addr0(1000);
+    BufferEdgeListener be0(addr0);
+    MockEdgeHandler meh0(&be0);
+    be0.Start();
+
+    const BufferAddress addr1(10001);
+    BufferEdgeListener be1(addr1);
+    MockEdgeHandler meh1(&be1);
+    be1.Start();
+
+    be1.CreateEdgeTo(addr0);
+    RunUntil();
+    ASSERT_FALSE(meh0.edge.isNull());
+    ASSERT_FALSE(meh1.edge.isNull());
+
+    BufferSink sink0;
+    meh0.edge->SetSink(&sink0);
+
+    // The sender does not compress, so these frames arrive as written
+    QByteArray msg(64 * 1024, 'a');
+    QByteArray frame(1, Edge::CompressedMagic);
+    frame.append(qCompress(msg, 6));
+
+    // Not negotiated by the receiver
+    meh1.edge->Send(frame);
+    RunUntil();
+    EXPECT_EQ(0, sink0.Count());
+
+    meh0.edge->SetCompression(true);
+
+    // Declares more than the limit
+    QByteArray huge = frame;
+    Serialization::WriteInt(Edge::MaximumDecompressedSize + 1, huge, 1);
+    meh1.edge->Send(huge);
+
+    // Declares less than it inflates to
+    QByteArray bomb = frame;
+    Serialization::WriteInt(1024, bomb, 1);
+    meh1.edge->Send(bomb);
+
+    // Declares more than it inflates to
+    QByteArray short_frame = frame;
+    Serialization::WriteInt(msg.size() + 1, short_frame, 1);
+    meh1.edge->Send(short_frame);
+
+    meh1.edge->Send(frame.left(frame.size() / 2));
+
+    // Deflated with a dictionary other than the Rpc framing dictionary
+    QByteArray other_dict(64, 'z');
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    ASSERT_EQ(Z_OK, deflateInit(&stream, 6));
+    deflateSetDictionary(&stream,
+        reinterpret_cast<const Bytef *>(other_dict.constData()), other_dict.size());
+    QByteArray foreign(5 + deflateBound(&stream, msg.size()), 0);
+    foreign[0] = Edge::CompressedMagic;
+    Serialization::WriteInt(msg.size(), foreign, 1);
+    stream.next_in = reinterpret_cast<Bytef *>(msg.data());
+    stream.avail_in = msg.size();
+    stream.next_out = reinterpret_cast<Bytef *>(foreign.data() + 5);
+    stream.avail_out = foreign.size() - 5;
+    ASSERT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+    foreign.resize(foreign.size() - stream.avail_out);
+    deflateEnd(&stream);
+    meh1.edge->Send(foreign);
+    RunUntil();
+    EXPECT_EQ(0, sink0.Count());
+
+    meh1.edge->Send(frame);
+    RunUntil();
+    ASSERT_EQ(1, sink0.Count());
+    EXPECT_EQ(msg, sink0.At(0).second);
+
+    Edge::CompressionLevel = level;
+  }
+
+  TEST(EdgeTest, FrameParser)
+  {
+    QList<QByteArray> msgs;
+    msgs.append(QByteArray(100, 'a'));
+    msgs.append(QByteArray());
+    msgs.append(QByteArray(70 * 1024, 'b'));
+
+    QByteArray stream;
+    foreach(const QByteArray &msg, msgs) {
+      QByteArray header(4, 0);
+      Serialization::WriteInt(msg.size(), header, 0);
+      stream += header + msg + QByteArray(4, 0);
+    }
+
+    // Any split of the stream yields the same frames
+    QList<int> pieces;
+    pieces << 1 << 3 << 7 << 4096 << stream.size();
+    foreach(int piece, pieces) {
+      FrameParser parser;
+      QList<QByteArray> frames;
+      for(int offset = 0; offset < stream.size(); offset += piece) {
+        int count = qMin(piece, stream.size() - offset);
+        ASSERT_TRUE(parser.Parse(stream.constData() + offset, count, frames));
+      }
+      EXPECT_EQ(msgs, frames);
+      EXPECT_EQ(4, parser.GetWanted());
+    }
+
+    // Read directly into the parser, short reads included
+    FrameParser parser;
+    QList<QByteArray> frames;
+    int offset = 0;
+    while(offset < stream.size()) {
+      int count = qMin(parser.GetWanted(), stream.size() - offset);
+      char *buffer = parser.Reserve(count);
+      count = qMax(1, count / 2);
+      memcpy(buffer, stream.constData() + offset, count);
+      ASSERT_TRUE(parser.Advance(count, frames));
+      offset += count;
+    }
+    EXPECT_EQ(msgs, frames);
+
+    QByteArray bad(4, 0);
+    Serialization::WriteInt(-1, bad, 0);
+    EXPECT_FALSE(FrameParser().Parse(bad.constData(), bad.size(), frames));
+  }
+
   TEST(EdgeTest, TcpFail)
   {
     Timer::GetInstance().UseRealTime();
@@ -146,5 +332,147 @@ namespace Tests {
     MockExecLoop(sc);
     EXPECT_EQ(sc.GetCount(), 1);
   }
+
+  TEST(EdgeTest, TcpThreaded)
+  {
+    Timer::GetInstance().UseRealTime();
+    int io_threads = IoThreads::Count;
+    IoThreads::Count = 2;
+
+    const TcpAddress addr0("127.0.0.1", 33348);
+    TcpEdgeListener te0(addr0);
+    MockEdgeHandler meh0(&te0);
+    te0.Start();
+
+    const TcpAddress addr1("127.0.0.1", 33349);
+    TcpEdgeListener te1(addr1);
+    MockEdgeHandler meh1(&te1);
+    te1.Start();
+
+    SignalCounter edges(2);
+    QObject::connect(&te0, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    QObject::connect(&te1, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+
+    te1.CreateEdgeTo(addr0);
+    MockExecLoop(edges);
+
+    BufferSink sink0, sink1;
+    meh0.edge->SetSink(&sink0);
+    meh1.edge->SetSink(&sink1);
+
+    // Large enough messages that frames arrive in pieces
+    const int count = 50;
+    SignalCounter received(2 * count);
+    QObject::connect(&sink0, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+    QObject::connect(&sink1, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+    QList<QByteArray> msgs;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray msg(idx * 4096 + 1, char(idx));
+      msgs.append(msg);
+      meh0.edge->Send(msg);
+      meh1.edge->Send(msg);
+    }
+
+    MockExecLoop(received);
+
+    ASSERT_EQ(count, sink0.Count());
+    ASSERT_EQ(count, sink1.Count());
+    for(int idx = 0; idx < count; idx++) {
+      EXPECT_EQ(msgs[idx], sink0.At(idx).second);
+      EXPECT_EQ(msgs[idx], sink1.At(idx).second);
+    }
+
+    SignalCounter stopped(2);
+    QObject::connect(meh0.edge.data(), SIGNAL(StoppedSignal()),
+        &stopped, SLOT(Counter()));
+    QObject::connect(meh1.edge.data(), SIGNAL(StoppedSignal()),
+        &stopped, SLOT(Counter()));
+    meh1.edge->Stop("Done");
+    MockExecLoop(stopped);
+
+    te0.Stop();
+    te1.Stop();
+
+    // Later tests must not inherit these threads or their sockets
+    IoThreads::Stop();
+    IoThreads::Count = io_threads;
+  }
+
+#ifdef __linux__
+  TEST(EdgeTest, EpollBasic)
+  {
+    Timer::GetInstance().UseRealTime();
+
+    const EpollAddress addr0("127.0.0.1", 33350);
+    EpollEdgeListener ee0(addr0);
+    MockEdgeHandler meh0(&ee0);
+    ee0.Start();
+
+    const EpollAddress addr1("127.0.0.1", 33351);
+    EpollEdgeListener ee1(addr1);
+    MockEdgeHandler meh1(&ee1);
+    ee1.Start();
+
+    SignalCounter edges(2);
+    QObject::connect(&ee0, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    QObject::connect(&ee1, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+
+    ee1.CreateEdgeTo(addr0);
+    MockExecLoop(edges);
+    ASSERT_EQ(edges.GetCount(), 2);
+    EXPECT_EQ(meh0.edge->GetRemoteAddress().GetType(), EpollAddress::Scheme);
+
+    BufferSink sink0, sink1;
+    meh0.edge->SetSink(&sink0);
+    meh1.edge->SetSink(&sink1);
+
+    // Larger than the receive buffer, so frames span many reads
+    const int count = 50;
+    SignalCounter received(2 * count);
+    QObject::connect(&sink0, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+    QObject::connect(&sink1, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+    QList<QByteArray> msgs;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray msg(idx * 4096 + 1, char(idx));
+      msgs.append(msg);
+      meh0.edge->Send(msg);
+      meh1.edge->Send(msg);
+    }
+
+    MockExecLoop(received);
+
+    ASSERT_EQ(count, sink0.Count());
+    ASSERT_EQ(count, sink1.Count());
+    for(int idx = 0; idx < count; idx++) {
+      EXPECT_EQ(msgs[idx], sink0.At(idx).second);
+      EXPECT_EQ(msgs[idx], sink1.At(idx).second);
+    }
+
+    SignalCounter stopped(2);
+    QObject::connect(meh0.edge.data(), SIGNAL(StoppedSignal()),
+        &stopped, SLOT(Counter()));
+    QObject::connect(meh1.edge.data(), SIGNAL(StoppedSignal()),
+        &stopped, SLOT(Counter()));
+    meh1.edge->Stop("Done");
+    MockExecLoop(stopped);
+    EXPECT_EQ(stopped.GetCount(), 2);
+
+    SignalCounter failed(1);
+    QObject::connect(&ee1, SIGNAL(EdgeCreationFailure(const Address &, const QString &)),
+        &failed, SLOT(Counter()));
+    ee1.CreateEdgeTo(EpollAddress("127.0.0.1", 33352));
+    MockExecLoop(failed);
+    EXPECT_EQ(failed.GetCount(), 1);
+
+    ee0.Stop();
+    ee1.Stop();
+  }
+#endif
 }
 }
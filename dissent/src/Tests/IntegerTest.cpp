@@ -69,6 +69,143 @@ namespace Tests {
     EXPECT_EQ(Integer(0), base.Pow(Integer(10), Integer(100)));
   }
 
+  TEST(Integer, FixedBase)
+  {
+    QSharedPointer<IntegerGroup> group =
+      IntegerGroup::GetGroup(IntegerGroup::TESTING_512);
+    Integer modulus = group->GetModulus();
+    Integer base = IntegerElementData::GetInteger(
+        group->RandomElement().GetData());
+
+    FixedBase fixed(base, modulus);
+    EXPECT_FALSE(fixed.IsNull());
+    EXPECT_TRUE(FixedBase().IsNull());
+
+    CryptoRandom rand;
+    for(int idx = 0; idx < 20; idx++) {
+      Integer exp = rand.GetInteger(0, group->GetOrder());
+      EXPECT_EQ(base.Pow(exp, modulus), fixed.Pow(exp));
+    }
+
+    // Exponents outside of the table's range
+    EXPECT_EQ(Integer(1), fixed.Pow(Integer(0)));
+    Integer large = modulus * modulus + 7;
+    EXPECT_EQ(base.Pow(large, modulus), fixed.Pow(large));
+
+    // Even moduli are not tabulated, but still exponentiate
+    FixedBase even(Integer(3), Integer(1000));
+    EXPECT_EQ(Integer(3).Pow(Integer(20), Integer(1000)), even.Pow(Integer(20)));
+
+    FixedBase cached = FixedBase::Get(base, modulus);
+    Integer exp = rand.GetInteger(0, group->GetOrder());
+    EXPECT_EQ(base.Pow(exp, modulus), cached.Pow(exp));
+    EXPECT_EQ(base.Pow(exp, modulus), FixedBase::Get(base, modulus).Pow(exp));
+
+    Element element = group->RandomElement();
+    EXPECT_TRUE(group->Exponentiate(element, exp) ==
+        group->ExponentiateFixedBase(element, exp));
+
+    // Generators are cached apart from other bases
+    Integer generator = IntegerElementData::GetInteger(
+        group->GetGenerator().GetData());
+    EXPECT_EQ(generator.Pow(exp, modulus),
+        FixedBase::GetGenerator(generator, modulus).Pow(exp));
+    EXPECT_TRUE(group->Exponentiate(group->GetGenerator(), exp) ==
+        group->ExponentiateFixedBase(group->GetGenerator(), exp));
+  }
+
+  TEST(Integer, MultiPow)
+  {
+    QSharedPointer<IntegerGroup> group =
+      IntegerGroup::GetGroup(IntegerGroup::TESTING_512);
+    Integer modulus = group->GetModulus();
+    CryptoRandom rand;
+
+    // Straus below the threshold, Pippenger above it
+    QList<int> counts;
+    counts << 1 << 2 << 17 << MultiExponentiation::PippengerThreshold + 3;
+    foreach(int count, counts) {
+      QVector<Integer> bases, exps;
+      Integer expected = 1;
+      for(int idx = 0; idx < count; idx++) {
+        bases.append(IntegerElementData::GetInteger(
+              group->RandomElement().GetData()));
+        exps.append(rand.GetInteger(0, group->GetOrder()));
+        expected = (expected * bases[idx].Pow(exps[idx], modulus)) % modulus;
+      }
+      EXPECT_EQ(expected, Integer::MultiPow(bases, exps, modulus));
+    }
+
+    QVector<Integer> bases, exps;
+    bases << Integer(3) << Integer(5) << Integer(7);
+    exps << Integer(0) << Integer(-2) << Integer(20);
+    Integer expected = (Integer(5).Pow(Integer(2), modulus).Inverse(modulus) *
+        Integer(7).Pow(Integer(20), modulus)) % modulus;
+    EXPECT_EQ(expected, Integer::MultiPow(bases, exps, modulus));
+
+    // Even moduli take the non-Montgomery path
+    EXPECT_EQ(Integer(3).Pow(Integer(20), Integer(1000)),
+        Integer::MultiPow(bases.mid(0, 1), exps.mid(2, 1), Integer(1000)));
+  }
+
+  namespace {
+    typedef Dissent::Crypto::AbstractGroup::AbstractGroup Group;
+
+    void TestMultiExponentiate(const QSharedPointer<Group> &group)
+    {
+      QList<int> counts;
+      counts << 0 << 1 << 2 << 9 << MultiExponentiation::PippengerThreshold + 3;
+      foreach(int count, counts) {
+        QVector<Element> bases;
+        QVector<Integer> exps;
+        Element expected = group->GetIdentity();
+        for(int idx = 0; idx < count; idx++) {
+          Element base = group->RandomElement();
+          Integer exp = group->RandomExponent();
+          Element term = group->Exponentiate(base, exp);
+
+          // Negative, zero and repeated terms
+          if(idx % 5 == 1) {
+            term = group->Inverse(term);
+            exp = Integer(0) - exp;
+          } else if(idx % 5 == 2) {
+            term = group->GetIdentity();
+            exp = 0;
+          } else if(idx % 5 == 3) {
+            base = bases[idx - 3];
+            term = group->Exponentiate(base, exp);
+          }
+
+          bases.append(base);
+          exps.append(exp);
+          expected = group->Multiply(expected, term);
+        }
+        EXPECT_TRUE(expected == group->MultiExponentiate(bases, exps));
+        // The generic implementation
+        EXPECT_TRUE(expected == group->Group::MultiExponentiate(bases, exps));
+      }
+
+      Element a = group->RandomElement();
+      Element b = group->RandomElement();
+      Integer c = group->RandomExponent();
+      EXPECT_TRUE(group->Multiply(group->Exponentiate(a, c), group->Exponentiate(b, c)) ==
+          group->CascadeExponentiate(a, c, b, c));
+
+      // Terms that cancel out
+      QVector<Element> bases;
+      bases << a << a;
+      QVector<Integer> exps;
+      exps << c << Integer(0) - c;
+      EXPECT_TRUE(group->IsIdentity(group->MultiExponentiate(bases, exps)));
+    }
+  }
+
+  TEST(Integer, MultiExponentiate)
+  {
+    TestMultiExponentiate(IntegerGroup::GetGroup(IntegerGroup::TESTING_512));
+    TestMultiExponentiate(CppECGroup::GetGroup(ECParams::NIST_P256));
+  }
+
   TEST(Integer, Int32)
   {
     Integer test(5);
@@ -12,7 +12,8 @@ namespace Tests {
   class MockSender : public ISender {
     public:
       explicit MockSender(const QSharedPointer<MockSource> &source) :
-        _source(source)
+        _source(source),
+        _wire_version(0)
       {
       }
 
@@ -22,6 +23,7 @@ namespace Tests {
 
       virtual void Send(const QByteArray &data)
       {
+        _last_sent = data;
         _source->IncomingData(_from.toStrongRef(), data);
       }
 
@@ -30,9 +32,17 @@ namespace Tests {
         _from = sender.toWeakRef();
       }
 
+      virtual int GetWireVersion() const { return _wire_version; }
+
+      void SetWireVersion(int version) { _wire_version = version; }
+
+      QByteArray GetLastSent() const { return _last_sent; }
+
     private:
       QSharedPointer<MockSource> _source;
       QWeakPointer<ISender> _from;
+      int _wire_version;
+      QByteArray _last_sent;
   };
 }
 }
@@ -116,14 +116,16 @@ namespace Tests {
     Q_OBJECT
 
     public:
-      Holder(const OverlayPointer &node) : m_node(node)
+      Holder(const OverlayPointer &node, const QString &method = "MSGHNDL") :
+        m_node(node),
+        m_method(method)
       {
-        node->GetRpcHandler()->Register("MSGHNDL", this, "MessageHandle");
+        node->GetRpcHandler()->Register(m_method, this, "MessageHandle");
       }
 
       ~Holder()
       {
-        m_node->GetRpcHandler()->Unregister("MSGHNDL");
+        m_node->GetRpcHandler()->Unregister(m_method);
       }
 
       QList<Request> GetRequests() const
@@ -134,6 +136,7 @@ namespace Tests {
     private:
       QList<Request> m_requests;
       OverlayPointer m_node;
+      QString m_method;
 
     private slots:
       void MessageHandle(const Request &notification)
@@ -144,14 +147,15 @@ namespace Tests {
 
   class MessageHolder {
     public:
-      MessageHolder(const OverlayNetwork &network)
+      MessageHolder(const OverlayNetwork &network,
+          const QString &method = "MSGHNDL")
       {
         foreach(const OverlayPointer &node, network.first) {
-          m_holders[node->GetId()] = QSharedPointer<Holder>(new Holder(node));
+          m_holders[node->GetId()] = QSharedPointer<Holder>(new Holder(node, method));
         }
 
         foreach(const OverlayPointer &node, network.second) {
-          m_holders[node->GetId()] = QSharedPointer<Holder>(new Holder(node));
+          m_holders[node->GetId()] = QSharedPointer<Holder>(new Holder(node, method));
         }
       }
 
@@ -252,6 +256,68 @@ namespace Tests {
     }
   }
 
+  void SetRelayKeys(const OverlayNetwork &network)
+  {
+    DsaPrivateKey shared_key;
+    QSharedPointer<KeyShare> keys(new KeyShare());
+
+    foreach(const OverlayPointer &server, network.first) {
+      QSharedPointer<AsymmetricKey> key(new DsaPrivateKey(
+            shared_key.GetModulus(), shared_key.GetSubgroupOrder(),
+            shared_key.GetGenerator()));
+      keys->AddKey(server->GetId().ToString(), key->GetPublicKey());
+      server->SetRelayKeys(key, keys);
+    }
+
+    foreach(const OverlayPointer &client, network.second) {
+      client->SetRelayKeys(QSharedPointer<AsymmetricKey>(), keys);
+    }
+  }
+
+  void RelayTest(const OverlayNetwork &network,
+      const QSharedPointer<MessageHolder> &messages)
+  {
+    // The first broadcast relays through the servers while the relays
+    // connect to their children, the second goes directly
+    for(int round = 0; round < 2; round++) {
+      for(int idx = 0; idx < network.first.count(); idx++) {
+        const OverlayPointer &server = network.first[idx];
+        QByteArray data = (server->GetId().ToString() +
+            QString::number(round)).toUtf8();
+        server->BroadcastToClients(Overlay::RelayMethod, data);
+        RunUntil();
+
+        for(int cidx = idx; cidx < network.second.count();
+            cidx += network.first.count())
+        {
+          const OverlayPointer &client = network.second[cidx];
+          ASSERT_TRUE(messages->GetRequests(client->GetId()).count() > 0);
+          Request req = messages->GetRequests(client->GetId()).last();
+          EXPECT_EQ(req.GetData().toByteArray(), data);
+
+          QSharedPointer<IOverlaySender> from =
+            req.GetFrom().dynamicCast<IOverlaySender>();
+          ASSERT_TRUE(from);
+          EXPECT_EQ(from->GetRemoteId(), server->GetId());
+        }
+      }
+    }
+
+    int relay_connections = 0;
+    foreach(const OverlayPointer &client, network.second) {
+      foreach(const QSharedPointer<Connection> &con,
+          client->GetConnectionTable().GetConnections())
+      {
+        if(!client->IsServer(con->GetRemoteId()) &&
+            con->GetRemoteId() != client->GetId())
+        {
+          relay_connections++;
+        }
+      }
+    }
+    EXPECT_TRUE(relay_connections > 0);
+  }
+
   TEST(Overlay, Servers)
   {
     Timer::GetInstance().UseVirtualTime();
@@ -299,6 +365,133 @@ namespace Tests {
     VerifyStoppedNetwork(net);
     ConnectionManager::UseTimer = true;
   }
+
+  TEST(Overlay, ClientsServersRelay)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    int fanout = Overlay::RelayFanout;
+    Overlay::RelayFanout = 3;
+    OverlayNetwork net = ConstructOverlay(4, 40);
+    StartNetwork(net);
+    VerifyNetwork(net);
+    SetRelayKeys(net);
+    QSharedPointer<MessageHolder> relayed(new MessageHolder(net,
+          Overlay::RelayMethod));
+    RelayTest(net, relayed);
+    QSharedPointer<MessageHolder> messages(new MessageHolder(net));
+    BroadcastTest(net, messages);
+    StopNetwork(net);
+    VerifyStoppedNetwork(net);
+    Overlay::RelayFanout = fanout;
+    ConnectionManager::UseTimer = true;
+  }
+
+  TEST(Overlay, RelaySpoof)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    int fanout = Overlay::RelayFanout;
+    Overlay::RelayFanout = 3;
+    OverlayNetwork net = ConstructOverlay(1, 12);
+    StartNetwork(net);
+    VerifyNetwork(net);
+    SetRelayKeys(net);
+    QSharedPointer<MessageHolder> messages(new MessageHolder(net,
+          Overlay::RelayMethod));
+    const OverlayPointer &server = net.first[0];
+
+    // Capture the relays instead of handling them, so only the heads of the
+    // server's subtrees receive one
+    QHash<Id, QSharedPointer<Holder> > captures;
+    foreach(const OverlayPointer &client, net.second) {
+      client->GetRpcHandler()->Unregister("CS::Relay");
+      captures[client->GetId()] = QSharedPointer<Holder>(
+          new Holder(client, "CS::Relay"));
+    }
+
+    server->BroadcastToClients(Overlay::RelayMethod, QByteArray("genuine"));
+    RunUntil();
+
+    OverlayPointer head;
+    OverlayPointer other;
+    QVariantList relay;
+    foreach(const OverlayPointer &client, net.second) {
+      QList<Request> requests = captures[client->GetId()]->GetRequests();
+      if(!requests.isEmpty() && !head) {
+        head = client;
+        relay = requests.first().GetData().toList();
+      } else if(requests.isEmpty() && !other) {
+        other = client;
+      }
+    }
+
+    captures.clear();
+    foreach(const OverlayPointer &client, net.second) {
+      client->GetRpcHandler()->Register("CS::Relay", client.data(), "RelayHelper");
+    }
+
+    ASSERT_TRUE(head);
+    ASSERT_TRUE(other);
+    ASSERT_EQ(relay.size(), 7);
+    ASSERT_TRUE(relay[4].toList().size() > 1);
+
+    // A genuine relay from a node other than the parent
+    other->SendNotification(head->GetId(), "CS::Relay", relay);
+    RunUntil();
+    EXPECT_EQ(messages->GetRequests(head->GetId()).count(), 0);
+
+    // Altered relays from the parent
+    QList<QVariantList> forged;
+    QVariantList msg = relay;
+    msg[1] = QString("MSGHNDL");
+    forged.append(msg);
+    msg = relay;
+    msg[2] = QByteArray("forged");
+    forged.append(msg);
+    msg = relay;
+    msg[3] = 2;
+    forged.append(msg);
+    msg = relay;
+    QVariantList targets = msg[4].toList();
+    QVariantList target;
+    target.append(other->GetId().GetByteArray());
+    target.append(QString("buffer://1000"));
+    targets.append(QVariant(target));
+    msg[4] = targets;
+    forged.append(msg);
+    msg = relay;
+    msg[6] = QByteArray(relay[6].toByteArray().size(), 0);
+    forged.append(msg);
+
+    QSharedPointer<Connection> con =
+      server->GetConnectionTable().GetConnection(head->GetId());
+    ASSERT_TRUE(con);
+    foreach(const QVariantList &forgery, forged) {
+      server->GetRpcHandler()->SendNotification(con, "CS::Relay", forgery);
+    }
+    RunUntil();
+    EXPECT_EQ(messages->GetRequests(head->GetId()).count(), 0);
+    EXPECT_EQ(messages->GetRequests(other->GetId()).count(), 0);
+
+    // A genuine relay from the parent for a tree wider than the local fanout
+    Overlay::RelayFanout = 2;
+    server->GetRpcHandler()->SendNotification(con, "CS::Relay", relay);
+    RunUntil();
+    EXPECT_EQ(messages->GetRequests(head->GetId()).count(), 0);
+    Overlay::RelayFanout = 3;
+
+    server->GetRpcHandler()->SendNotification(con, "CS::Relay", relay);
+    RunUntil();
+    ASSERT_EQ(messages->GetRequests(head->GetId()).count(), 1);
+    EXPECT_EQ(messages->GetRequests(head->GetId()).last().GetData().toByteArray(),
+        QByteArray("genuine"));
+
+    StopNetwork(net);
+    VerifyStoppedNetwork(net);
+    Overlay::RelayFanout = fanout;
+    ConnectionManager::UseTimer = true;
+  }
 }
 }
 
@@ -48,6 +48,55 @@ namespace Tests {
     SeededRandomTest<CryptoRandom>();
   }
 
+  TEST(Random, CryptoRandomCtrSeek)
+  {
+    QByteArray seed(CryptoRandom::OptimalSeedSize(), 0);
+    CryptoRandom().GenerateBlock(seed);
+
+    CryptoRandom rng0(seed, CryptoRandom::CTR_AES);
+    CryptoRandom rng1(seed, CryptoRandom::CTR_AES);
+    QByteArray stream(1000, 0);
+    rng0.GenerateBlock(stream);
+
+    QByteArray tail(stream.size() - 333, 0);
+    EXPECT_TRUE(rng1.Seek(333));
+    rng1.GenerateBlock(tail);
+    EXPECT_EQ(stream.mid(333), tail);
+
+    QByteArray head(333, 0);
+    EXPECT_TRUE(rng1.Seek(0));
+    rng1.GenerateBlock(head);
+    EXPECT_EQ(stream.left(333), head);
+
+    CryptoRandom x917(seed);
+    QByteArray other(stream.size(), 0);
+    x917.GenerateBlock(other);
+    EXPECT_NE(stream, other);
+    EXPECT_FALSE(x917.Seek(0));
+  }
+
+  void CryptoRandomXorBlockTest(CryptoRandom::GeneratorType type)
+  {
+    QByteArray seed(CryptoRandom::OptimalSeedSize(), 0);
+    CryptoRandom().GenerateBlock(seed);
+
+    QByteArray data(10000, 0);
+    CryptoRandom().GenerateBlock(data);
+
+    QByteArray expected(data.size(), 0);
+    CryptoRandom(seed, type).GenerateBlock(expected);
+    Utils::Xor(expected, expected, data);
+
+    CryptoRandom(seed, type).XorBlock(data);
+    EXPECT_EQ(expected, data);
+  }
+
+  TEST(Random, CryptoRandomXorBlock)
+  {
+    CryptoRandomXorBlockTest(CryptoRandom::X917);
+    CryptoRandomXorBlockTest(CryptoRandom::CTR_AES);
+  }
+
   TEST(Random, Integer)
   {
     Integer zero(0);
@@ -4,9 +4,9 @@
 
 namespace Dissent {
 namespace Tests {
-  void TestRoundBasic(CreateRound create_round)
+  void TestRoundBasic(CreateRound create_round, int servers = 3,
+      int clients = 10)
   {
-    int servers = 3, clients = 10;
     ConnectionManager::UseTimer = false;
     Timer::GetInstance().UseVirtualTime();
     OverlayNetwork net = ConstructOverlay(servers, clients);
@@ -131,7 +131,8 @@ namespace Tests {
     ConnectionManager::UseTimer = true;
   }
 
-  template <int N> class CSDCNetRoundBad : public CSDCNetRound, public Triggerable {
+  template <int N, int F = 0> class CSDCNetRoundBad :
+      public CSDCNetRound, public Triggerable {
     public:
       explicit CSDCNetRoundBad(const Identity::Roster &clients,
           const Identity::Roster &servers,
@@ -141,7 +142,7 @@ namespace Tests {
           Messaging::GetDataCallback &get_data,
           CreateRound create_shuffle) :
         CSDCNetRound(clients, servers, ident, nonce, overlay, get_data,
-            create_shuffle)
+            create_shuffle, F)
       {
       }
 
@@ -171,8 +172,9 @@ namespace Tests {
           QSharedPointer<CSDCNetRound::ServerState> state =
             cstate.dynamicCast<CSDCNetRound::ServerState>();
           int bc = Random::GetInstance().GetInt(0, state->anonymous_rngs.size());
-          state->current_phase_log->my_sub_ciphertexts[bc][offset] =
-            state->current_phase_log->my_sub_ciphertexts[bc][offset] ^ 0xff;
+          QByteArray &pad = state->current_phase_log->GetSubCiphertext(
+              state->rng_to_gidx[bc]);
+          pad[offset] = pad[offset] ^ 0xff;
         }
 
         qDebug() << "up to no good";
@@ -231,17 +233,18 @@ namespace Tests {
           return CSDCNetRound::GenerateServerCiphertext();
         }
 
-        int size = state->client_ciphertexts.size();
+        QList<int> submitted = state->current_phase_log->GetSubmittedClients();
+        int size = submitted.size();
         if(size == 0) {
           qDebug() << "No damage done";
           return CSDCNetRound::GenerateServerCiphertext();
         }
 
-        int tochange = Random::GetInstance().GetInt(0, size);
-        QPair<int, QByteArray> &data = state->client_ciphertexts[tochange];
+        int tochange = submitted[Random::GetInstance().GetInt(0, size)];
+        QByteArray data(state->current_phase_log->GetClientCiphertext(tochange));
         int offset = Random::GetInstance().GetInt(GetState()->base_msg_length + 1, mlen);
-        data.second[offset] = data.second[offset] ^ 0xff;
-        state->current_phase_log->messages[data.first][offset] = data.second[offset];
+        data[offset] = data[offset] ^ 0xff;
+        state->current_phase_log->SetClientCiphertext(tochange, data);
         CSDCNetRound::GenerateServerCiphertext();
 
         qDebug() << "up to no good";
@@ -310,5 +313,64 @@ namespace Tests {
         TCreateDCNetRound<bad, NeffKeyShuffleRound>,
         TBadGuyCB<bad>, true, true);
   }
+
+  TEST(HeresyRound, Basic)
+  {
+    // Two root servers, each with two children, and a third layer
+    int fanout = HeresyRound::Fanout;
+    HeresyRound::Fanout = 2;
+    TestRoundBasic(TCreateDCNetRound<HeresyRound, NullRound>, 7, 10);
+    HeresyRound::Fanout = fanout;
+  }
+
+  TEST(HeresyRound, BadClient)
+  {
+    // The servers form a chain, so blame checks the subtree ciphertexts
+    int fanout = HeresyRound::Fanout;
+    HeresyRound::Fanout = 1;
+    typedef CSDCNetRoundBad<-1, 1> bad;
+    TestRoundBad(TCreateDCNetRound<HeresyRound, NullRound>,
+        TCreateDCNetRound<bad, NullRound>,
+        TBadGuyCB<bad>, true, true);
+    HeresyRound::Fanout = fanout;
+  }
+
+  TEST(HeresyRound, BadServerBadServerInputCiphertext)
+  {
+    int fanout = HeresyRound::Fanout;
+    HeresyRound::Fanout = 1;
+    typedef CSDCNetRoundBad<-1, 1> bad;
+    TestRoundBad(TCreateDCNetRound<HeresyRound, NullRound>,
+        TCreateDCNetRound<bad, NullRound>,
+        TBadGuyCB<bad>, false, true);
+    HeresyRound::Fanout = fanout;
+  }
+
+  TEST(HeresyRound, BadServerBadServerCiphertext)
+  {
+    // Wherever the liar sits in the chain, its receiver holds its signed
+    // ciphertext and blame walks down to it
+    int fanout = HeresyRound::Fanout;
+    HeresyRound::Fanout = 1;
+    typedef CSDCNetRoundBad<0, 1> bad;
+    TestRoundBad(TCreateDCNetRound<HeresyRound, NullRound>,
+        TCreateDCNetRound<bad, NullRound>,
+        TBadGuyCB<bad>, false, true);
+    HeresyRound::Fanout = fanout;
+  }
+
+  TEST(HeresyRound, BadServerBadClientCiphertext)
+  {
+    // As in CSDCNetRound, a server altering a client's ciphertext stays
+    // consistent with what it sent, so the subtree check passes and the
+    // client's rebuttal cannot prove it, so no verdict is asserted
+    int fanout = HeresyRound::Fanout;
+    HeresyRound::Fanout = 1;
+    typedef CSDCNetRoundBad<1, 1> bad;
+    TestRoundBad(TCreateDCNetRound<HeresyRound, NullRound>,
+        TCreateDCNetRound<bad, NullRound>,
+        TBadGuyCB<bad>, false, false);
+    HeresyRound::Fanout = fanout;
+  }
 }
 }
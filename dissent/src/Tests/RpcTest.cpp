@@ -63,5 +63,62 @@ namespace Tests {
     EXPECT_EQ(test1.GetResponse().GetErrorType(), Response::InvalidMethod);
     qWarning() << test1.GetResponse().GetError() << test1.GetResponse().GetErrorType();
   }
+
+  TEST(Rpc, CompactWireFormat)
+  {
+    RpcHandler rpc0;
+    QSharedPointer<MockSource> ms0(new MockSource());
+    ms0->SetSink(&rpc0);
+    QSharedPointer<MockSender> to_ms0(new MockSender(ms0));
+
+    RpcHandler rpc1;
+    QSharedPointer<MockSource> ms1(new MockSource());
+    ms1->SetSink(&rpc1);
+    QSharedPointer<MockSender> to_ms1(new MockSender(ms1));
+    to_ms0->SetReturnPath(to_ms1);
+    to_ms1->SetReturnPath(to_ms0);
+
+    TestRpc test0;
+    rpc0.Register("CM::Ping", &test0, "Add");
+    TestNotification notify0;
+    rpc0.Register("SessionData", &notify0, "Handle");
+
+    TestResponse test1;
+    QSharedPointer<ResponseHandler> res_h(
+        new ResponseHandler(&test1, "HandleResponse"));
+
+    QVariantList data;
+    data.append(3);
+    data.append(6);
+
+    // Version 0 peers receive the QVariantList framing
+    rpc1.SendRequest(to_ms0, "CM::Ping", data, res_h);
+    EXPECT_EQ(char(0), to_ms0->GetLastSent()[0]);
+    EXPECT_EQ(9, test1.GetValue());
+
+    to_ms0->SetWireVersion(RpcHandler::WireVersion);
+    data[1] = 7;
+    rpc1.SendRequest(to_ms0, "CM::Ping", data, res_h);
+    EXPECT_NE(char(0), to_ms0->GetLastSent()[0]);
+    EXPECT_EQ(10, test1.GetValue());
+
+    QByteArray payload(1000, 'a');
+    rpc1.SendNotification(to_ms0, "SessionData", payload);
+    EXPECT_EQ(payload.size() + 12, to_ms0->GetLastSent().size());
+    EXPECT_EQ(QString("SessionData"), notify0.GetMethod());
+    EXPECT_EQ(payload, notify0.GetData().toByteArray());
+
+    rpc1.SendNotification(to_ms0, "SessionData", data);
+    EXPECT_EQ(data, notify0.GetData().toList());
+
+    // Methods outside of the table fall back to the QVariantList framing
+    rpc0.Register("add", &test0, "Add");
+    rpc1.SendRequest(to_ms0, "add", data, res_h);
+    EXPECT_EQ(char(0), to_ms0->GetLastSent()[0]);
+    EXPECT_EQ(10, test1.GetValue());
+
+    EXPECT_EQ(0, RpcHandler::GetMethodId("add"));
+    EXPECT_NE(0, RpcHandler::GetMethodId("SessionData"));
+  }
 }
 }
@@ -33,6 +33,28 @@ namespace Tests {
       }
   };
 
+  class TestNotification : public QObject {
+    Q_OBJECT
+
+    public:
+      TestNotification() : _count(0) {}
+
+      QVariant GetData() const { return _request.GetData(); }
+      QString GetMethod() const { return _request.GetMethod(); }
+      int GetCount() const { return _count; }
+
+    public slots:
+      void Handle(const Request &request)
+      {
+        _request = request;
+        _count++;
+      }
+
+    private:
+      Request _request;
+      int _count;
+  };
+
   class TestResponse : public QObject {
     Q_OBJECT
     public:
@@ -1,5 +1,8 @@
+#include <QThreadPool>
+
 #include "DissentTest.hpp"
 #include "OverlayTest.hpp"
+#include "RpcTest.hpp"
 #include "SessionTest.hpp"
 
 namespace Dissent {
@@ -213,6 +216,50 @@ namespace Tests {
     qDebug() << "Round started after disconnection";
   }
 
+  TEST(Session, EphemeralKeyPool)
+  {
+    int size = EphemeralKeyPool::Size;
+    int local_nodes = EphemeralKeyPool::LocalNodes;
+    bool multithreading = Utils::MultiThreading;
+    EphemeralKeyPool::Clear();
+
+    Utils::MultiThreading = false;
+    EphemeralKeyPool::KeySet keys = EphemeralKeyPool::Take(DiffieHellman::MODULAR);
+    EXPECT_TRUE(keys.signing_key->IsValid());
+    EXPECT_EQ(keys.dh_key.GetKeyType(), DiffieHellman::MODULAR);
+    EXPECT_EQ(EphemeralKeyPool::Available(DiffieHellman::MODULAR), 0);
+
+    Utils::MultiThreading = true;
+    EphemeralKeyPool::Size = 3;
+    EphemeralKeyPool::Fill(DiffieHellman::ELLIPTIC_CURVE);
+    QThreadPool::globalInstance()->waitForDone();
+    EXPECT_EQ(EphemeralKeyPool::Available(DiffieHellman::ELLIPTIC_CURVE), 3);
+    EXPECT_EQ(EphemeralKeyPool::Available(DiffieHellman::MODULAR), 0);
+
+    EphemeralKeyPool::KeySet keys0 = EphemeralKeyPool::Take(DiffieHellman::ELLIPTIC_CURVE);
+    EphemeralKeyPool::KeySet keys1 = EphemeralKeyPool::Take(DiffieHellman::ELLIPTIC_CURVE);
+    EXPECT_EQ(keys0.signing_key->GetKeyType(), AsymmetricKey::ECDSA);
+    EXPECT_EQ(keys0.dh_key.GetKeyType(), DiffieHellman::ELLIPTIC_CURVE);
+    EXPECT_NE(keys0.dh_key.GetPublicComponent(), keys1.dh_key.GetPublicComponent());
+    EXPECT_NE(*keys0.signing_key, *keys1.signing_key);
+
+    // Every take is replaced
+    QThreadPool::globalInstance()->waitForDone();
+    EXPECT_EQ(EphemeralKeyPool::Available(DiffieHellman::ELLIPTIC_CURVE), 3);
+
+    // The pool scales with the nodes sharing it
+    EphemeralKeyPool::LocalNodes = 2;
+    EphemeralKeyPool::Fill(DiffieHellman::ELLIPTIC_CURVE);
+    QThreadPool::globalInstance()->waitForDone();
+    EXPECT_EQ(EphemeralKeyPool::Available(DiffieHellman::ELLIPTIC_CURVE), 6);
+
+    EphemeralKeyPool::Clear();
+    EXPECT_EQ(EphemeralKeyPool::Available(DiffieHellman::ELLIPTIC_CURVE), 0);
+    EphemeralKeyPool::Size = size;
+    EphemeralKeyPool::LocalNodes = local_nodes;
+    Utils::MultiThreading = multithreading;
+  }
+
   TEST(Session, Servers)
   {
     Timer::GetInstance().UseVirtualTime();
@@ -265,6 +312,159 @@ namespace Tests {
     ConnectionManager::UseTimer = true;
   }
 
+  TEST(Session, CloseRegistrationEarly)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    ServerSession::CloseRegistrationEarly = true;
+    OverlayNetwork net = ConstructOverlay(3, 10);
+    VerifyStoppedNetwork(net);
+    StartNetwork(net);
+    VerifyNetwork(net);
+
+    Sessions sessions = BuildSessions(net);
+    qint64 start = Utils::Time::GetInstance().MSecsSinceEpoch();
+    StartSessions(sessions);
+    StartRound(sessions);
+    EXPECT_LT(Utils::Time::GetInstance().MSecsSinceEpoch() - start,
+        ServerSession::RegistrationTimeout);
+    SendTest(sessions);
+    StopSessions(sessions);
+
+    StopNetwork(sessions.network);
+    VerifyStoppedNetwork(sessions.network);
+    ServerSession::CloseRegistrationEarly = false;
+    ConnectionManager::UseTimer = true;
+  }
+
+  TEST(Session, PipelineRounds)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    ServerSession::CloseRegistrationEarly = true;
+    ServerSession::PipelineRounds = true;
+    OverlayNetwork net = ConstructOverlay(3, 10);
+    VerifyStoppedNetwork(net);
+    StartNetwork(net);
+    VerifyNetwork(net);
+
+    Sessions sessions = BuildSessions(net);
+    QList<QSharedPointer<RoundRecorder> > recorders;
+    foreach(const ServerPointer &ss, sessions.servers) {
+      recorders.append(QSharedPointer<RoundRecorder>(new RoundRecorder(ss.data())));
+    }
+
+    foreach(const ClientPointer &cs, sessions.clients) {
+      recorders.append(QSharedPointer<RoundRecorder>(new RoundRecorder(cs.data())));
+    }
+
+    StartSessions(sessions);
+    StartRound(sessions);
+    for(int idx = 0; idx < 3; idx++) {
+      SendTest(sessions);
+      CompleteRound(sessions);
+    }
+    StopSessions(sessions);
+
+    // Every session finishes each round before starting the next and all
+    // of them run the same rounds in the same order
+    QList<QByteArray> rounds;
+    foreach(const QSharedPointer<RoundRecorder> &recorder, recorders) {
+      QList<RoundRecorder::Event> events = recorder->GetEvents();
+      ASSERT_GE(events.size(), 6);
+      for(int idx = 0; idx + 1 < events.size(); idx += 2) {
+        EXPECT_TRUE(events[idx].first);
+        EXPECT_FALSE(events[idx + 1].first);
+        EXPECT_EQ(events[idx].second, events[idx + 1].second);
+
+        int round = idx / 2;
+        if(round == rounds.size()) {
+          EXPECT_FALSE(rounds.contains(events[idx].second));
+          rounds.append(events[idx].second);
+        } else {
+          EXPECT_EQ(rounds[round], events[idx].second);
+        }
+      }
+    }
+
+    StopNetwork(sessions.network);
+    VerifyStoppedNetwork(sessions.network);
+    ServerSession::PipelineRounds = false;
+    ServerSession::CloseRegistrationEarly = false;
+    ConnectionManager::UseTimer = true;
+  }
+
+  TEST(Session, BadServerList)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    bool multithreading = Utils::MultiThreading;
+    Utils::MultiThreading = true;
+
+    OverlayNetwork net = ConstructOverlay(3, 10);
+    VerifyStoppedNetwork(net);
+    StartNetwork(net);
+    VerifyNetwork(net);
+
+    Sessions sessions = BuildSessions(net);
+
+    // This client never registers, the test listens for its ServerQueued
+    ClientPointer absent = sessions.clients.takeLast();
+    OverlayPointer absent_overlay = net.second.last();
+    TestNotification notify;
+    absent_overlay->GetRpcHandler()->Register("SessionData", &notify, "Handle");
+
+    StartSessions(sessions);
+
+    qint64 next = Timer::GetInstance().VirtualRun();
+    while(next != -1 && notify.GetCount() == 0) {
+      Time::GetInstance().IncrementVirtualClock(next);
+      next = Timer::GetInstance().VirtualRun();
+    }
+    ASSERT_LT(0, notify.GetCount());
+
+    ServerQueued queued(notify.GetData().toByteArray());
+    QByteArray round_id = queued.GetAgreeList()[0]->GetRoundId();
+
+    // Registrations for the right round that were signed with the wrong
+    // keys, two of them from the same client
+    QList<QSharedPointer<ClientRegister> > forged;
+    for(int idx = 0; idx < 3; idx++) {
+      Id id = (idx < 2) ? absent_overlay->GetId() : net.second[0]->GetId();
+      QSharedPointer<AsymmetricKey> key =
+        sessions.private_keys[net.second[idx + 1]->GetId().ToString()];
+      QSharedPointer<ClientRegister> clr(new ClientRegister(id, round_id,
+            key->GetPublicKey(), QVariant()));
+      clr->SetSignature(key->Sign(clr->GetPayload()));
+      forged.append(clr);
+    }
+
+    // Servers are still in registration, so this list reaches them before
+    // the genuine one from the same server
+    OverlayPointer liar = net.first[1];
+    ServerList list(forged);
+    list.SetSignature(sessions.private_keys[liar->GetId().ToString()]->Sign(
+          list.GetPayload()));
+    foreach(const OverlayPointer &server, net.first) {
+      if(server != liar) {
+        liar->SendNotification(server->GetId(), "SessionData", list.GetPacket());
+      }
+    }
+
+    StartRound(sessions);
+
+    foreach(const ServerPointer &ss, sessions.servers) {
+      EXPECT_EQ(sessions.clients.count(), ss->GetRound()->GetClients().Count());
+      EXPECT_FALSE(ss->GetRound()->GetClients().Contains(absent_overlay->GetId()));
+    }
+
+    StopSessions(sessions);
+    StopNetwork(sessions.network);
+    VerifyStoppedNetwork(sessions.network);
+    Utils::MultiThreading = multithreading;
+    ConnectionManager::UseTimer = true;
+  }
+
   TEST(Session, ClientsServers)
   {
     Timer::GetInstance().UseVirtualTime();
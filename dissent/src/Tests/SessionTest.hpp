@@ -22,6 +22,45 @@ namespace Tests {
       CreateRound create_round;
   };
 
+  /**
+   * Records the rounds a session starts and finishes, in order
+   */
+  class RoundRecorder : public QObject {
+    Q_OBJECT
+
+    public:
+      typedef QPair<bool, QByteArray> Event;
+
+      explicit RoundRecorder(QObject *session)
+      {
+        QObject::connect(session,
+            SIGNAL(RoundStarting(const QSharedPointer<Anonymity::Round> &)),
+            this, SLOT(Started(const QSharedPointer<Anonymity::Round> &)));
+        QObject::connect(session,
+            SIGNAL(RoundFinished(const QSharedPointer<Anonymity::Round> &)),
+            this, SLOT(Finished(const QSharedPointer<Anonymity::Round> &)));
+      }
+
+      /**
+       * Returns the (started, round id) events seen so far
+       */
+      QList<Event> GetEvents() const { return _events; }
+
+    public slots:
+      void Started(const QSharedPointer<Anonymity::Round> &round)
+      {
+        _events.append(Event(true, round->GetNonce()));
+      }
+
+      void Finished(const QSharedPointer<Anonymity::Round> &round)
+      {
+        _events.append(Event(false, round->GetNonce()));
+      }
+
+    private:
+      QList<Event> _events;
+  };
+
   Sessions BuildSessions(const OverlayNetwork &network,
       CreateRound create_round = TCreateRound<NullRound>);
   void StartSessions(const Sessions &sessions);
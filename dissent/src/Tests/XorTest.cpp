@@ -0,0 +1,119 @@
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  namespace {
+    /**
+     * The byte-at-a-time xor previously used by BaseDCNetRound
+     */
+    void ByteXor(QByteArray &dst, const QByteArray &t1, const QByteArray &t2)
+    {
+      int count = std::min(dst.size(), t1.size());
+      count = std::min(count, t2.size());
+
+      for(int idx = 0; idx < count; idx++) {
+        dst[idx] = t1[idx] ^ t2[idx];
+      }
+    }
+  }
+
+  TEST(Xor, Basic)
+  {
+    CryptoRandom rand;
+    for(int length = 0; length < 600; length++) {
+      QByteArray t1(length, 0);
+      QByteArray t2(length, 0);
+      rand.GenerateBlock(t1);
+      rand.GenerateBlock(t2);
+
+      QByteArray expected(length, 0);
+      ByteXor(expected, t1, t2);
+
+      QByteArray actual(length, 0);
+      Utils::Xor(actual, t1, t2);
+      EXPECT_EQ(expected, actual);
+
+      Utils::Xor(t1, t1, t2);
+      EXPECT_EQ(expected, t1);
+    }
+  }
+
+  TEST(Xor, Unaligned)
+  {
+    CryptoRandom rand;
+    QByteArray t1(1027, 0);
+    QByteArray t2(1027, 0);
+    rand.GenerateBlock(t1);
+    rand.GenerateBlock(t2);
+
+    for(int offset = 0; offset < 3; offset++) {
+      QByteArray actual(t1.size(), 0);
+      int length = t1.size() - offset;
+      Utils::Xor(actual.data() + offset, t1.constData() + offset,
+          t2.constData() + offset, length);
+
+      QByteArray expected(t1.size(), 0);
+      ByteXor(expected, t1, t2);
+      EXPECT_EQ(expected.mid(offset), actual.mid(offset));
+    }
+  }
+
+  TEST(Xor, Many)
+  {
+    CryptoRandom rand;
+    int length = 20000;
+    QList<QByteArray> srcs;
+    QByteArray expected(length, 0);
+    for(int idx = 0; idx < 17; idx++) {
+      QByteArray src(length, 0);
+      rand.GenerateBlock(src);
+      srcs.append(src);
+      ByteXor(expected, expected, src);
+    }
+
+    QByteArray actual(length, 0);
+    Utils::XorMany(actual, srcs);
+    EXPECT_EQ(expected, actual);
+
+    // Shorter sources truncate the operation
+    srcs.append(QByteArray(100, 1));
+    QByteArray truncated(length, 0);
+    Utils::XorMany(truncated, srcs);
+    EXPECT_NE(expected.left(100), truncated.left(100));
+    EXPECT_EQ(QByteArray(length - 100, 0), truncated.mid(100));
+  }
+
+  /**
+   * Combines as many client ciphertexts as a large round, gtest reports
+   * the time taken
+   */
+  TEST(Xor, Benchmark)
+  {
+    CryptoRandom rand;
+    int length = 4096;
+    int count = 5000;
+    QList<QByteArray> srcs;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray src(length, 0);
+      rand.GenerateBlock(src);
+      srcs.append(src);
+    }
+
+    QByteArray byte_result(length, 0);
+    foreach(const QByteArray &src, srcs) {
+      ByteXor(byte_result, byte_result, src);
+    }
+
+    QByteArray pair_result(length, 0);
+    foreach(const QByteArray &src, srcs) {
+      Utils::Xor(pair_result, pair_result, src);
+    }
+
+    QByteArray many_result(length, 0);
+    Utils::XorMany(many_result, srcs);
+
+    EXPECT_EQ(byte_result, pair_result);
+    EXPECT_EQ(byte_result, many_result);
+  }
+}
+}
@@ -1,6 +1,9 @@
 #include "AddressFactory.hpp"
 #include "BufferAddress.hpp"
 #include "TcpAddress.hpp"
+#ifdef __linux__
+#include "EpollAddress.hpp"
+#endif
 #include <QDebug>
 
 namespace Dissent {
@@ -17,6 +20,10 @@ namespace Transports {
     AddAnyCallback("buffer", BufferAddress::CreateAny);
     AddCreateCallback(TcpAddress::Scheme, TcpAddress::Create);
     AddAnyCallback(TcpAddress::Scheme, TcpAddress::CreateAny);
+#ifdef __linux__
+    AddCreateCallback(EpollAddress::Scheme, EpollAddress::Create);
+    AddAnyCallback(EpollAddress::Scheme, EpollAddress::CreateAny);
+#endif
   }
 
   void AddressFactory::AddCreateCallback(const QString &scheme, CreateCallback cb)
@@ -39,7 +39,7 @@ namespace Transports {
 
     TimerCallback *tm = new TimerMethodShared<BufferEdge, QByteArray>(
         rem_edge.dynamicCast<BufferEdge>(),
-        &BufferEdge::DelayedReceive, data);
+        &BufferEdge::DelayedReceive, Compress(data));
     Timer::GetInstance().QueueCallback(tm, Delay);
     Sent();
   }
@@ -1,13 +1,157 @@
+#include <string.h>
+#include <zlib.h>
+
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+
 #include "Edge.hpp"
+#include "Messaging/RpcHandler.hpp"
+#include "Utils/Serialization.hpp"
+
+using Dissent::Utils::Serialization;
 
 namespace Dissent {
 namespace Transports {
+  namespace {
+    /**
+     * Edges whose average ratio exceeds this stop compressing, except for
+     * every ProbeInterval-th frame, which measures whether the data has
+     * become compressible again
+     */
+    const double MaximumCompressionRatio = 0.9;
+    const int ProbeInterval = 16;
+
+    /**
+     * A message notified to many peers is serialized once and shared by
+     * all of their edges, so the last compressed frame is kept for reuse
+     */
+    QMutex cache_lock;
+    QByteArray cache_input;
+    QByteArray cache_output;
+    int cache_level = 0;
+
+    /**
+     * Deflates data with the Rpc framing dictionary, returning the magic
+     * byte, the big endian size of the message and its zlib data, or an
+     * empty frame if zlib fails
+     */
+    QByteArray CompressFrame(const QByteArray &data, int level)
+    {
+      {
+        QMutexLocker locker(&cache_lock);
+        if(cache_input.constData() == data.constData() &&
+            cache_input.size() == data.size() && cache_level == level)
+        {
+          return cache_output;
+        }
+      }
+
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      if(deflateInit(&stream, level) != Z_OK) {
+        return QByteArray();
+      }
+
+      const QByteArray &dictionary = Messaging::RpcHandler::GetFramingDictionary();
+      deflateSetDictionary(&stream,
+          reinterpret_cast<const Bytef *>(dictionary.constData()),
+          dictionary.size());
+
+      // deflateBound counts the dictionary id once one is set
+      int bound = deflateBound(&stream, data.size());
+      QByteArray frame(5 + bound, 0);
+      frame[0] = Edge::CompressedMagic;
+      Serialization::WriteInt(data.size(), frame, 1);
+
+      stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+      stream.avail_in = data.size();
+      stream.next_out = reinterpret_cast<Bytef *>(frame.data() + 5);
+      stream.avail_out = bound;
+      int result = deflate(&stream, Z_FINISH);
+      deflateEnd(&stream);
+
+      if(result != Z_STREAM_END) {
+        return QByteArray();
+      }
+      frame.resize(5 + bound - stream.avail_out);
+
+      QMutexLocker locker(&cache_lock);
+      cache_input = data;
+      cache_output = frame;
+      cache_level = level;
+      return frame;
+    }
+
+    /**
+     * zlib never expands data by more than this factor
+     */
+    const qint64 MaximumInflateRatio = 1032;
+
+    /**
+     * Inflates a frame from CompressFrame.  Unlike qUncompress, which grows
+     * its output until the data fits, at most the declared size is
+     * allocated and written, and it must be bounded.  Streams deflated
+     * without a dictionary, as qCompress produces, are also accepted.
+     */
+    QByteArray InflateFrame(const QByteArray &frame)
+    {
+      if(frame.size() <= 5) {
+        return QByteArray();
+      }
+
+      int size = Serialization::ReadInt(frame, 1);
+      if(size <= 0 || size > Edge::MaximumDecompressedSize ||
+          size > MaximumInflateRatio * (frame.size() - 5))
+      {
+        return QByteArray();
+      }
+
+      QByteArray data(size, 0);
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      if(inflateInit(&stream) != Z_OK) {
+        return QByteArray();
+      }
+
+      stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(frame.constData() + 5));
+      stream.avail_in = frame.size() - 5;
+      stream.next_out = reinterpret_cast<Bytef *>(data.data());
+      stream.avail_out = size;
+      int result = inflate(&stream, Z_FINISH);
+
+      // A stream deflated with another dictionary is dropped
+      if(result == Z_NEED_DICT) {
+        const QByteArray &dictionary = Messaging::RpcHandler::GetFramingDictionary();
+        const Bytef *dict = reinterpret_cast<const Bytef *>(dictionary.constData());
+        if(stream.adler == adler32(adler32(0, Z_NULL, 0), dict, dictionary.size()) &&
+            inflateSetDictionary(&stream, dict, dictionary.size()) == Z_OK)
+        {
+          result = inflate(&stream, Z_FINISH);
+        }
+      }
+      inflateEnd(&stream);
+
+      // Data beyond the declared size leaves the stream unfinished
+      if(result != Z_STREAM_END || stream.avail_out != 0) {
+        return QByteArray();
+      }
+      return data;
+    }
+  }
+
+  int Edge::CompressionLevel = 0;
+
   Edge::Edge(const Address &local, const Address &remote, bool outbound) :
     _local_address(local),
     _remote_address(remote),
     _remote_p_addr(remote),
     _outbound(outbound),
-    _last_incoming(Utils::Time::GetInstance().MSecsSinceEpoch())
+    _last_incoming(Utils::Time::GetInstance().MSecsSinceEpoch()),
+    _wire_version(0),
+    _compression(false),
+    _compression_ratio(0),
+    _compression_skipped(0)
   {
   }
 
@@ -27,6 +171,45 @@ namespace Transports {
         ", Remote: " + _remote_address.ToString());
   }
 
+  QByteArray Edge::Compress(const QByteArray &data)
+  {
+    if(!_compression || CompressionLevel < 1 || data.size() < CompressionThreshold ||
+        data.size() > MaximumDecompressedSize)
+    {
+      return data;
+    }
+
+    if(_compression_ratio > MaximumCompressionRatio &&
+        ++_compression_skipped < ProbeInterval)
+    {
+      return data;
+    }
+    _compression_skipped = 0;
+
+    QByteArray frame = CompressFrame(data, CompressionLevel);
+    if(frame.isEmpty()) {
+      return data;
+    }
+
+    double ratio = double(frame.size()) / data.size();
+    _compression_ratio = 0.75 * _compression_ratio + 0.25 * ratio;
+    return frame.size() < data.size() ? frame : data;
+  }
+
+  QByteArray Edge::Decompress(const QByteArray &frame) const
+  {
+    if(!_compression || CompressionLevel < 1) {
+      qWarning() << "Dropping an unnegotiated compressed frame on" << ToString();
+      return QByteArray();
+    }
+
+    QByteArray data = InflateFrame(frame);
+    if(data.isEmpty()) {
+      qWarning() << "Dropping a malformed compressed frame on" << ToString();
+    }
+    return data;
+  }
+
   void Edge::OnStop()
   {
     if(!RequiresCleanup()) {
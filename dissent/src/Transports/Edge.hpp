@@ -91,13 +91,80 @@ namespace Transports {
        */
       virtual qint64 GetLastOutgoingMessage() const { return _last_outgoing; }
 
+      /**
+       * Returns the RPC wire format negotiated with the remote peer
+       */
+      virtual int GetWireVersion() const { return _wire_version; }
+
+      /**
+       * Sets the RPC wire format negotiated with the remote peer
+       * @param version the wire format version
+       */
+      void SetWireVersion(int version) { _wire_version = version; }
+
+      /**
+       * True if the remote peer accepts compressed frames
+       */
+      bool GetCompression() const { return _compression; }
+
+      /**
+       * Sets whether frames may be compressed, as negotiated with the remote
+       * peer.  Compressed frames are only accepted from a peer that
+       * negotiated compression while CompressionLevel is enabled.
+       * @param compression true if the remote peer accepts compressed frames
+       */
+      void SetCompression(bool compression) { _compression = compression; }
+
+      /**
+       * Returns the number of bytes queued for sending but not yet accepted
+       * by the operating system
+       */
+      virtual qint64 GetBytesQueued() const { return 0; }
+
+      /**
+       * True if GetBytesQueued has passed HighWaterMark and not yet fallen
+       * back to LowWaterMark, senders should hold back until
+       * WriteQueueDrained
+       */
+      virtual bool Congested() const { return false; }
+
       static QByteArray PingPacket();
 
+      static const qint64 HighWaterMark = 8 * 1024 * 1024;
+      static const qint64 LowWaterMark = 1024 * 1024;
+
       static const int MaximumInterpacketDelay = 15000;
 
+      /**
+       * zlib level for compressing frames on edges that negotiated it, 0
+       * disables compression
+       */
+      static int CompressionLevel;
+
+      /**
+       * Frames shorter than this are never compressed
+       */
+      static const int CompressionThreshold = 256;
+
+      /**
+       * Messages larger than this are never compressed, and compressed
+       * frames claiming a larger message are dropped before inflating
+       */
+      static const int MaximumDecompressedSize = 16 * 1024 * 1024;
+
+      /**
+       * Leading byte of a compressed frame, Rpc frames begin with 0 or 0xD5
+       */
+      static const char CompressedMagic = char(0xC5);
+
     signals:
       void StoppedSignal();
 
+      /**
+       * Emitted when a congested edge's queue falls below LowWaterMark
+       */
+      void WriteQueueDrained();
+
     protected:
       /**
        * Overloaded to set the time the last message came in
@@ -111,9 +178,25 @@ namespace Transports {
         } else if(_last_incoming - _last_outgoing > MaximumInterpacketDelay) {
           Send(PingPacket());
         }
+
+        if(!data.isEmpty() && data.at(0) == CompressedMagic) {
+          QByteArray msg = Decompress(data);
+          if(!msg.isEmpty()) {
+            SourceObject::PushData(from, msg);
+          }
+          return;
+        }
         SourceObject::PushData(from, data);
       }
 
+      /**
+       * Returns the frame to send for data: compressed when the remote peer
+       * accepts compressed frames, the data is at least CompressionThreshold
+       * bytes, and recent frames on this edge compressed well
+       * @param data the message to send
+       */
+      QByteArray Compress(const QByteArray &data);
+
       inline void Sent()
       {
         _last_outgoing = Utils::Time::GetInstance().MSecsSinceEpoch();
@@ -142,6 +225,25 @@ namespace Transports {
       bool _outbound;
       qint64 _last_incoming;
       qint64 _last_outgoing;
+      int _wire_version;
+      bool _compression;
+
+      /**
+       * Moving average of compressed over original size on this edge
+       */
+      double _compression_ratio;
+
+      /**
+       * Frames sent uncompressed since the average last indicated poor
+       * compression
+       */
+      int _compression_skipped;
+
+      /**
+       * Returns the message in a compressed frame, empty if compression was
+       * not negotiated or the frame is malformed
+       */
+      QByteArray Decompress(const QByteArray &frame) const;
   };
 }
 }
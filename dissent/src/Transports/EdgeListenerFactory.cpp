@@ -1,6 +1,9 @@
 #include "EdgeListenerFactory.hpp"
 #include "BufferEdgeListener.hpp"
 #include "TcpEdgeListener.hpp"
+#ifdef __linux__
+#include "EpollEdgeListener.hpp"
+#endif
 
 namespace Dissent {
 namespace Transports {
@@ -14,6 +17,9 @@ namespace Transports {
   {
     AddCallback("buffer", BufferEdgeListener::Create);
     AddCallback(TcpEdgeListener::Scheme, TcpEdgeListener::Create);
+#ifdef __linux__
+    AddCallback(EpollEdgeListener::Scheme, EpollEdgeListener::Create);
+#endif
   }
 
   void EdgeListenerFactory::AddCallback(const QString &type, Callback cb)
@@ -0,0 +1,31 @@
+#include "EpollAddress.hpp"
+
+namespace Dissent {
+namespace Transports {
+  const QString EpollAddress::Scheme = "epoll";
+
+  EpollAddress::EpollAddress(const QUrl &url) :
+    TcpAddress(url, Scheme)
+  {
+  }
+
+  EpollAddress::EpollAddress(const QString &ip, int port) :
+    TcpAddress(ip, port, Scheme)
+  {
+  }
+
+  EpollAddress::EpollAddress(const EpollAddress &other) : TcpAddress(other)
+  {
+  }
+
+  const Address EpollAddress::Create(const QUrl &url)
+  {
+    return EpollAddress(url);
+  }
+
+  const Address EpollAddress::CreateAny()
+  {
+    return EpollAddress();
+  }
+}
+}
@@ -0,0 +1,37 @@
+#ifndef DISSENT_TRANSPORTS_EPOLL_ADDRESS_H_GUARD
+#define DISSENT_TRANSPORTS_EPOLL_ADDRESS_H_GUARD
+
+#include "TcpAddress.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Addresses Tcp end points served by an EpollEdgeListener, the same ip and
+   * port as a TcpAddress under its own scheme
+   */
+  class EpollAddress : public TcpAddress {
+    public:
+      const static QString Scheme;
+
+      explicit EpollAddress(const QUrl &url);
+      EpollAddress(const EpollAddress &other);
+
+      /**
+       * Creates an Epoll Address using the ip address and port
+       * @param ip provided ip or any if non-specified (0.0.0.0)
+       * @param port provided port or any if non-specified (0)
+       */
+      explicit EpollAddress(const QString &ip = "0.0.0.0", int port = 0);
+
+      /**
+       * Destructor
+       */
+      virtual ~EpollAddress() {}
+
+      static const Address Create(const QUrl &url);
+      static const Address CreateAny();
+  };
+}
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <QDebug>
+
+#include "EpollEdge.hpp"
+#include "EpollEdgeListener.hpp"
+#include "Utils/Serialization.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    const QByteArray Zero(4, 0);
+  }
+
+  EpollEdge::EpollEdge(const Address &local, const Address &remote,
+      bool outbound, int fd, EpollEdgeListener *listener) :
+    Edge(local, remote, outbound),
+    _fd(fd),
+    _listener(listener),
+    _write_offset(0),
+    _queued_bytes(0),
+    _flush_pending(false),
+    _congested(false)
+  {
+    QObject::connect(this, SIGNAL(DelayedRead()), this, SLOT(Read()),
+        Qt::QueuedConnection);
+    QObject::connect(this, SIGNAL(DelayedFlush()), this, SLOT(Flush()),
+        Qt::QueuedConnection);
+
+    // Data may have arrived before the edge had a sink
+    emit DelayedRead();
+  }
+
+  EpollEdge::~EpollEdge()
+  {
+    Close();
+  }
+
+  void EpollEdge::Send(const QByteArray &data)
+  {
+    if(Stopped()) {
+      qWarning() << "Attempted to send on a closed edge:" << ToString();
+      return;
+    }
+
+    QByteArray frame = Compress(data);
+    _write_queue.append(frame);
+    _queued_bytes += frame.size() + 8;
+    if(!_flush_pending) {
+      _flush_pending = true;
+      emit DelayedFlush();
+    }
+
+    if(!_congested && GetBytesQueued() >= HighWaterMark) {
+      _congested = true;
+    }
+    Sent();
+  }
+
+  void EpollEdge::HandleEvents(quint32 events)
+  {
+    if(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      Read();
+    }
+
+    if(_fd != -1 && (events & EPOLLOUT)) {
+      Flush();
+    }
+  }
+
+  void EpollEdge::Read()
+  {
+    // Edge-triggered, so the socket must be drained before epoll reports it
+    // readable again, a busy edge finishes from the event loop instead so
+    // the other edges of the loop are not starved
+    int budget = ReadBudget;
+    while(_fd != -1) {
+      if(budget <= 0) {
+        emit DelayedRead();
+        return;
+      }
+
+      if(!_listener) {
+        Stop("EdgeListener destroyed");
+        return;
+      }
+
+      QByteArray &buffer = _listener->GetReadBuffer();
+      ssize_t count = recv(_fd, buffer.data(), qMin(buffer.size(), budget), 0);
+
+      if(count == 0) {
+        Stop("Disconnected");
+        return;
+      } else if(count < 0) {
+        if(errno == EINTR) {
+          continue;
+        } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+          return;
+        }
+        QString reason = QString::fromUtf8(strerror(errno));
+        if(Stop(reason)) {
+          qWarning() << "Received warning from EpollEdge (" << ToString() <<
+            "):" << reason;
+        }
+        return;
+      }
+
+      budget -= count;
+
+      // The shared buffer is consumed before any sink can run
+      QList<QByteArray> frames;
+      if(!_parser.Parse(buffer.constData(), count, frames)) {
+        qCritical() << "Error reading Epoll socket from" << ToString();
+        Stop("Error reading Epoll socket");
+        return;
+      }
+
+      foreach(const QByteArray &frame, frames) {
+        if(_fd == -1) {
+          return;
+        }
+        PushData(GetSharedPointer(), frame);
+      }
+    }
+  }
+
+  void EpollEdge::Flush()
+  {
+    static const int MaximumIov = 1020;
+
+    _flush_pending = false;
+
+    while(_fd != -1 && !_write_queue.isEmpty()) {
+      int count = qMin(_write_queue.count(), MaximumIov / 3);
+      QByteArray headers(4 * count, 0);
+      struct iovec iov[MaximumIov];
+      int iovcnt = 0;
+      qint64 batch = 0;
+      qint64 skip = _write_offset;
+
+      for(int idx = 0; idx < count; idx++) {
+        const QByteArray &data = _write_queue[idx];
+        Serialization::WriteInt(data.size(), headers, 4 * idx);
+        const char *parts[3] = { headers.constData() + 4 * idx, data.constData(),
+          Zero.constData() };
+        qint64 sizes[3] = { 4, data.size(), 4 };
+        for(int part = 0; part < 3; part++) {
+          if(skip >= sizes[part]) {
+            skip -= sizes[part];
+            continue;
+          }
+          iov[iovcnt].iov_base = const_cast<char *>(parts[part] + skip);
+          iov[iovcnt++].iov_len = sizes[part] - skip;
+          batch += sizes[part] - skip;
+          skip = 0;
+        }
+      }
+
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = iovcnt;
+
+      ssize_t sent = sendmsg(_fd, &msg, MSG_NOSIGNAL);
+      if(sent < 0) {
+        if(errno == EINTR) {
+          continue;
+        } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+          // Epoll reports EPOLLOUT once the kernel has room again
+          break;
+        }
+        QString reason = QString::fromUtf8(strerror(errno));
+        if(Stop(reason)) {
+          qWarning() << "Received warning from EpollEdge (" << ToString() <<
+            "):" << reason;
+        }
+        return;
+      }
+
+      _queued_bytes -= sent;
+      qint64 consumed = _write_offset + sent;
+      while(!_write_queue.isEmpty()) {
+        qint64 size = _write_queue.first().size() + 8;
+        if(consumed < size) {
+          break;
+        }
+        consumed -= size;
+        _write_queue.removeFirst();
+      }
+      _write_offset = consumed;
+
+      if(sent < batch) {
+        break;
+      }
+    }
+
+    if(_congested && GetBytesQueued() <= LowWaterMark) {
+      _congested = false;
+      emit WriteQueueDrained();
+    }
+  }
+
+  void EpollEdge::OnStop()
+  {
+    Close();
+    Edge::OnStop();
+  }
+
+  void EpollEdge::Close()
+  {
+    if(_fd == -1) {
+      return;
+    }
+
+    if(_listener) {
+      _listener->RemoveEdge(_fd);
+    }
+    ::close(_fd);
+    _fd = -1;
+
+    _write_queue.clear();
+    _write_offset = 0;
+    _queued_bytes = 0;
+  }
+}
+}
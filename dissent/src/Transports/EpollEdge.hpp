@@ -0,0 +1,141 @@
+#ifndef DISSENT_TRANSPORTS_EPOLL_EDGE_H_GUARD
+#define DISSENT_TRANSPORTS_EPOLL_EDGE_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+#include <QPointer>
+
+#include "Edge.hpp"
+#include "EpollAddress.hpp"
+#include "FrameParser.hpp"
+
+namespace Dissent {
+namespace Transports {
+  class EpollEdgeListener;
+
+  /**
+   * A Tcp edge whose socket is driven by the edge-triggered epoll loop of
+   * an EpollEdgeListener rather than by a QTcpSocket.  Reads go through
+   * the receive buffer of the listener, the edge keeps only the frame being
+   * reassembled, and drain the socket until the kernel has no more data or
+   * the edge has had its share of the loop.  Writes hand every queued frame
+   * to the kernel in vectored sends.  The wire format matches TcpEdge.
+   */
+  class EpollEdge : public Edge {
+    Q_OBJECT
+
+    public:
+      /**
+       * Bytes read per readiness event before the edge yields to the rest of
+       * the epoll loop, the remainder is read once control returns to the
+       * event loop
+       */
+      static const int ReadBudget = 256 * 1024;
+
+      /**
+       * Constructor
+       * @param local the local address of the edge
+       * @param remote the address of the remote point of the edge
+       * @param outbound true if the local side requested the creation of this edge
+       * @param fd the connected, non-blocking socket, ownership is taken
+       * @param listener the listener whose epoll loop watches the socket
+       */
+      explicit EpollEdge(const Address &local, const Address &remote,
+          bool outbound, int fd, EpollEdgeListener *listener);
+
+      /**
+       * Destructor
+       */
+      virtual ~EpollEdge();
+
+      /**
+       * Queues data to be framed and written once control returns to the
+       * event loop, so a burst of sends is written together
+       * @param data the message to send
+       */
+      virtual void Send(const QByteArray &data);
+
+      /**
+       * Returns the number of bytes queued but not yet accepted by the
+       * operating system
+       */
+      virtual qint64 GetBytesQueued() const { return _queued_bytes; }
+
+      virtual bool Congested() const { return _congested; }
+
+      virtual inline void SetRemotePersistentAddress(const Address &addr)
+      {
+        const EpollAddress &new_ea = static_cast<const EpollAddress &>(addr);
+        const EpollAddress &old_ea = static_cast<const EpollAddress &>(GetRemoteAddress());
+
+        QHostAddress ha = old_ea.GetIP();
+
+        if(old_ea.GetIP() != new_ea.GetIP()) {
+          if(ha == QHostAddress::Null ||
+              ha == QHostAddress::LocalHost ||
+              ha == QHostAddress::LocalHostIPv6 ||
+              ha == QHostAddress::Broadcast ||
+              ha == QHostAddress::Any ||
+              ha == QHostAddress::AnyIPv6)
+          {
+            ha = new_ea.GetIP();
+          }
+        }
+        Edge::SetRemotePersistentAddress(EpollAddress(ha.toString(), new_ea.GetPort()));
+      }
+
+      /**
+       * Handles the epoll events reported for the socket
+       * @param events the epoll event mask
+       */
+      void HandleEvents(quint32 events);
+
+    signals:
+      void DelayedRead();
+      void DelayedFlush();
+
+    protected:
+      /**
+       * Called as a result of Stop has been called
+       */
+      virtual void OnStop();
+
+    private slots:
+      /**
+       * Reads until the socket would block or the ReadBudget is spent,
+       * passing each complete frame to the sink
+       */
+      void Read();
+
+      /**
+       * Writes queued frames until the socket would block, the remainder is
+       * written once epoll reports the socket writable
+       */
+      void Flush();
+
+    private:
+      /**
+       * Removes the socket from the epoll loop and closes it
+       */
+      void Close();
+
+      int _fd;
+      QPointer<EpollEdgeListener> _listener;
+
+      FrameParser _parser;
+
+      QList<QByteArray> _write_queue;
+
+      /**
+       * Bytes of the first queued frame, including its header, already
+       * accepted by the kernel
+       */
+      qint64 _write_offset;
+      qint64 _queued_bytes;
+      bool _flush_pending;
+      bool _congested;
+  };
+}
+}
+
+#endif
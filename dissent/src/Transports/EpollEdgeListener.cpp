@@ -0,0 +1,356 @@
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <QDebug>
+
+#include "EpollEdgeListener.hpp"
+#include "TcpEdgeListener.hpp"
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    /**
+     * Fills in a socket address for ip and port, returns false for
+     * addresses that are neither IPv4 nor IPv6
+     */
+    bool ToSockAddr(const QHostAddress &ip, int port,
+        struct sockaddr_storage &addr, socklen_t &length)
+    {
+      memset(&addr, 0, sizeof(addr));
+      if(ip.protocol() == QAbstractSocket::IPv6Protocol) {
+        struct sockaddr_in6 *in6 = reinterpret_cast<struct sockaddr_in6 *>(&addr);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        Q_IPV6ADDR ip6 = ip.toIPv6Address();
+        memcpy(&in6->sin6_addr, &ip6, sizeof(in6->sin6_addr));
+        length = sizeof(struct sockaddr_in6);
+      } else if(ip.protocol() != QAbstractSocket::UnknownNetworkLayerProtocol) {
+        struct sockaddr_in *in = reinterpret_cast<struct sockaddr_in *>(&addr);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port);
+        in->sin_addr.s_addr = htonl(ip.toIPv4Address());
+        length = sizeof(struct sockaddr_in);
+      } else {
+        return false;
+      }
+      return true;
+    }
+
+    int GetPort(const struct sockaddr_storage &addr)
+    {
+      if(addr.ss_family == AF_INET6) {
+        return ntohs(reinterpret_cast<const struct sockaddr_in6 *>(&addr)->sin6_port);
+      }
+      return ntohs(reinterpret_cast<const struct sockaddr_in *>(&addr)->sin_port);
+    }
+
+    QString ErrorString(int error)
+    {
+      return QString::fromUtf8(strerror(error));
+    }
+  }
+
+  const QString EpollEdgeListener::Scheme = "epoll";
+
+  EpollEdgeListener::EpollEdgeListener(const EpollAddress &local_address) :
+    EdgeListener(local_address),
+    _epoll_fd(-1),
+    _listen_fd(-1),
+    _notifier(0),
+    _read_buffer(ReadBufferSize, 0)
+  {
+    QObject::connect(this, SIGNAL(DelayedFailure()), this, SLOT(ReportFailures()),
+        Qt::QueuedConnection);
+  }
+
+  EdgeListener *EpollEdgeListener::Create(const Address &local_address)
+  {
+    const EpollAddress &ea = static_cast<const EpollAddress &>(local_address);
+    return new EpollEdgeListener(ea);
+  }
+
+  EpollEdgeListener::~EpollEdgeListener()
+  {
+    DestructorCheck();
+
+    foreach(EpollEdge *edge, _edges.values()) {
+      edge->Stop("EdgeListener destroyed");
+    }
+
+    if(_epoll_fd != -1) {
+      delete _notifier;
+      ::close(_epoll_fd);
+    }
+  }
+
+  void EpollEdgeListener::OnStart()
+  {
+    EdgeListener::OnStart();
+
+    const EpollAddress &addr = static_cast<const EpollAddress &>(GetAddress());
+
+    struct sockaddr_storage local;
+    socklen_t length;
+    if(!ToSockAddr(addr.GetIP(), addr.GetPort(), local, length)) {
+      qFatal("%s", QString("Unable to bind to " + addr.ToString()).toUtf8().data());
+    }
+
+    _listen_fd = socket(local.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if(_listen_fd == -1 ||
+        setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1 ||
+        bind(_listen_fd, reinterpret_cast<struct sockaddr *>(&local), length) == -1 ||
+        listen(_listen_fd, SOMAXCONN) == -1)
+    {
+      qFatal("%s", QString("Unable to bind to " + addr.ToString() + ": " +
+            ErrorString(errno)).toUtf8().data());
+    }
+
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(_epoll_fd == -1) {
+      qFatal("%s", QString("Unable to create epoll: " + ErrorString(errno)).toUtf8().data());
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = _listen_fd;
+    if(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _listen_fd, &event) == -1) {
+      qFatal("%s", QString("Unable to watch " + addr.ToString() + ": " +
+            ErrorString(errno)).toUtf8().data());
+    }
+
+    _notifier = new QSocketNotifier(_epoll_fd, QSocketNotifier::Read, this);
+    QObject::connect(_notifier, SIGNAL(activated(int)), this, SLOT(HandleEvents()));
+
+    length = sizeof(local);
+    getsockname(_listen_fd, reinterpret_cast<struct sockaddr *>(&local), &length);
+    QHostAddress ip = TcpEdgeListener::GetAdvertisedIP(
+        QHostAddress(reinterpret_cast<struct sockaddr *>(&local)));
+    SetAddress(EpollAddress(ip.toString(), GetPort(local)));
+  }
+
+  void EpollEdgeListener::OnStop()
+  {
+    EdgeListener::OnStop();
+
+    if(_listen_fd != -1) {
+      ::close(_listen_fd);
+      _listen_fd = -1;
+    }
+
+    foreach(int fd, _outstanding_sockets.keys()) {
+      HandleSocketClose(fd, "EdgeListener Stopped");
+    }
+  }
+
+  void EpollEdgeListener::CreateEdgeTo(const Address &to)
+  {
+    if(Stopped()) {
+      qWarning() << "Cannot CreateEdgeTo Stopped EL";
+      return;
+    }
+
+    if(!Started()) {
+      qWarning() << "Cannot CreateEdgeTo non-Started EL";
+      return;
+    }
+
+    qDebug() << "Connecting to" << to.ToString();
+
+    const EpollAddress &rem_ea = static_cast<const EpollAddress &>(to);
+    struct sockaddr_storage remote;
+    socklen_t length;
+    if(!rem_ea.Valid() || rem_ea.GetPort() == 0 ||
+        !ToSockAddr(rem_ea.GetIP(), rem_ea.GetPort(), remote, length))
+    {
+      QueueFailure(to, "Invalid address");
+      return;
+    }
+
+    int fd = socket(remote.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd == -1) {
+      QueueFailure(to, ErrorString(errno));
+      return;
+    }
+
+    if(::connect(fd, reinterpret_cast<struct sockaddr *>(&remote), length) == -1 &&
+        errno != EINPROGRESS)
+    {
+      QueueFailure(to, ErrorString(errno));
+      ::close(fd);
+      return;
+    }
+
+    // Registered for both directions now, so the edge inherits the
+    // registration once EPOLLOUT reports the connect complete
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    if(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      QueueFailure(to, ErrorString(errno));
+      ::close(fd);
+      return;
+    }
+
+    _outstanding_sockets.insert(fd, rem_ea);
+  }
+
+  void EpollEdgeListener::HandleEvents()
+  {
+    struct epoll_event events[MaximumEvents];
+
+    while(true) {
+      int count = epoll_wait(_epoll_fd, events, MaximumEvents, 0);
+      if(count == -1) {
+        if(errno == EINTR) {
+          continue;
+        }
+        qCritical() << "Epoll wait failed:" << ErrorString(errno);
+        return;
+      }
+
+      for(int idx = 0; idx < count; idx++) {
+        int fd = events[idx].data.fd;
+        if(fd == _listen_fd) {
+          HandleAccept();
+        } else if(_outstanding_sockets.contains(fd)) {
+          HandleConnect(fd);
+        } else if(EpollEdge *edge = _edges.value(fd)) {
+          edge->HandleEvents(events[idx].events);
+        }
+      }
+
+      if(count < MaximumEvents) {
+        return;
+      }
+    }
+  }
+
+  void EpollEdgeListener::HandleAccept()
+  {
+    // Edge-triggered, so accept until the backlog is empty
+    while(_listen_fd != -1) {
+      struct sockaddr_storage peer;
+      socklen_t length = sizeof(peer);
+      int fd = accept4(_listen_fd, reinterpret_cast<struct sockaddr *>(&peer),
+          &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+      if(fd == -1) {
+        if(errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        } else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+          qWarning() << "Unable to accept on" << GetAddress().ToString() <<
+            ErrorString(errno);
+        }
+        return;
+      }
+
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+      event.data.fd = fd;
+      if(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        qWarning() << "Unable to watch incoming connection:" << ErrorString(errno);
+        ::close(fd);
+        continue;
+      }
+
+      AddSocket(fd, peer, false);
+    }
+  }
+
+  void EpollEdgeListener::HandleConnect(int fd)
+  {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+      error = errno;
+    }
+
+    struct sockaddr_storage peer;
+    length = sizeof(peer);
+    if(error == 0 &&
+        getpeername(fd, reinterpret_cast<struct sockaddr *>(&peer), &length) == -1)
+    {
+      if(errno == ENOTCONN) {
+        // Still connecting
+        return;
+      }
+      error = errno;
+    }
+
+    if(error != 0) {
+      HandleSocketClose(fd, ErrorString(error));
+      return;
+    }
+
+    _outstanding_sockets.remove(fd);
+    AddSocket(fd, peer, true);
+  }
+
+  void EpollEdgeListener::HandleSocketClose(int fd, const QString &reason)
+  {
+    if(!_outstanding_sockets.contains(fd)) {
+      return;
+    }
+
+    Address addr = _outstanding_sockets.value(fd);
+    _outstanding_sockets.remove(fd);
+    ::close(fd);
+
+    qDebug() << "Unable to connect to host: " << addr.ToString() << reason;
+    ProcessEdgeCreationFailure(addr, reason);
+  }
+
+  void EpollEdgeListener::QueueFailure(const Address &to, const QString &reason)
+  {
+    if(_failures.isEmpty()) {
+      emit DelayedFailure();
+    }
+    _failures.append(QPair<Address, QString>(to, reason));
+  }
+
+  void EpollEdgeListener::ReportFailures()
+  {
+    QList<QPair<Address, QString> > failures = _failures;
+    _failures.clear();
+
+    for(int idx = 0; idx < failures.count(); idx++) {
+      qDebug() << "Unable to connect to host: " << failures[idx].first.ToString() <<
+        failures[idx].second;
+      ProcessEdgeCreationFailure(failures[idx].first, failures[idx].second);
+    }
+  }
+
+  void EpollEdgeListener::AddSocket(int fd, const struct sockaddr_storage &peer,
+      bool outgoing)
+  {
+    QHostAddress ip(reinterpret_cast<const struct sockaddr *>(&peer));
+    EpollAddress remote(ip.toString(), GetPort(peer));
+
+    if(outgoing) {
+      qDebug() << "Handling a successful connectTo from" << remote.ToString();
+    } else {
+      qDebug() << "Incoming connection from" << remote.ToString();
+    }
+
+    int keep_alive = 1;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &keep_alive, sizeof(keep_alive));
+
+    EpollEdge *epoll_edge = new EpollEdge(GetAddress(), remote, outgoing, fd, this);
+    _edges.insert(fd, epoll_edge);
+
+    // deleteLater since an edge may be stopped while reading
+    QSharedPointer<Edge> edge(epoll_edge, &QObject::deleteLater);
+    SetSharedPointer(edge);
+    ProcessNewEdge(edge);
+  }
+}
+}
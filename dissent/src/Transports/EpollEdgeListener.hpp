@@ -0,0 +1,106 @@
+#ifndef DISSENT_TRANSPORTS_EPOLL_EDGE_LISTENER_H_GUARD
+#define DISSENT_TRANSPORTS_EPOLL_EDGE_LISTENER_H_GUARD
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QSocketNotifier>
+
+#include "EdgeListener.hpp"
+#include "EpollAddress.hpp"
+#include "EpollEdge.hpp"
+
+struct sockaddr_storage;
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Creates Tcp edges served by a native, edge-triggered epoll loop
+   * (Linux only).  The listening socket, pending connects, and every
+   * EpollEdge share one epoll instance, which joins the Qt event loop
+   * through a single QSocketNotifier on the epoll descriptor, so the number
+   * of connections does not grow the set of descriptors Qt polls.  As all
+   * edges of a listener read on its thread, one at a time, they share a
+   * single receive buffer.  Edges need the listener for their I/O, a
+   * stopped listener no longer accepts or connects but keeps serving its
+   * edges until destroyed.
+   */
+  class EpollEdgeListener : public EdgeListener {
+    Q_OBJECT
+
+    public:
+      const static QString Scheme;
+
+      /**
+       * Events retrieved from the kernel per epoll_wait
+       */
+      static const int MaximumEvents = 256;
+
+      /**
+       * Bytes of the receive buffer shared by the edges
+       */
+      static const int ReadBufferSize = 64 * 1024;
+
+      explicit EpollEdgeListener(const EpollAddress &local_address);
+      static EdgeListener *Create(const Address &local_address);
+
+      /**
+       * Destructor, stops any remaining edges
+       */
+      virtual ~EpollEdgeListener();
+
+      virtual void CreateEdgeTo(const Address &to);
+
+      /**
+       * Called by an EpollEdge as it closes its socket
+       * @param fd the socket of the edge
+       */
+      void RemoveEdge(int fd) { _edges.remove(fd); }
+
+      /**
+       * Returns the receive buffer of the epoll loop, its contents are only
+       * valid until the next read by any edge of the listener
+       */
+      QByteArray &GetReadBuffer() { return _read_buffer; }
+
+    signals:
+      void DelayedFailure();
+
+    protected:
+      virtual void OnStart();
+      virtual void OnStop();
+
+    private slots:
+      /**
+       * Dispatches the events ready on the epoll descriptor
+       */
+      void HandleEvents();
+
+      void ReportFailures();
+
+    private:
+      void HandleAccept();
+      void HandleConnect(int fd);
+      void HandleSocketClose(int fd, const QString &reason);
+
+      /**
+       * Reports a failure to connect once control returns to the event loop
+       */
+      void QueueFailure(const Address &to, const QString &reason);
+
+      void AddSocket(int fd, const struct sockaddr_storage &peer, bool outgoing);
+
+      int _epoll_fd;
+      int _listen_fd;
+      QSocketNotifier *_notifier;
+      QHash<int, EpollEdge *> _edges;
+      QHash<int, EpollAddress> _outstanding_sockets;
+      QList<QPair<Address, QString> > _failures;
+      QByteArray _read_buffer;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include <string.h>
+
+#include <QDebug>
+
+#include "FrameParser.hpp"
+#include "Utils/Serialization.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Transports {
+  FrameParser::FrameParser() :
+    _section(Header),
+    _carry_used(0),
+    _frame_length(0),
+    _frame_used(0)
+  {
+  }
+
+  int FrameParser::GetWanted() const
+  {
+    if(_section == Body) {
+      return _frame_length - _frame_used;
+    }
+    return 4 - _carry_used;
+  }
+
+  char *FrameParser::Reserve(int count)
+  {
+    Q_ASSERT(count <= GetWanted());
+    if(_section == Body) {
+      _frame.resize(_frame_used + count);
+      return _frame.data() + _frame_used;
+    }
+    return _carry + _carry_used;
+  }
+
+  bool FrameParser::Advance(int count, QList<QByteArray> &frames)
+  {
+    if(_section == Body) {
+      _frame_used += count;
+      if(_frame_used == _frame_length) {
+        _frame.resize(_frame_length);
+        _section = Trailer;
+      }
+      return true;
+    }
+
+    _carry_used += count;
+    if(_carry_used < 4) {
+      return true;
+    }
+    _carry_used = 0;
+
+    int value = Serialization::ReadInt(QByteArray::fromRawData(_carry, 4), 0);
+    if(_section == Header) {
+      if(value < 0) {
+        return false;
+      }
+
+      _frame_length = value;
+      _frame_used = 0;
+      _frame = QByteArray();
+      _frame.reserve(qMin(_frame_length, int(MaximumPreallocation)));
+      _section = (_frame_length == 0) ? Trailer : Body;
+      return true;
+    }
+
+    if(value != 0) {
+      qCritical() << "Mismatch on byte array!";
+    }
+
+    frames.append(_frame);
+    _frame = QByteArray();
+    _section = Header;
+    return true;
+  }
+
+  bool FrameParser::Parse(const char *data, int length, QList<QByteArray> &frames)
+  {
+    while(length > 0) {
+      int count = qMin(GetWanted(), length);
+      memcpy(Reserve(count), data, count);
+      if(!Advance(count, frames)) {
+        return false;
+      }
+      data += count;
+      length -= count;
+    }
+    return true;
+  }
+}
+}
@@ -0,0 +1,83 @@
+#ifndef DISSENT_TRANSPORTS_FRAME_PARSER_H_GUARD
+#define DISSENT_TRANSPORTS_FRAME_PARSER_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Reassembles the frames of a Tcp edge stream, each a 4 byte length, the
+   * message, and a 4 byte zero trailer.  The stream may arrive in pieces of
+   * any size, either copied in with Parse or read by the caller directly
+   * into the space returned by Reserve, so frame bodies need not be copied.
+   * Between pieces only the frame being read and at most a partial header
+   * or trailer are kept.
+   */
+  class FrameParser {
+    public:
+      /**
+       * Frames are read into a buffer of their announced length, up to this
+       * many bytes are allocated before the data has arrived
+       */
+      static const int MaximumPreallocation = 16 * 1024 * 1024;
+
+      /**
+       * Constructor
+       */
+      FrameParser();
+
+      /**
+       * Returns the number of bytes that complete the current header, frame
+       * body, or trailer
+       */
+      int GetWanted() const;
+
+      /**
+       * Returns space for the next count bytes of the stream, count must not
+       * exceed GetWanted, the caller fills some or all of it and passes the
+       * number of bytes written to Advance
+       * @param count the number of bytes the caller may write
+       */
+      char *Reserve(int count);
+
+      /**
+       * Accepts bytes written to the space returned by Reserve, returns false
+       * if the stream is malformed
+       * @param count the number of bytes written
+       * @param frames receives the frame completed by these bytes, if any
+       */
+      bool Advance(int count, QList<QByteArray> &frames);
+
+      /**
+       * Copies bytes of the stream in, returns false if the stream is
+       * malformed
+       * @param data the bytes
+       * @param length the number of bytes
+       * @param frames receives the frames completed by these bytes
+       */
+      bool Parse(const char *data, int length, QList<QByteArray> &frames);
+
+    private:
+      enum Section {
+        Header,
+        Body,
+        Trailer
+      };
+
+      Section _section;
+
+      /**
+       * A header or trailer received so far
+       */
+      char _carry[4];
+      int _carry_used;
+
+      int _frame_length;
+      int _frame_used;
+      QByteArray _frame;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "IoThreads.hpp"
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    QMutex threads_lock;
+    QList<QThread *> threads;
+    int next_thread = 0;
+  }
+
+  int IoThreads::Count = 0;
+
+  QThread *IoThreads::Next()
+  {
+    QMutexLocker locker(&threads_lock);
+    if(Count < 1) {
+      return 0;
+    }
+
+    while(threads.count() < Count) {
+      QThread *thread = new QThread();
+      thread->start();
+      threads.append(thread);
+    }
+
+    next_thread = (next_thread + 1) % Count;
+    return threads[next_thread];
+  }
+
+  void IoThreads::Stop()
+  {
+    QMutexLocker locker(&threads_lock);
+    foreach(QThread *thread, threads) {
+      thread->quit();
+      thread->wait();
+      delete thread;
+    }
+    threads.clear();
+    next_thread = 0;
+  }
+}
+}
@@ -0,0 +1,42 @@
+#ifndef DISSENT_TRANSPORTS_IO_THREADS_H_GUARD
+#define DISSENT_TRANSPORTS_IO_THREADS_H_GUARD
+
+class QThread;
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Threads, each running its own event loop, across which TcpEdge sockets
+   * are sharded round robin.  The threads perform socket reads, writes, and
+   * framing, leaving the protocol to the thread that owns the edges.  The
+   * threads are started on first use.
+   */
+  class IoThreads {
+    public:
+      /**
+       * Number of I/O threads, 0 keeps sockets on the thread of their edge
+       */
+      static int Count;
+
+      /**
+       * Returns the thread that should own the next socket or 0 if sockets
+       * stay on the calling thread
+       */
+      static QThread *Next();
+
+      /**
+       * Stops and waits for all of the threads, for use at exit as sockets
+       * still owned by them are leaked
+       */
+      static void Stop();
+
+    private:
+      /**
+       * No instances
+       */
+      IoThreads() {}
+  };
+}
+}
+
+#endif
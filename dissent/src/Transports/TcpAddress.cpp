@@ -13,15 +13,31 @@ namespace Transports {
       return;
     }
 
-    Init(url.host(), url.port(0));
+    Init(url.host(), url.port(0), Scheme);
   }
 
   TcpAddress::TcpAddress(const QString &ip, int port)
   {
-    Init(ip, port);
+    Init(ip, port, Scheme);
+  }
+
+  TcpAddress::TcpAddress(const QUrl &url, const QString &scheme)
+  {
+    if(url.scheme() != scheme) {
+      qCritical() << "Invalid scheme:" << url.scheme() << " expected:" << scheme;
+      _data = new AddressData(url);
+      return;
+    }
+
+    Init(url.host(), url.port(0), scheme);
+  }
+
+  TcpAddress::TcpAddress(const QString &ip, int port, const QString &scheme)
+  {
+    Init(ip, port, scheme);
   }
   
-  void TcpAddress::Init(const QString &ip, int port)
+  void TcpAddress::Init(const QString &ip, int port, const QString &scheme)
   {
     bool valid = true;
 
@@ -41,7 +57,7 @@ namespace Transports {
     }
 
     QUrl url;
-    url.setScheme(Scheme);
+    url.setScheme(scheme);
     url.setHost(ip);
     url.setPort(port);
 
@@ -66,7 +82,8 @@ namespace Transports {
   {
     const TcpAddressData *bother = dynamic_cast<const TcpAddressData *>(other);
     if(bother) {
-      return ip == bother->ip && port == bother->port && valid == bother->valid;
+      return url.scheme() == bother->url.scheme() && ip == bother->ip &&
+        port == bother->port && valid == bother->valid;
     } else {
       return AddressData::Equals(other);
     }
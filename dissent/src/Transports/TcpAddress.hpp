@@ -91,8 +91,24 @@ namespace Transports {
         }
       }
 
+    protected:
+      /**
+       * Creates an address for a transport that shares the Tcp addressing
+       * @param url the url for the address
+       * @param scheme the scheme expected in the url
+       */
+      explicit TcpAddress(const QUrl &url, const QString &scheme);
+
+      /**
+       * Creates an address for a transport that shares the Tcp addressing
+       * @param ip provided ip
+       * @param port provided port
+       * @param scheme the scheme of the address
+       */
+      explicit TcpAddress(const QString &ip, int port, const QString &scheme);
+
     private:
-      void Init(const QString &ip, int port);
+      void Init(const QString &ip, int port, const QString &scheme);
   };
 }
 }
@@ -1,22 +1,22 @@
 #ifndef DISSENT_TRANSPORTS_TCP_EDGE_H_GUARD
 #define DISSENT_TRANSPORTS_TCP_EDGE_H_GUARD
 
-#include <QSharedPointer>
 #include <QTcpSocket>
 #include "Edge.hpp"
 #include "TcpAddress.hpp"
+#include "TcpEdgeSocket.hpp"
 
 namespace Dissent {
 namespace Transports {
   /**
-   * Uses reliable IP networking: Tcp
+   * Uses reliable IP networking: Tcp.  The socket and its framing are
+   * handled by a TcpEdgeSocket on one of the IoThreads, when there are any,
+   * while the edge itself stays on the protocol thread.
    */
   class TcpEdge : public Edge {
     Q_OBJECT
 
     public:
-      static const QByteArray Zero;
-
       /**
        * Constructor
        * @param local the local address of the edge
@@ -32,8 +32,21 @@ namespace Transports {
        */
       virtual ~TcpEdge();
 
+      /**
+       * Queues data to be framed and written once control returns to the
+       * event loop, so a burst of sends is written together
+       * @param data the message to send
+       */
       virtual void Send(const QByteArray &data);
 
+      /**
+       * Returns the number of bytes queued but not yet accepted by the
+       * operating system
+       */
+      virtual qint64 GetBytesQueued() const;
+
+      virtual bool Congested() const { return _congested; }
+
       virtual inline void SetRemotePersistentAddress(const Address &addr)
       {
         const TcpAddress &new_ta = static_cast<const TcpAddress &>(addr);
@@ -65,15 +78,17 @@ namespace Transports {
 
     private slots:
       void HandleDisconnect();
-      void HandleError(QAbstractSocket::SocketError error);
-      void Read();
+      void HandleError(const QString &reason);
+      void HandleBytesWritten();
 
-    private:
-      QSharedPointer<QTcpSocket> _socket;
-      bool _connected;
+      /**
+       * Passes the frames read by the socket to the sink
+       */
+      void ReadFrames();
 
-    signals:
-      void DelayedRead();
+    private:
+      TcpEdgeSocket *_socket;
+      bool _congested;
   };
 }
 }
@@ -35,27 +35,31 @@ namespace Transports {
 
     QObject::connect(&_server, SIGNAL(newConnection()), this, SLOT(HandleAccept()));
 
+    QHostAddress ip = GetAdvertisedIP(_server.serverAddress());
+    int port = _server.serverPort();
+    SetAddress(TcpAddress(ip.toString(), port));
+  }
+
+  QHostAddress TcpEdgeListener::GetAdvertisedIP(const QHostAddress &ip)
+  {
     // XXX the following is a hack so I don't need to support multiple local addresses
-    QHostAddress ip = _server.serverAddress();
-    if(ip == QHostAddress::Any) {
-      ip = QHostAddress::LocalHost;
-      foreach(const QHostAddress &local_ip, QNetworkInterface::allAddresses()) {
-        if(local_ip == QHostAddress::Null ||
-            local_ip == QHostAddress::LocalHost ||
-            local_ip == QHostAddress::LocalHostIPv6 ||
-            local_ip == QHostAddress::Broadcast ||
-            local_ip == QHostAddress::Any ||
-            local_ip == QHostAddress::AnyIPv6)
-        {
-            continue;
-        }
-        ip = local_ip;
-        break;
-      }
+    if(ip != QHostAddress::Any) {
+      return ip;
     }
 
-    int port = _server.serverPort();
-    SetAddress(TcpAddress(ip.toString(), port));
+    foreach(const QHostAddress &local_ip, QNetworkInterface::allAddresses()) {
+      if(local_ip == QHostAddress::Null ||
+          local_ip == QHostAddress::LocalHost ||
+          local_ip == QHostAddress::LocalHostIPv6 ||
+          local_ip == QHostAddress::Broadcast ||
+          local_ip == QHostAddress::Any ||
+          local_ip == QHostAddress::AnyIPv6)
+      {
+          continue;
+      }
+      return local_ip;
+    }
+    return QHostAddress::LocalHost;
   }
 
   void TcpEdgeListener::OnStop()
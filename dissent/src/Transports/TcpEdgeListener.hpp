@@ -32,6 +32,13 @@ namespace Transports {
 
       virtual void CreateEdgeTo(const Address &to);
 
+      /**
+       * Returns the address to advertise for a socket bound to ip, the
+       * first external interface if bound to any
+       * @param ip the address the socket is bound to
+       */
+      static QHostAddress GetAdvertisedIP(const QHostAddress &ip);
+
     protected:
       virtual void OnStart();
       virtual void OnStop();
@@ -0,0 +1,293 @@
+#ifdef __linux__
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include <string.h>
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "TcpEdgeSocket.hpp"
+#include "Utils/Serialization.hpp"
+#include "Utils/Time.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Transports {
+  const QByteArray TcpEdgeSocket::Zero = QByteArray(4, 0);
+
+  TcpEdgeSocket::TcpEdgeSocket(QTcpSocket *socket, qint64 max_pending) :
+    _socket(socket),
+    _max_pending(max_pending),
+    _queued_bytes(0),
+    _socket_bytes(0),
+    _flush_pending(false),
+    _frame_bytes(0),
+    _read_paused(false),
+    _connected(true)
+  {
+    socket->setParent(this);
+
+    QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(Read()));
+    QObject::connect(this, SIGNAL(DelayedRead()), this, SLOT(Read()),
+        Qt::QueuedConnection);
+    QObject::connect(this, SIGNAL(DelayedFlush()), this, SLOT(Flush()),
+        Qt::QueuedConnection);
+    QObject::connect(socket, SIGNAL(bytesWritten(qint64)),
+        this, SLOT(HandleBytesWritten()));
+    QObject::connect(socket, SIGNAL(disconnected()), this, SIGNAL(Disconnected()));
+    QObject::connect(socket, SIGNAL(error(QAbstractSocket::SocketError)),
+        this, SLOT(HandleError(QAbstractSocket::SocketError)));
+  }
+
+  TcpEdgeSocket::~TcpEdgeSocket()
+  {
+  }
+
+  void TcpEdgeSocket::Send(const QByteArray &data)
+  {
+    bool flush;
+    {
+      QMutexLocker locker(&_lock);
+      _write_queue.append(data);
+      _queued_bytes += data.size() + 8;
+      flush = !_flush_pending;
+      _flush_pending = true;
+    }
+
+    if(flush) {
+      emit DelayedFlush();
+    }
+  }
+
+  QList<QByteArray> TcpEdgeSocket::TakeFrames()
+  {
+    QList<QByteArray> frames;
+    bool resume;
+    {
+      QMutexLocker locker(&_lock);
+      frames = _frames;
+      _frames.clear();
+      _frame_bytes = 0;
+      resume = _read_paused;
+      _read_paused = false;
+    }
+
+    if(resume) {
+      emit DelayedRead();
+    }
+    return frames;
+  }
+
+  qint64 TcpEdgeSocket::GetBytesQueued() const
+  {
+    QMutexLocker locker(&_lock);
+    return _queued_bytes + _socket_bytes;
+  }
+
+  void TcpEdgeSocket::Start()
+  {
+    Read();
+  }
+
+  void TcpEdgeSocket::Abort()
+  {
+    _socket->abort();
+  }
+
+  void TcpEdgeSocket::Flush()
+  {
+    QList<QByteArray> queue;
+    {
+      QMutexLocker locker(&_lock);
+      _flush_pending = false;
+      queue = _write_queue;
+      _write_queue.clear();
+    }
+
+    qint64 batch = 0;
+    foreach(const QByteArray &data, queue) {
+      batch += data.size() + 8;
+    }
+
+    if(!queue.isEmpty() && _socket->state() == QAbstractSocket::ConnectedState) {
+      int count = queue.count();
+      QByteArray headers(4 * count, 0);
+      for(int idx = 0; idx < count; idx++) {
+        Serialization::WriteInt(queue[idx].size(), headers, 4 * idx);
+      }
+
+      qint64 written = 0;
+#ifdef __linux__
+      // When Qt has nothing buffered, hand the kernel every frame in as few
+      // vectored sends as possible, whatever it does not accept goes to Qt
+      if(_socket->bytesToWrite() == 0 && _socket->socketDescriptor() != -1) {
+        written = WriteVectored(queue, headers.constData());
+      }
+#endif
+
+      qint64 offset = 0;
+      for(int idx = 0; idx < count; idx++) {
+        const QByteArray &data = queue[idx];
+        const char *parts[3] = { headers.constData() + 4 * idx, data.constData(),
+          Zero.constData() };
+        qint64 sizes[3] = { 4, data.size(), 4 };
+        for(int part = 0; part < 3; part++) {
+          qint64 skip = qBound(qint64(0), written - offset, sizes[part]);
+          offset += sizes[part];
+          if(skip == sizes[part]) {
+            continue;
+          }
+          qint64 remaining = sizes[part] - skip;
+          if(_socket->write(parts[part] + skip, remaining) != remaining) {
+            qCritical() << "Didn't write all data to the socket!!!!!";
+          }
+        }
+      }
+    }
+
+    {
+      QMutexLocker locker(&_lock);
+      _queued_bytes -= batch;
+    }
+    HandleBytesWritten();
+  }
+
+#ifdef __linux__
+  qint64 TcpEdgeSocket::WriteVectored(const QList<QByteArray> &queue,
+      const char *headers)
+  {
+    static const int MaximumIov = 1020;
+    int fd = int(_socket->socketDescriptor());
+    qint64 total = 0;
+
+    int count = queue.count();
+    int idx = 0;
+    while(idx < count) {
+      struct iovec iov[MaximumIov];
+      int iovcnt = 0;
+      qint64 batch = 0;
+      for(; idx < count && iovcnt + 3 <= MaximumIov; idx++) {
+        const QByteArray &data = queue[idx];
+        iov[iovcnt].iov_base = const_cast<char *>(headers + 4 * idx);
+        iov[iovcnt++].iov_len = 4;
+        iov[iovcnt].iov_base = const_cast<char *>(data.constData());
+        iov[iovcnt++].iov_len = data.size();
+        iov[iovcnt].iov_base = const_cast<char *>(Zero.constData());
+        iov[iovcnt++].iov_len = 4;
+        batch += data.size() + 8;
+      }
+
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = iovcnt;
+
+      ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+      if(sent < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          qDebug() << "Vectored write failed on" <<
+            _socket->peerAddress().toString() << errno;
+        }
+        break;
+      }
+
+      total += sent;
+      if(sent < batch) {
+        break;
+      }
+    }
+
+    return total;
+  }
+#endif
+
+  void TcpEdgeSocket::HandleBytesWritten()
+  {
+    {
+      QMutexLocker locker(&_lock);
+      _socket_bytes = _socket->bytesToWrite();
+    }
+    emit BytesWritten();
+  }
+
+  void TcpEdgeSocket::Read()
+  {
+    qint64 stime = Utils::Time::GetInstance().MSecsSinceEpoch();
+    qint64 ntime = stime;
+    bool delay = false;
+
+    while(!delay) {
+      {
+        // Leave the data in the kernel, and so push back on the sender,
+        // until the edge catches up
+        QMutexLocker locker(&_lock);
+        if(_frame_bytes >= _max_pending) {
+          _read_paused = true;
+          break;
+        }
+      }
+
+      int wanted = int(qMin(qint64(_parser.GetWanted()),
+            _socket->bytesAvailable()));
+      if(wanted == 0) {
+        break;
+      }
+
+      // Frame bodies are read directly into the buffer handed to the edge
+      QList<QByteArray> frames;
+      if(_socket->read(_parser.Reserve(wanted), wanted) != wanted ||
+          !_parser.Advance(wanted, frames))
+      {
+        ReadFailed();
+        return;
+      }
+
+      if(frames.isEmpty()) {
+        continue;
+      }
+
+      bool notify;
+      {
+        QMutexLocker locker(&_lock);
+        notify = _frames.isEmpty();
+        _frames.append(frames);
+        foreach(const QByteArray &frame, frames) {
+          _frame_bytes += frame.size();
+        }
+      }
+
+      if(notify) {
+        emit FramesReady();
+      }
+
+      ntime = Utils::Time::GetInstance().MSecsSinceEpoch();
+      delay = (ntime - stime) > 1000;
+    }
+
+    if(delay) {
+      QObject::disconnect(_socket, SIGNAL(readyRead()), this, SLOT(Read()));
+      emit DelayedRead();
+      _connected = false;
+    } else if(!_connected) {
+      QObject::connect(_socket, SIGNAL(readyRead()), this, SLOT(Read()));
+      _connected = true;
+    }
+  }
+
+  void TcpEdgeSocket::ReadFailed()
+  {
+    qCritical() << "Error reading Tcp socket from" << _socket->peerAddress().toString();
+    emit Error("Error reading Tcp socket");
+    _socket->abort();
+  }
+
+  void TcpEdgeSocket::HandleError(QAbstractSocket::SocketError)
+  {
+    emit Error(_socket->errorString());
+  }
+}
+}
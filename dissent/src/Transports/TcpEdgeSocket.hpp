@@ -0,0 +1,147 @@
+#ifndef DISSENT_TRANSPORTS_TCP_EDGE_SOCKET_H_GUARD
+#define DISSENT_TRANSPORTS_TCP_EDGE_SOCKET_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QTcpSocket>
+
+#include "FrameParser.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Performs the socket I/O and framing for a TcpEdge, either on one of the
+   * IoThreads or on the thread of the edge.  Outgoing messages and incoming
+   * frames are exchanged with the edge through queues whose lock is only
+   * held to append to or swap out a queue, so Send, TakeFrames, and
+   * GetBytesQueued may be called from any thread.
+   */
+  class TcpEdgeSocket : public QObject {
+    Q_OBJECT
+
+    public:
+      static const QByteArray Zero;
+
+      /**
+       * Constructor
+       * @param socket the connected socket, ownership is taken
+       * @param max_pending reading pauses once this many bytes of frames
+       * await TakeFrames
+       */
+      explicit TcpEdgeSocket(QTcpSocket *socket, qint64 max_pending);
+
+      /**
+       * Destructor
+       */
+      virtual ~TcpEdgeSocket();
+
+      /**
+       * Queues data to be framed and written once control returns to the
+       * event loop of the socket's thread, so a burst of sends is written
+       * together
+       * @param data the message to send
+       */
+      void Send(const QByteArray &data);
+
+      /**
+       * Removes and returns the frames read since the last call
+       */
+      QList<QByteArray> TakeFrames();
+
+      /**
+       * Returns the number of bytes queued but not yet accepted by the
+       * operating system
+       */
+      qint64 GetBytesQueued() const;
+
+    public slots:
+      /**
+       * Reads any data that arrived before the socket changed threads
+       */
+      void Start();
+
+      /**
+       * Closes the socket immediately
+       */
+      void Abort();
+
+    signals:
+      /**
+       * Emitted when frames become available to TakeFrames
+       */
+      void FramesReady();
+
+      /**
+       * Emitted when the number of bytes queued has fallen
+       */
+      void BytesWritten();
+
+      /**
+       * Emitted when the socket has been disconnected
+       */
+      void Disconnected();
+
+      /**
+       * Emitted when the socket fails
+       * @param reason a description of the failure
+       */
+      void Error(const QString &reason);
+
+      void DelayedRead();
+      void DelayedFlush();
+
+    private slots:
+      void Read();
+
+      /**
+       * Frames and writes all queued messages
+       */
+      void Flush();
+
+      void HandleBytesWritten();
+      void HandleError(QAbstractSocket::SocketError error);
+
+    private:
+      /**
+       * Reports a failed read and closes the socket
+       */
+      void ReadFailed();
+
+#ifdef __linux__
+      /**
+       * Writes frames directly to the socket with vectored sends, returns
+       * the number of bytes the kernel accepted
+       * @param queue the messages to frame
+       * @param headers the length header for each message
+       */
+      qint64 WriteVectored(const QList<QByteArray> &queue, const char *headers);
+#endif
+
+      QTcpSocket *_socket;
+      const qint64 _max_pending;
+
+      /**
+       * Guards the queues and counters shared with other threads
+       */
+      mutable QMutex _lock;
+      QList<QByteArray> _write_queue;
+      qint64 _queued_bytes;
+      qint64 _socket_bytes;
+      bool _flush_pending;
+      QList<QByteArray> _frames;
+      qint64 _frame_bytes;
+      bool _read_paused;
+
+      bool _connected;
+
+      /**
+       * Frames are read directly from the socket into the parser's buffers
+       */
+      FrameParser _parser;
+  };
+}
+}
+
+#endif
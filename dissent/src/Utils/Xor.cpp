@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <string.h>
+#include <QVector>
+
+#include "Xor.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+  (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define DISSENT_XOR_X86
+#include <immintrin.h>
+#endif
+
+namespace Dissent {
+namespace Utils {
+  namespace {
+    typedef void (*XorFunction)(char *, const char *, const char *, int);
+
+    /**
+     * Block size used by XorMany, small enough to remain in the L1 cache
+     */
+    const int XOR_BLOCK_SIZE = 8192;
+
+    void XorPortable(char *dst, const char *t1, const char *t2, int length)
+    {
+      int idx = 0;
+      for(; idx + 8 <= length; idx += 8) {
+        quint64 lhs, rhs;
+        memcpy(&lhs, t1 + idx, 8);
+        memcpy(&rhs, t2 + idx, 8);
+        lhs ^= rhs;
+        memcpy(dst + idx, &lhs, 8);
+      }
+
+      for(; idx < length; idx++) {
+        dst[idx] = t1[idx] ^ t2[idx];
+      }
+    }
+
+#ifdef DISSENT_XOR_X86
+    __attribute__((target("sse2")))
+    void XorSse2(char *dst, const char *t1, const char *t2, int length)
+    {
+      int idx = 0;
+      for(; idx + 64 <= length; idx += 64) {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t1 + idx));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t1 + idx + 16));
+        __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t1 + idx + 32));
+        __m128i a3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t1 + idx + 48));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t2 + idx));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t2 + idx + 16));
+        __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t2 + idx + 32));
+        __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t2 + idx + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + idx), _mm_xor_si128(a0, b0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + idx + 16), _mm_xor_si128(a1, b1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + idx + 32), _mm_xor_si128(a2, b2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + idx + 48), _mm_xor_si128(a3, b3));
+      }
+
+      for(; idx + 16 <= length; idx += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t1 + idx));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t2 + idx));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + idx), _mm_xor_si128(a, b));
+      }
+
+      XorPortable(dst + idx, t1 + idx, t2 + idx, length - idx);
+    }
+
+    __attribute__((target("avx2")))
+    void XorAvx2(char *dst, const char *t1, const char *t2, int length)
+    {
+      int idx = 0;
+      for(; idx + 128 <= length; idx += 128) {
+        __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t1 + idx));
+        __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t1 + idx + 32));
+        __m256i a2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t1 + idx + 64));
+        __m256i a3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t1 + idx + 96));
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t2 + idx));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t2 + idx + 32));
+        __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t2 + idx + 64));
+        __m256i b3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t2 + idx + 96));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + idx), _mm256_xor_si256(a0, b0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + idx + 32), _mm256_xor_si256(a1, b1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + idx + 64), _mm256_xor_si256(a2, b2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + idx + 96), _mm256_xor_si256(a3, b3));
+      }
+
+      for(; idx + 32 <= length; idx += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t1 + idx));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t2 + idx));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + idx), _mm256_xor_si256(a, b));
+      }
+
+      XorPortable(dst + idx, t1 + idx, t2 + idx, length - idx);
+    }
+
+    __attribute__((target("avx512f")))
+    void XorAvx512(char *dst, const char *t1, const char *t2, int length)
+    {
+      int idx = 0;
+      for(; idx + 128 <= length; idx += 128) {
+        __m512i a0 = _mm512_loadu_si512(t1 + idx);
+        __m512i a1 = _mm512_loadu_si512(t1 + idx + 64);
+        __m512i b0 = _mm512_loadu_si512(t2 + idx);
+        __m512i b1 = _mm512_loadu_si512(t2 + idx + 64);
+        _mm512_storeu_si512(dst + idx, _mm512_xor_si512(a0, b0));
+        _mm512_storeu_si512(dst + idx + 64, _mm512_xor_si512(a1, b1));
+      }
+
+      for(; idx + 64 <= length; idx += 64) {
+        __m512i a = _mm512_loadu_si512(t1 + idx);
+        __m512i b = _mm512_loadu_si512(t2 + idx);
+        _mm512_storeu_si512(dst + idx, _mm512_xor_si512(a, b));
+      }
+
+      XorPortable(dst + idx, t1 + idx, t2 + idx, length - idx);
+    }
+#endif
+
+    struct XorKernel {
+      XorFunction function;
+      const char *name;
+    };
+
+    XorKernel SelectKernel()
+    {
+      XorKernel kernel = { &XorPortable, "portable" };
+#ifdef DISSENT_XOR_X86
+      __builtin_cpu_init();
+      if(__builtin_cpu_supports("avx512f")) {
+        kernel.function = &XorAvx512;
+        kernel.name = "avx512";
+      } else if(__builtin_cpu_supports("avx2")) {
+        kernel.function = &XorAvx2;
+        kernel.name = "avx2";
+      } else if(__builtin_cpu_supports("sse2")) {
+        kernel.function = &XorSse2;
+        kernel.name = "sse2";
+      }
+#endif
+      return kernel;
+    }
+
+    const XorKernel &GetKernel()
+    {
+      static const XorKernel kernel = SelectKernel();
+      return kernel;
+    }
+  }
+
+  void Xor(char *dst, const char *t1, const char *t2, int length)
+  {
+    if(length <= 0) {
+      return;
+    }
+    GetKernel().function(dst, t1, t2, length);
+  }
+
+  void Xor(QByteArray &dst, const QByteArray &t1, const QByteArray &t2)
+  {
+    int count = std::min(dst.size(), t1.size());
+    count = std::min(count, t2.size());
+
+    Xor(dst.data(), t1.constData(), t2.constData(), count);
+  }
+
+  void XorMany(char *dst, const char * const *srcs, int count, int length)
+  {
+    XorFunction function = GetKernel().function;
+    for(int offset = 0; offset < length; offset += XOR_BLOCK_SIZE) {
+      int block = std::min(XOR_BLOCK_SIZE, length - offset);
+      char *out = dst + offset;
+      for(int idx = 0; idx < count; idx++) {
+        function(out, out, srcs[idx] + offset, block);
+      }
+    }
+  }
+
+  void XorMany(QByteArray &dst, const QList<QByteArray> &srcs)
+  {
+    int length = dst.size();
+    QVector<const char *> ptrs;
+    ptrs.reserve(srcs.size());
+    foreach(const QByteArray &src, srcs) {
+      length = std::min(length, src.size());
+      ptrs.append(src.constData());
+    }
+
+    XorMany(dst.data(), ptrs.constData(), ptrs.size(), length);
+  }
+
+  const char *XorKernelName()
+  {
+    return GetKernel().name;
+  }
+}
+}
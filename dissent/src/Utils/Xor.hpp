@@ -0,0 +1,54 @@
+#ifndef DISSENT_UTILS_XOR_H_GUARD
+#define DISSENT_UTILS_XOR_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+
+namespace Dissent {
+namespace Utils {
+  /**
+   * Xors two buffers into a third, dst = t1 ^ t2.  The kernel is selected at
+   * startup based upon the processor: AVX-512, AVX2, SSE2, or a portable
+   * word-at-a-time loop.  dst may alias either t1 or t2.
+   * @param dst the destination buffer
+   * @param t1 lhs of the xor operation
+   * @param t2 rhs of the xor operation
+   * @param length number of bytes to xor
+   */
+  void Xor(char *dst, const char *t1, const char *t2, int length);
+
+  /**
+   * Xor operator for QByteArrays, operates over the shortest of the three
+   * @param dst the destination byte array
+   * @param t1 lhs of the xor operation
+   * @param t2 rhs of the xor operation
+   */
+  void Xor(QByteArray &dst, const QByteArray &t1, const QByteArray &t2);
+
+  /**
+   * Xors many buffers into dst.  Rather than one read-modify-write pass over
+   * dst for each source, dst is processed in cache-sized blocks, so that
+   * each block is combined with every source before moving on.
+   * @param dst the destination buffer, also the first input
+   * @param srcs the buffers to xor into dst, each at least length bytes
+   * @param count number of buffers in srcs
+   * @param length number of bytes to xor
+   */
+  void XorMany(char *dst, const char * const *srcs, int count, int length);
+
+  /**
+   * Xors each of the sources into dst, operating over the shortest of dst
+   * and the sources
+   * @param dst the destination byte array, also the first input
+   * @param srcs the byte arrays to xor into dst
+   */
+  void XorMany(QByteArray &dst, const QList<QByteArray> &srcs);
+
+  /**
+   * Returns the name of the xor kernel selected for this processor
+   */
+  const char *XorKernelName();
+}
+}
+
+#endif
@@ -45,6 +45,7 @@ HEADERS += ext/googletest/include/gtest/gtest-death-test.h \
 SOURCES += ext/googletest/src/gtest-all.cc \
            src/Tests/AddressTest.cpp \
            src/Tests/Base64.cpp \
+           src/Tests/BatchVerifierTest.cpp \
            src/Tests/BlogDropProof.cpp \
            src/Tests/BlogDropTest.cpp \
            src/Tests/BlogDropUtilsTest.cpp \
@@ -66,4 +67,5 @@ SOURCES += ext/googletest/src/gtest-all.cc \
            src/Tests/SessionTest.cpp \
            src/Tests/SettingsTest.cpp \
            src/Tests/TimeTest.cpp \
-           src/Tests/TripleTest.cpp
+           src/Tests/TripleTest.cpp \
+           src/Tests/XorTest.cpp